@@ -1,75 +1,100 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
 #include <thread>
 
 #include <api/trade_handler.h>
+#include <api/deribit_encoder.h>
+#include <api/deribit_parser.h>
+#include <api/exchange_clock.h>
+#include <api/instrument_cache.h>
+#include <api/order_manager.h>
 #include <lib/utilities.h>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
 #define DERIBIT_JSON_RPC    "2.0"
-#define DERIBIT_DEFAULT_REQUEST_ID  1
+#define DERIBIT_TESTNET_URL "wss://test.deribit.com/ws/api/v2"
+constexpr auto DERIBIT_RESPONSE_TIMEOUT = std::chrono::seconds(5);
+constexpr auto DERIBIT_HEARTBEAT_INTERVAL = std::chrono::seconds(10); // the shortest interval deribit accepts
 
-class deribit : public trade_handler {
+// final: a basic_client_trader<deribit> calls it without virtual dispatch
+class deribit final : public trade_handler, private deribit_feed_listener {
 public:
-    deribit(): trade_handler("wss://test.deribit.com/ws/api/v2") {}
-    ~deribit() {}
+    // url of the API endpoint, eg. a local mock server (see mock_deribit)
+    explicit deribit(std::string url = DERIBIT_TESTNET_URL): trade_handler(url) {
+        m_books.set_resnapshot_handler([this](std::string_view channel) { resubscribe(channel); });
+        m_order_listener.owner = this;
+    }
+    ~deribit() { stop_clock_probe(); }
 
-    websocketpp::lib::error_code auth() override {
-        json request;
+    /**
+     * @brief Interval of the heartbeats requested on every session when it is authenticated, 0 for none.
+     * Deribit sends a test_request when a session has been idle for the interval, it is answered on the
+     * network thread, and closes sessions which do not answer.
+     */
+    void set_heartbeat_interval(std::chrono::seconds interval) { m_heartbeat_interval = interval; }
 
-        request["method"] = "public/auth";
-        request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
-        
-        request["params"] = json::object();
-        request["params"]["grant_type"] = "client_credentials";
-        request["params"]["client_id"] = m_key.id;
-        request["params"]["client_secret"] = m_key.secret;
+    /**
+     * @brief Authenticate both sessions, private subscriptions need it as much as orders.
+     */
+    websocketpp::lib::error_code auth() override {
+        if(websocketpp::lib::error_code ec = auth_session(m_con_id))
+            return ec;
 
-        websocket_endpoint::send_result result = m_endpoint->send(m_con_id, request.dump());
+        return auth_session(m_md_con_id);
+    }
 
-        if(!result.ec) {
-            // wait for response from the endpoint and store the access token
-            // wait upto a maximum specified time
+    /**
+     * @brief Authenticate one session, with the refresh token of an earlier authentication when there is one.
+     * Falls back to the client credentials if the refresh token is rejected, eg. once it expired.
+     */
+    websocketpp::lib::error_code auth_session(con_id_type con_id) override {
+        std::string refresh_token;
+        {
+            std::lock_guard<std::mutex> lock {m_token_mutex};
+            refresh_token = m_refresh_token;
+        }
 
-            using namespace std::chrono_literals;
-            auto thread_sleep_time = 100ms;
-            auto max_wait_time = 5000; // 5 seconds
+        websocketpp::lib::error_code ec = std::make_error_code(std::errc::permission_denied);
+        if(!refresh_token.empty())
+            ec = authenticate(con_id, refresh_token);
 
-            json json_response;
-            auto msg = m_endpoint->get_latest_message(m_con_id);
-            auto start_time = std::chrono::high_resolution_clock::now();
+        if(ec == std::errc::permission_denied)
+            ec = authenticate(con_id, "");
 
-            while(true) {
-                // add a thread sleep to avoid excessively polling get_latest_message
-                std::this_thread::sleep_for(thread_sleep_time);
+        if(!ec && m_heartbeat_interval.count() > 0)
+            set_heartbeat(con_id);
 
-                auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
-                if(elapsed_time > max_wait_time) {
-                    APP_LOG(log_flags::trade_handler, "Authentication response time exceeded " << max_wait_time << "ms");
-                    return result.ec;
-                }
-    
-                auto tmp = m_endpoint->get_latest_message(m_con_id);
-                if(tmp == msg) continue; // check if new message has arrived
-                msg = tmp;
+        return ec;
+    }
 
-                if(!msg || msg->length() <= WS_MSG_TYPE_LEN) continue; // check if new message is valid
+    /**
+     * @brief Subscribe a replacement market data session to every channel subscribed so far.
+     */
+    void restore_session(session_kind kind, con_id_type con_id) override {
+        if(kind != session_kind::market_data)
+            return;
 
-                // parse the message and store the access_token if the message is valid
-                json_response = json::parse(msg->substr(WS_MSG_TYPE_LEN));
-                if(json_response.contains("result") && json_response["result"].contains("access_token")) {
-                    m_access_token = json_response["result"]["access_token"];
-                    break;
-                }
-            }
+        json request;
+        request["params"] = json::object();
+        {
+            std::lock_guard<std::mutex> lock {m_channels_mutex};
+            if(m_channels.empty())
+                return;
 
-            APP_LOG(log_flags::trade_handler, "(deribit) access token: " << m_access_token);
+            request["params"]["channels"] = m_channels;
         }
 
-        return result.ec;
+        request["method"] = "private/subscribe";
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
+
+        send_request(con_id, request);
     }
 
     /**
@@ -78,7 +103,7 @@ public:
      * params["channels"] (true) - A list of channels to subscribe to.
      *
      */
-    void subscribe(trade_handler::subscriptions_params params) {
+    rpc_future subscribe(const trade_handler::subscriptions_params& params) override {
         static constexpr unsigned int max_label_len = 16;
 
         json request;
@@ -86,30 +111,53 @@ public:
 
         if(params.channels.size() == 0) {
             APP_LOG(log_flags::trade_handler, "(deribit) Specify one or more channels to subscribe");
-            return;
+            return {};
+        }
+
+        std::vector<std::string> channels;
+        channels.reserve(params.channels.size());
+
+        // kept for resubscribing a reconnected session
+        {
+            std::lock_guard<std::mutex> lock {m_channels_mutex};
+            for(const std::string& channel : params.channels) {
+                if(std::string_view held = book_channel_of(channel); !held.empty() && held != channel) {
+                    APP_LOG(log_flags::trade_handler, "(deribit) " << channel << " refused, the book of its instrument is kept from " << held);
+                    continue;
+                }
+
+                m_channels.insert(channel);
+                channels.push_back(channel);
+            }
         }
 
-        request["params"]["channels"] = params.channels;
+        if(channels.empty())
+            return {};
+
+        request["params"]["channels"] = channels;
 
         request["method"] = "private/subscribe";
         request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
 
-        m_endpoint->send(m_con_id, request.dump());
+        return send_request(m_md_con_id, request).response;
     }
 
     /**
      * @brief Unsubscribe from all the channels subscribed so far.
      */
-    void unsubscribe_all() {
+    rpc_future unsubscribe_all() override {
         json request;
 
         request["params"] = json::object();
         request["method"] = "private/unsubscribe_all";
         request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
 
-        m_endpoint->send(m_con_id, request.dump());
+        {
+            std::lock_guard<std::mutex> lock {m_channels_mutex};
+            m_channels.clear();
+        }
+
+        return send_request(m_md_con_id, request).response;
     }
 
     /**
@@ -118,7 +166,7 @@ public:
      * params["invalidate_token"] (false) - If value is true all tokens created in current session are invalidated.
      *                                          default: true
      */
-    void logout(trade_handler::logout_params params) {
+    rpc_future logout(const trade_handler::logout_params& params) override {
         json request;
 
         request["params"] = json::object();
@@ -126,26 +174,114 @@ public:
 
         request["method"] = "public/get_time";
         request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
         
 
-        m_endpoint->send(m_con_id, request.dump());
+        return send_request(request).response;
     }
 
     /**
      * @brief Retrieves the current time (in milliseconds). 
      * This API endpoint can be used to check the clock skew between your software and Deribit's systems.
+     * The response is added as a sample to the exchange clock.
      */
-    void test() override {
+    rpc_future test() override {
         json request;
 
         request["method"] = "public/get_time";
         request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
         
         request["params"] = json::object();
 
-        m_endpoint->send(m_con_id, request.dump());
+        return send_request(request, [this](const rpc_response& response) { on_time_response(response); }).response;
+    }
+
+    /**
+     * @brief Sample public/get_time on the order entry session every interval, from a background thread.
+     */
+    void start_clock_probe(std::chrono::milliseconds interval) override {
+        std::lock_guard<std::mutex> lock {m_probe_mutex};
+        if(m_probe_thread.joinable())
+            return;
+
+        m_probe_running = true;
+        m_probe_thread = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock {m_probe_mutex};
+
+            while(m_probe_running) {
+                lock.unlock();
+                if(order_con_id() != WS_CON_ERR_CODE)
+                    test();
+                lock.lock();
+
+                m_probe_cv.wait_for(lock, interval, [this] { return !m_probe_running; });
+            }
+        });
+    }
+
+    void stop_clock_probe() override {
+        {
+            std::lock_guard<std::mutex> lock {m_probe_mutex};
+            if(!m_probe_thread.joinable())
+                return;
+
+            m_probe_running = false;
+        }
+
+        m_probe_cv.notify_all();
+        m_probe_thread.join();
+    }
+
+    const exchange_clock* get_exchange_clock() const override { return &m_clock; }
+
+    /**
+     * @brief Retrieves the available instruments of a currency and loads their tick size, contract size,
+     * minimum trade amount and kind into the instrument cache, on the order network thread.
+     * Once loaded, buy and sell orders for an unknown instrument, or with a price or amount off the
+     * instrument's grid, are rejected before sending.
+     * @param currency The currency symbol or any for all
+     */
+    rpc_future load_instruments(trade_handler::currency_code currency) override {
+        if(currency == trade_handler::currency_code::unset) {
+            APP_LOG(log_flags::trade_handler, "(deribit) currency not specified");
+            return {};
+        }
+
+        json request;
+        request["params"] = json::object();
+        request["params"]["currency"] = to_token(currency);
+
+        request["method"] = "public/get_instruments";
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
+
+        return send_request(request, [this](const rpc_response& response) { on_instruments_response(response); }).response;
+    }
+
+    const instrument_cache* get_instruments() const override { return &m_instruments; }
+
+    /**
+     * @brief Keep the state of the user's orders locally: subscribes to user.orders.any.any.raw and
+     * user.trades.any.any.raw, and loads the open orders with private/get_open_orders.
+     * Orders sent from now on are tracked from their request, see order_manager.
+     */
+    rpc_future track_orders() override {
+        m_tracking_orders = true;
+
+        trade_handler::subscriptions_params subscriptions;
+        subscriptions.channels = {"user.orders.any.any.raw", "user.trades.any.any.raw"};
+        subscribe(subscriptions);
+
+        return get_open_orders({});
+    }
+
+    const order_manager* get_orders() const override { return &m_orders; }
+
+    /**
+     * @brief Reload the open orders once a replacement session is active: responses and notifications sent
+     * while a session was down are lost, orders it had in flight were forgotten.
+     */
+    void resync_session(session_kind kind) override {
+        if(m_tracking_orders)
+            get_open_orders({});
     }
 
     /**
@@ -155,7 +291,7 @@ public:
      *   params["depth"] (false) - The number of entries to return for bids and asks.
      *      caller must specify depth as -1, if not specifying depth
      */
-    void get_order_book(trade_handler::order_book_params params) override {
+    rpc_future get_order_book(const trade_handler::order_book_params& params) override {
         static constexpr std::array allowed_depths = {1, 5, 10, 20, 50, 100, 1000, 10000};
 
         json request;
@@ -163,14 +299,14 @@ public:
         
         if(params.instrument.empty()) {
             APP_LOG(log_flags::trade_handler, "(deribit) instrument not specified");
-            return;
+            return {};
         }
         request["params"]["instrument_name"] = params.instrument;
 
         if(params.depth != -1) {
             if(std::find(allowed_depths.begin(), allowed_depths.end(), params.depth) == allowed_depths.end()) {
                 APP_LOG(log_flags::trade_handler, "(deribit) invalid depth specified: " << params.depth);
-                return;
+                return {};
             }
 
             request["params"]["depth"] = params.depth;
@@ -178,9 +314,8 @@ public:
 
         request["method"] = "public/get_order_book";
         request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
 
-        m_endpoint->send(m_con_id, request.dump());
+        return send_request(m_md_con_id, request).response;
     }
 
     /**
@@ -190,45 +325,26 @@ public:
      *   params["currency"] (false)
      *   params["kind"] (false) - Kind filter on positions
      */
-    void get_positions(trade_handler::positions_params params) override {
-        static constexpr std::array allowed_currency = {"BTC", "ETH", "USDC", "USDT", "EURR", "any"};
-        static constexpr std::array allowed_kind = {"future", "option", "spot", "future_combo", "option_combo"};
-
+    rpc_future get_positions(const trade_handler::positions_params& params) override {
         json request;
         request["params"] = json::object();
 
-        // specify currency only if valid
-        if(!params.currency.empty()) {
-            if(std::find(allowed_currency.begin(), allowed_currency.end(), params.currency) == allowed_currency.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid currency specified: " << params.currency);
-                return;
-            }
-
-            request["params"]["currency"] = params.currency;
-        }
-
-        if(!params.kind.empty()) {
-            if(std::find(allowed_kind.begin(), allowed_kind.end(), params.kind) == allowed_kind.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid kind specified: " << params.kind);
-                return;
-            }
-
-            request["params"]["kind"] = params.kind;
-        }
+        if(params.currency != trade_handler::currency_code::unset)
+            request["params"]["currency"] = to_token(params.currency);
+        if(params.kind != trade_handler::instrument_kind::unset)
+            request["params"]["kind"] = to_token(params.kind);
 
         // specify request details
         request["method"] = "private/get_positions";
         request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
         
-        m_endpoint->send(m_con_id, request.dump());
+        return send_request(request).response;
     }
 
     /**
      * @brief Places a buy order for an instrument.
      * @param params
-     *   -> All string values are empty for not specified
-     *   -> All integral values are -1 for not specified
+     *   -> Strings are empty, enums and decimals are unset when not specified
      * 
      *   params[<name>] (<reqd>)
      *   params["instrument_name"] (true)
@@ -241,307 +357,658 @@ public:
      *   params["trigger"] (false) - Defines the trigger type. Required for "Stop-Loss", "Take-Profit" and "Trailing" trigger orders
      *   params["trigger_price"] (false) - Trigger price, required for trigger orders only
      */
-    void buy(trade_handler::order_params params) override {
-        static constexpr std::array allowed_types = {"limit", "stop_limit", "take_limit", "market", "stop_market", "take_market", "market_limit", "trailing_stop"};
-        static constexpr std::array allowed_time_in_force = {"good_til_cancelled", "good_til_day", "fill_or_kill", "immediate_or_cancel"};
-        static constexpr std::array allowed_triggers = {"index_price", "mark_price", "last_price"};
-        static constexpr unsigned int max_label_len = 64;
+    rpc_future buy(const trade_handler::order_params& params) override {
+        return place_order("private/buy", params);
+    }
 
-        json request;
-        request["params"] = json::object();
+    /**
+     * @brief Places a sell order for an instrument.
+     * @param params
+     *   -> Strings are empty, enums and decimals are unset when not specified
+     * 
+     *   params[<name>] (<reqd>)
+     *   params["instrument_name"] (true)
+     *   params["amount"] (false) - It represents the requested order size.
+     *   params["contracts"] (false) - It represents the requested order size in contract units and can be passed instead of `amount`
+     *   params["type"] (false) - The order type, default: "limit"
+     *   params["label"] (false) - User defined label for the order (maximum 64 characters)
+     *   params["price"] (false) - The order price in base currency (Only for limit and stop_limit orders)
+     *   params["time_in_force"] (false) - Specifies how long the order remains in effect. Default "good_til_cancelled"
+     *   params["trigger"] (false) - Defines the trigger type. Required for "Stop-Loss", "Take-Profit" and "Trailing" trigger orders
+     *   params["trigger_price"] (false) - Trigger price, required for trigger orders only
+     */
+    rpc_future sell(const trade_handler::order_params& params) override {
+        return place_order("private/sell", params);
+    }
 
-        if(params.instrument.empty()) {
-            APP_LOG(log_flags::trade_handler, "(deribit) instrument not specified");
-            return;
+    /**
+     * @brief Validates a buy order once and serializes it into a template, for repeated orders on
+     * the same instrument. Each send_order() then only writes the id, size, price and label into the frame.
+     * @param params Like buy(), the size, price and label are placeholders: an order without a price
+     * or a label gives a template without one
+     * @return false if the order is invalid
+     */
+    bool make_buy_template(const trade_handler::order_params& params, deribit_order_template& order_template) {
+        return make_order_template("private/buy", params, order_template);
+    }
+
+    /**
+     * @brief Validates a sell order once and serializes it into a template, see make_buy_template().
+     */
+    bool make_sell_template(const trade_handler::order_params& params, deribit_order_template& order_template) {
+        return make_order_template("private/sell", params, order_template);
+    }
+
+    /**
+     * @brief Sends an order from a template, with its size (amount or contracts, as the template was made) and price.
+     * The price is required by a template made with one. The label must fit the template: at most 64 characters
+     * none of which needs escaping, or none at all for a template without a label.
+     * The size and price are not checked against the instrument cache, the caller keeps them on the instrument's grid.
+     * A template is used by one thread at a time.
+     */
+    rpc_future send_order(deribit_order_template& order_template, fixed_decimal size, fixed_decimal price = {}, std::string_view label = {}) {
+        request_id_type id = m_next_request_id++;
+        std::string_view frame = order_template.frame(id, size, price, label);
+
+        if(frame.empty()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) order does not fit the template, size: " << size << ", price: " << price << ", label: " << label);
+            return {};
+        }
+
+        m_orders.on_sent(id, order_template.instrument(), label, order_template.buy() ? order_direction::buy : order_direction::sell, size, price);
+        return send_frame(id, frame);
+    }
+
+    /**
+     * @brief Change price, amount and/or other properties of an order.
+     * @param params
+     *   -> Strings are empty, enums and decimals are unset when not specified
+     * 
+     *   params[<name>] (<reqd>)
+     *   params["order_id"] (true)
+     *   params["amount"] (false) - It represents the requested order size.
+     *   params["contracts"] (false) - It represents the requested order size in contract units and can be passed instead of `amount`
+     *   params["price"] (false) - The order price in base currency (Only for limit and stop_limit orders)
+     *   params["trigger_price"] (false) - Trigger price, required for trigger orders only
+     */
+    rpc_future edit(const trade_handler::order_params& params) override {
+        if(params.order_id.empty()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) Order ID not specified");
+            return {};
         }
-        request["params"]["instrument_name"] = params.instrument;
 
-        if(params.amount == -1 && params.contracts == -1) {
+        if(!params.amount.has_value() && !params.contracts.has_value()) {
             APP_LOG(log_flags::trade_handler, "(deribit) Must specify atleast amount or contracts");
-            return;
+            return {};
         }
 
-        if(params.amount != -1 && params.contracts != -1 && params.amount != params.contracts) {
+        if(params.amount.has_value() && params.contracts.has_value() && params.amount != params.contracts) {
             APP_LOG(log_flags::trade_handler, "(deribit) amount and contracts must match");
-            return;
+            return {};
         }
 
-        if(params.amount != -1)
-            request["params"]["amount"] = params.amount;
-        if(params.contracts != -1)
-            request["params"]["contracts"] = params.contracts;
+        request_id_type id = m_next_request_id++;
+        std::string_view frame = m_encoder.encode_edit(id, params);
 
-        if(!params.type.empty()) {
-            if(std::find(allowed_types.begin(), allowed_types.end(), params.type) == allowed_types.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid type specified: " << params.type);
-                return;
-            }
+        APP_LOG(log_flags::trade_handler, "(deribit) Edit order request sent. Check details");
+        return send_frame(id, frame);
+    }
 
-            request["params"]["type"] = params.type;
+    /**
+     * @brief Cancel an order, specified by order id
+     * @param params
+     *   params["order_id"] (true)
+     */
+    rpc_future cancel(const trade_handler::order_params& params) override {
+        if(params.order_id.empty()) {
+            APP_LOG(log_flags::trade_handler, "Order ID must be specified");
+            return {};
         }
 
-        if(!params.label.empty()) {
-            if(params.label.length() > max_label_len) {
-                APP_LOG(log_flags::trade_handler, "(deribit) label length exceeds " << max_label_len << " characters");
-                return;
-            }
+        request_id_type id = m_next_request_id++;
+        return send_frame(id, m_encoder.encode_cancel(id, params));
+    }
 
-            request["params"]["label"] = params.label;
-        }
+    /**
+     * @brief Places several buy orders, written to the order entry session in one write.
+     * Each order is validated like buy(), the responses are matched per order.
+     */
+    std::vector<rpc_future> buy_batch(const trade_handler::order_params* orders, std::size_t count) override {
+        return place_orders("private/buy", orders, count);
+    }
 
-        if(params.price != -1) {
-            request["params"]["price"] = params.price;
-        }
+    /**
+     * @brief Places several sell orders, written to the order entry session in one write.
+     */
+    std::vector<rpc_future> sell_batch(const trade_handler::order_params* orders, std::size_t count) override {
+        return place_orders("private/sell", orders, count);
+    }
 
-        if(!params.time_in_force.empty()) {
-            if(std::find(allowed_time_in_force.begin(), allowed_time_in_force.end(), params.time_in_force) == allowed_time_in_force.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid time_in_force specified: " << params.time_in_force);
-                return;
+    /**
+     * @brief Cancels several orders, specified by order id, in one write.
+     */
+    std::vector<rpc_future> cancel_batch(const trade_handler::order_params* orders, std::size_t count) override {
+        return send_batch(orders, count, [this](request_id_type id, const trade_handler::order_params& params) {
+            if(params.order_id.empty()) {
+                APP_LOG(log_flags::trade_handler, "Order ID must be specified");
+                return std::string_view{};
             }
 
-            request["params"]["time_in_force"] = params.time_in_force;
+            return m_encoder.encode_cancel(id, params);
+        });
+    }
+
+    /**
+     * @brief Cancels all orders by instrument, optionally filtered by order type.
+     * @param params
+     *   params["instrument_name"] (true)
+     *   params["type"] (false) - Order type: all, limit, trigger_all, stop, take, trailing_stop, default - all
+     */
+    rpc_future cancel_all_by_instrument(const trade_handler::cancel_all_params& params) override {
+        static constexpr std::array allowed_types = {"all", "limit", "trigger_all", "stop", "take", "trailing_stop"};
+
+        if(params.instrument.empty()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) instrument not specified");
+            return {};
         }
 
-        if(!params.trigger.empty()) {
-            if(std::find(allowed_triggers.begin(), allowed_triggers.end(), params.trigger) == allowed_triggers.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid trigger specified: " << params.trigger);
-                return;
-            }
+        if(!params.type.empty() && std::find(allowed_types.begin(), allowed_types.end(), params.type) == allowed_types.end()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) invalid type specified: " << params.type);
+            return {};
+        }
 
-            if(params.trigger_price == -1) {
-                APP_LOG(log_flags::trade_handler, "(deribit) Trigger price must be specified for trigger orders.");
-                return;
-            }
+        request_id_type id = m_next_request_id++;
+        return send_frame(id, m_encoder.encode_cancel_all_by_instrument(id, params.instrument, params.type));
+    }
 
-            request["params"]["trigger"] = params.trigger;
-            request["params"]["trigger_price"] = params.trigger_price;
+    /**
+     * @brief Cancels orders by label. All user's orders (trigger orders too), with a given label are cancelled.
+     * @param params
+     *   params["label"] (true) - User defined label for the order (maximum 64 characters)
+     *   params["currency"] (false) - The currency symbol, not any
+     */
+    rpc_future cancel_by_label(const trade_handler::cancel_label_params& params) override {
+        if(params.label.empty()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) label not specified");
+            return {};
         }
 
-        // specify request details
-        request["method"] = "private/buy";
-        request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
+        if(params.currency == trade_handler::currency_code::any) {
+            APP_LOG(log_flags::trade_handler, "(deribit) invalid currency specified: " << params.currency);
+            return {};
+        }
 
-        APP_LOG(log_flags::trade_handler, "(deribit) Buy order request sent. Check details");
-        m_endpoint->send(m_con_id, request.dump());
+        request_id_type id = m_next_request_id++;
+        return send_frame(id, m_encoder.encode_cancel_by_label(id, params.label, params.currency));
     }
 
     /**
-     * @brief Places a buy order for an instrument.
+     * @brief Retrieves list of user's open orders across many currencies.
      * @param params
-     *   -> All string values are empty for not specified
-     *   -> All integral values are -1 for not specified
-     * 
-     *   params[<name>] (<reqd>)
-     *   params["instrument_name"] (true)
-     *   params["amount"] (false) - It represents the requested order size.
-     *   params["contracts"] (false) - It represents the requested order size in contract units and can be passed instead of `amount`
-     *   params["type"] (false) - The order type, default: "limit"
-     *   params["label"] (false) - User defined label for the order (maximum 64 characters)
-     *   params["price"] (false) - The order price in base currency (Only for limit and stop_limit orders)
-     *   params["time_in_force"] (false) - Specifies how long the order remains in effect. Default "good_til_cancelled"
-     *   params["trigger"] (false) - Defines the trigger type. Required for "Stop-Loss", "Take-Profit" and "Trailing" trigger orders
-     *   params["trigger_price"] (false) - Trigger price, required for trigger orders only
+     *   params["kind"] (false) - Instrument kind, if not provided instruments of all kinds are considered
+     *   params["type"] (false) - Order type, default - all
      */
-    void sell(trade_handler::order_params params) override {
-        static constexpr std::array allowed_types = {"limit", "stop_limit", "take_limit", "market", "stop_market", "take_market", "market_limit", "trailing_stop"};
-        static constexpr std::array allowed_time_in_force = {"good_til_cancelled", "good_til_day", "fill_or_kill", "immediate_or_cancel"};
-        static constexpr std::array allowed_triggers = {"index_price", "mark_price", "last_price"};
-        static constexpr unsigned int max_label_len = 64;
-
+    rpc_future get_open_orders(const trade_handler::open_orders_params& params) override {
         json request;
         request["params"] = json::object();
 
-        if(params.instrument.empty()) {
-            APP_LOG(log_flags::trade_handler, "(deribit) instrument not specified");
-            return;
-        }
-        request["params"]["instrument_name"] = params.instrument;
+        if(params.kind != trade_handler::instrument_kind::unset)
+            request["params"]["kind"] = to_token(params.kind);
+        if(params.type != trade_handler::open_orders_type::unset)
+            request["params"]["type"] = to_token(params.type);
 
-        if(params.amount == -1 && params.contracts == -1) {
-            APP_LOG(log_flags::trade_handler, "(deribit) Must specify atleast amount or contracts");
-            return;
-        }
+        request["method"] = "private/get_open_orders";
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
 
-        if(params.amount != -1 && params.contracts != -1 && params.amount != params.contracts) {
-            APP_LOG(log_flags::trade_handler, "(deribit) amount and contracts must match");
+        return send_request(request).response;
+    }
+    const order_book_manager* get_order_books() const override { return &m_books; }
+
+    // receives parsed subscription notifications on the network thread
+    void set_feed_listener(deribit_feed_listener* listener) { m_feed_listener = listener; }
+
+protected:
+    void on_message(con_id_type con_id, std::string_view payload) override {
+        m_receiving_con_id = con_id;
+
+        if(!m_parser.parse(payload, *this))
+            APP_LOG(log_flags::trade_handler, "(deribit) could not parse message: " << payload);
+    }
+
+    // responses are matched by the request tracker, the orders they carry update the order manager
+    void on_order_message(con_id_type con_id, std::string_view payload) override {
+        m_order_listener.con_id = con_id;
+        m_order_parser.parse(payload, m_order_listener);
+    }
+
+private:
+    // parsed notifications update the local state before they are passed on to the feed listener
+    void on_book(const book_update& update) override {
+        m_books.apply(update);
+
+        if(deribit_feed_listener* listener = m_feed_listener.load(std::memory_order_acquire))
+            listener->on_book(update);
+    }
+
+    void on_trades(const trades_update& update) override {
+        if(deribit_feed_listener* listener = m_feed_listener.load(std::memory_order_acquire))
+            listener->on_trades(update);
+    }
+
+    void on_orders(const orders_update& update) override {
+        m_orders.apply(update);
+
+        if(deribit_feed_listener* listener = m_feed_listener.load(std::memory_order_acquire))
+            listener->on_orders(update);
+    }
+
+    void on_user_trades(const user_trades_update& update) override {
+        m_orders.apply(update);
+
+        if(deribit_feed_listener* listener = m_feed_listener.load(std::memory_order_acquire))
+            listener->on_user_trades(update);
+    }
+
+    void on_notification(std::string_view channel, std::string_view data) override {
+        if(deribit_feed_listener* listener = m_feed_listener.load(std::memory_order_acquire))
+            listener->on_notification(channel, data);
+    }
+
+    void on_heartbeat(std::string_view type) override {
+        answer_heartbeat(m_receiving_con_id, type);
+
+        if(deribit_feed_listener* listener = m_feed_listener.load(std::memory_order_acquire))
+            listener->on_heartbeat(type);
+    }
+
+    // the order entry sessions are parsed separately, on the order network thread
+    struct order_session_listener : deribit_feed_listener {
+        deribit* owner = nullptr;
+        con_id_type con_id = WS_CON_ERR_CODE;
+
+        void on_heartbeat(std::string_view type) override { owner->answer_heartbeat(con_id, type); }
+        void on_order_response(const order_response& response) override { owner->m_orders.apply(response); }
+    };
+
+    // a test_request must be answered with any request on the same session, or it is closed
+    void answer_heartbeat(con_id_type con_id, std::string_view type) {
+        if(type != "test_request" || con_id == WS_CON_ERR_CODE)
             return;
-        }
 
-        if(params.amount != -1)
-            request["params"]["amount"] = params.amount;
-        if(params.contracts != -1)
-            request["params"]["contracts"] = params.contracts;
+        json request;
+        request["method"] = "public/test";
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
+        request["params"] = json::object();
 
-        if(!params.type.empty()) {
-            if(std::find(allowed_types.begin(), allowed_types.end(), params.type) == allowed_types.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid type specified: " << params.type);
-                return;
-            }
+        send_request(con_id, request);
+    }
 
-            request["params"]["type"] = params.type;
-        }
+    void set_heartbeat(con_id_type con_id) {
+        json request;
+        request["method"] = "public/set_heartbeat";
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
+        request["params"] = json::object();
+        request["params"]["interval"] = m_heartbeat_interval.count();
 
-        if(!params.label.empty()) {
-            if(params.label.length() > max_label_len) {
-                APP_LOG(log_flags::trade_handler, "(deribit) label length exceeds " << max_label_len << " characters");
-                return;
-            }
+        send_request(con_id, request);
+    }
 
-            request["params"]["label"] = params.label;
-        }
+    // response to public/get_time, runs on the order network thread
+    void on_time_response(const rpc_response& response) {
+        tsc_clock::time_point received = tsc_clock::now();
 
-        if(params.price != -1) {
-            request["params"]["price"] = params.price;
-        }
+        json_scanner scanner {response.payload};
+        std::string_view key;
+        std::int64_t exchange_time_ms;
+
+        if(!scanner.enter_object())
+            return; // the session closed before the response arrived
 
-        if(!params.time_in_force.empty()) {
-            if(std::find(allowed_time_in_force.begin(), allowed_time_in_force.end(), params.time_in_force) == allowed_time_in_force.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid time_in_force specified: " << params.time_in_force);
+        while(scanner.next_key(key)) {
+            if(key == "result") {
+                if(scanner.read_int(exchange_time_ms))
+                    m_clock.add_sample(received - response.round_trip, exchange_time_ms, received);
                 return;
             }
 
-            request["params"]["time_in_force"] = params.time_in_force;
+            if(!scanner.skip_value())
+                return;
         }
+    }
 
-        if(!params.trigger.empty()) {
-            if(std::find(allowed_triggers.begin(), allowed_triggers.end(), params.trigger) == allowed_triggers.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid trigger specified: " << params.trigger);
-                return;
+    // response to public/get_instruments, runs on the order network thread
+    void on_instruments_response(const rpc_response& response) {
+        json_scanner scanner {response.payload};
+        std::string_view key;
+        std::size_t rejected = 0;
+
+        if(!scanner.enter_object())
+            return;
+
+        while(scanner.next_key(key)) {
+            if(key != "result") {
+                if(!scanner.skip_value())
+                    break;
+                continue;
             }
 
-            if(params.trigger_price == -1) {
-                APP_LOG(log_flags::trade_handler, "(deribit) Trigger price must be specified for trigger orders.");
-                return;
+            if(!scanner.enter_array())
+                break;
+
+            while(scanner.next_element()) {
+                std::string_view instrument;
+                instrument_info info;
+
+                if(!read_instrument(scanner, instrument, info))
+                    break;
+
+                if(!m_instruments.add(instrument, info))
+                    rejected++;
             }
+            break;
+        }
+
+        if(scanner.failed())
+            APP_LOG(log_flags::trade_handler, "(deribit) could not parse instruments: " << response.payload.substr(0, 256));
+        if(rejected)
+            APP_LOG(log_flags::trade_handler, "(deribit) " << rejected << " instruments without valid trading rules");
+
+        APP_LOG(log_flags::trade_handler, "(deribit) " << m_instruments.size() << " instruments loaded");
+    }
 
-            request["params"]["trigger"] = params.trigger;
-            request["params"]["trigger_price"] = params.trigger_price;
+    // one element of the result of public/get_instruments
+    static bool read_instrument(json_scanner& scanner, std::string_view& instrument, instrument_info& info) {
+        std::string_view key;
+        std::string_view text;
+
+        if(!scanner.enter_object())
+            return false;
+
+        while(scanner.next_key(key)) {
+            if(key == "instrument_name") {
+                if(!scanner.read_string(instrument))
+                    return false;
+            } else if(key == "kind") {
+                if(!scanner.read_string(text))
+                    return false;
+                parse_token(text, info.kind);
+            } else if(key == "tick_size" || key == "contract_size" || key == "min_trade_amount") {
+                fixed_decimal& value = key == "tick_size" ? info.tick_size : key == "contract_size" ? info.contract_size : info.min_trade_amount;
+                if(!deribit_message_parser::read_decimal(scanner, value))
+                    return false;
+            } else if(!scanner.skip_value()) {
+                return false;
+            }
         }
 
-        // specify request details
-        request["method"] = "private/sell";
-        request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
+        return !scanner.failed();
+    }
+
+    // the price and amount of an order against the trading rules of its instrument, once they are loaded
+    bool check_instrument_rules(const trade_handler::order_params& params) {
+        std::string_view reason = m_instruments.check(params);
+        if(reason.empty())
+            return true;
 
-        APP_LOG(log_flags::trade_handler, "(deribit) Buy order request sent. Check details");
-        m_endpoint->send(m_con_id, request.dump());
+        APP_LOG(log_flags::trade_handler, "(deribit) " << params.instrument << ": " << reason);
+        return false;
     }
 
+    // the book channel already subscribed for the instrument of a book channel, empty if none
+    // one local book is kept per instrument, two channels (eg. 100ms and raw) would interleave their change_ids
+    std::string_view book_channel_of(std::string_view channel) const {
+        if(channel.compare(0, 5, "book.") != 0)
+            return {};
 
+        std::string prefix = "book.";
+        prefix += deribit_message_parser::channel_instrument(channel);
+        prefix += '.';
 
-    /**
-     * @brief Change price, amount and/or other properties of an order.
-     * @param params
-     *   -> All string values are empty for not specified
-     *   -> All integral values are -1 for not specified
-     * 
-     *   params[<name>] (<reqd>)
-     *   params["order_id"] (true)
-     *   params["amount"] (false) - It represents the requested order size.
-     *   params["contracts"] (false) - It represents the requested order size in contract units and can be passed instead of `amount`
-     *   params["price"] (false) - The order price in base currency (Only for limit and stop_limit orders)
-     *   params["trigger_price"] (false) - Trigger price, required for trigger orders only
-     */
-    void edit(trade_handler::order_params params) override {
+        auto it = m_channels.lower_bound(prefix);
+        if(it == m_channels.end() || it->compare(0, prefix.size(), prefix) != 0)
+            return {};
+        return *it;
+    }
+
+    // a fresh subscription to a book channel starts with a snapshot
+    void resubscribe(std::string_view channel) {
         json request;
         request["params"] = json::object();
+        request["params"]["channels"] = {channel};
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
 
-        if(params.order_id.empty()) {
-            APP_LOG(log_flags::trade_handler, "(deribit) Order ID not specified");
-            return;
+        request["method"] = "private/unsubscribe";
+        send_request(m_md_con_id, request);
+
+        request["method"] = "private/subscribe";
+        send_request(m_md_con_id, request);
+    }
+
+private:
+    // public/auth on one session, waits for the access token
+    // the client credentials are used unless a refresh token is given
+    websocketpp::lib::error_code authenticate(con_id_type con_id, const std::string& refresh_token) {
+        json request;
+
+        request["method"] = "public/auth";
+        request["jsonrpc"] = DERIBIT_JSON_RPC;
+        
+        request["params"] = json::object();
+        if(refresh_token.empty()) {
+            request["params"]["grant_type"] = "client_credentials";
+            request["params"]["client_id"] = m_key.id;
+            request["params"]["client_secret"] = m_key.secret;
+        } else {
+            request["params"]["grant_type"] = "refresh_token";
+            request["params"]["refresh_token"] = refresh_token;
         }
-        request["params"]["order_id"] = params.order_id;
 
-        if(params.amount == -1 && params.contracts == -1) {
-            APP_LOG(log_flags::trade_handler, "(deribit) Must specify atleast amount or contracts");
-            return;
+        websocket_endpoint::send_result result = send_request(con_id, request);
+
+        if(result.ec)
+            return result.ec;
+
+        if(!result.response.valid())
+            return std::make_error_code(std::errc::not_connected);
+
+        // wait for the response to this request and store the access token
+        if(result.response.wait_for(DERIBIT_RESPONSE_TIMEOUT) != std::future_status::ready) {
+            m_endpoint->cancel_request(con_id, request["id"].get<request_id_type>());
+            APP_LOG(log_flags::trade_handler, "Authentication response time exceeded "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(DERIBIT_RESPONSE_TIMEOUT).count() << "ms");
+            return std::make_error_code(std::errc::timed_out);
         }
 
-        if(params.amount != -1 && params.contracts != -1 && params.amount != params.contracts) {
-            APP_LOG(log_flags::trade_handler, "(deribit) amount and contracts must match");
-            return;
+        rpc_response response = result.response.get();
+        json json_response = json::parse(response.payload, nullptr, false);
+
+        if(json_response.is_discarded() || !json_response.contains("result") || !json_response["result"].contains("access_token")) {
+            APP_LOG(log_flags::trade_handler, "(deribit) authentication rejected: " << response.payload);
+            return std::make_error_code(std::errc::permission_denied);
         }
 
-        if(params.amount != -1)
-            request["params"]["amount"] = params.amount;
-        if(params.contracts != -1)
-            request["params"]["contracts"] = params.contracts;
-        if(params.price != -1)
-            request["params"]["price"] = params.price;
-        if(params.trigger_price != -1)
-            request["params"]["trigger_price"] = params.trigger_price;
+        const json& tokens = json_response["result"];
+        {
+            std::lock_guard<std::mutex> lock {m_token_mutex};
+            m_access_token = tokens["access_token"];
+            if(tokens.contains("refresh_token"))
+                m_refresh_token = tokens["refresh_token"];
 
+            APP_LOG(log_flags::trade_handler, "(deribit) access token: " << m_access_token);
+        }
 
-        // specify request details
-        request["method"] = "private/edit";
-        request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
+        return result.ec;
+    }
 
-        APP_LOG(log_flags::trade_handler, "(deribit) Edit order request sent. Check details");
-        m_endpoint->send(m_con_id, request.dump());
+    // validate and send a private/buy or private/sell request
+    rpc_future place_order(std::string_view method, const trade_handler::order_params& params) {
+        if(!validate_order(params) || !check_instrument_rules(params))
+            return {};
+
+        // serialize the request directly into the encoder buffer
+        request_id_type id = m_next_request_id++;
+        std::string_view frame = m_encoder.encode_order(method, id, params);
+        track_order(id, method, params);
+
+        APP_LOG(log_flags::trade_handler, "(deribit) " << method << " order request sent. Check details");
+        return send_frame(id, frame);
     }
 
-    /**
-     * @brief Cancel an order, specified by order id
-     * @param params
-     *   params["order_id"] (true)
-     */
-    void cancel(order_params params) {
-        json request;
+    void track_order(request_id_type id, std::string_view method, const trade_handler::order_params& params) {
+        m_orders.on_sent(id, params.instrument, params.label, method == "private/buy" ? order_direction::buy : order_direction::sell,
+            params.amount.has_value() ? params.amount : params.contracts, params.price);
+    }
 
-        if(params.order_id.empty()) {
-            APP_LOG(log_flags::trade_handler, "Order ID must be specified");
-            return;
+    bool make_order_template(std::string_view method, const trade_handler::order_params& params, deribit_order_template& order_template) {
+        if(!validate_order(params))
+            return false;
+
+        order_template.compile(method, params);
+        return true;
+    }
+
+    // parameters of a private/buy or private/sell request, the reason for a rejection is logged
+    bool validate_order(const trade_handler::order_params& params) {
+        static constexpr unsigned int max_label_len = 64;
+
+        if(params.instrument.empty()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) instrument not specified");
+            return false;
+        }
+
+        if(!params.amount.has_value() && !params.contracts.has_value()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) Must specify atleast amount or contracts");
+            return false;
         }
 
-        request["params"] = { {"order_id", params.order_id} };
+        if(params.amount.has_value() && params.contracts.has_value() && params.amount != params.contracts) {
+            APP_LOG(log_flags::trade_handler, "(deribit) amount and contracts must match");
+            return false;
+        }
 
-        request["method"] = "private/cancel";
-        request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
+        if(params.label.length() > max_label_len) {
+            APP_LOG(log_flags::trade_handler, "(deribit) label length exceeds " << max_label_len << " characters");
+            return false;
+        }
 
-        m_endpoint->send(m_con_id, request.dump());
+        // type, time_in_force and trigger are enums, any value is one deribit accepts
+        if(params.trigger != trade_handler::order_trigger::unset && !params.trigger_price.has_value()) {
+            APP_LOG(log_flags::trade_handler, "(deribit) Trigger price must be specified for trigger orders.");
+            return false;
+        }
+
+        return true;
     }
 
-    /**
-     * @brief Retrieves list of user's open orders across many currencies.
-     * @param params
-     *   params["kind"] (false) - Instrument kind, if not provided instruments of all kinds are considered
-     *   params["type"] (false) - Order type, default - all
-     */
-    virtual void get_open_orders(trade_handler::open_orders_params params) {
-        static constexpr std::array allowed_kinds = {"future", "option", "spot", "future_combo", "option_combo"};
-        static constexpr std::array allowed_types = {"all", "limit", "trigger_all", "stop_all",
-            "stop_limit", "stop_market", "take_all", "take_limit", "take_market", "trailing_all", "trailing_stop"};
+    // frames of the valid orders go out in one write, rejected orders keep an invalid future
+    template<typename Encode>
+    std::vector<rpc_future> send_batch(const trade_handler::order_params* orders, std::size_t count, Encode&& encode) {
+        std::vector<rpc_future> responses(count);
+        m_batched.clear();
+        m_batch.clear();
 
-        json request;
-        request["params"] = json::object();
+        for(std::size_t i = 0; i < count; i++) {
+            request_id_type id = m_next_request_id++;
+            std::string_view frame = encode(id, orders[i]);
 
-        if(!params.kind.empty()) {
-            if(std::find(allowed_kinds.begin(), allowed_kinds.end(), params.kind) == allowed_kinds.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid kind specified: " << params.kind);
-                return;
+            if(!frame.empty()) {
+                m_batch.append_request(id, frame);
+                m_batched.push_back(i);
             }
-
-            request["params"]["kind"] = params.kind;
         }
 
-        if(!params.type.empty()) {
-            if(std::find(allowed_types.begin(), allowed_types.end(), params.type) == allowed_types.end()) {
-                APP_LOG(log_flags::trade_handler, "(deribit) invalid type specified: " << params.type);
-                return;
-            }
+        if(m_batch.empty())
+            return responses;
 
-            request["params"]["type"] = params.type;
-        }
+        m_batch_responses.clear();
+        m_endpoint->send_batch(m_con_id, m_batch, m_batch_responses, m_request_failed);
 
-        request["method"] = "private/get_open_orders";
-        request["jsonrpc"] = DERIBIT_JSON_RPC;
-        request["id"] = DERIBIT_DEFAULT_REQUEST_ID;
+        // no future for any request of a batch which could not be sent
+        for(std::size_t i = m_batch_responses.size(); i < m_batch.size(); i++)
+            m_orders.on_send_failed(m_batch.requests()[i].id);
+
+        for(std::size_t i = 0; i < m_batch_responses.size(); i++)
+            responses[m_batched[i]] = std::move(m_batch_responses[i]);
 
-        m_endpoint->send(m_con_id, request.dump());
+        return responses;
     }
+
+    std::vector<rpc_future> place_orders(std::string_view method, const trade_handler::order_params* orders, std::size_t count) {
+        return send_batch(orders, count, [&](request_id_type id, const trade_handler::order_params& params) {
+            if(!validate_order(params) || !check_instrument_rules(params))
+                return std::string_view{};
+
+            std::string_view frame = m_encoder.encode_order(method, id, params);
+            track_order(id, method, params);
+            return frame;
+        });
+    }
+
+    // send a frame which already carries the request id, an order which could not be sent is not tracked
+    rpc_future send_frame(request_id_type id, std::string_view frame) {
+        rpc_future response = m_endpoint->send_request(m_con_id, id, frame, m_request_failed).response;
+        if(!response.valid())
+            m_orders.on_send_failed(id);
+        return response;
+    }
+
+    // assign a unique id to the request and send it, the response completes the returned future
+    // requests go to the order entry session unless another connection is given
+    websocket_endpoint::send_result send_request(json& request, rpc_callback callback = nullptr) {
+        return send_request(m_con_id, request, std::move(callback));
+    }
+
+    websocket_endpoint::send_result send_request(con_id_type con_id, json& request, rpc_callback callback = nullptr) {
+        request_id_type id = m_next_request_id++;
+        request["id"] = id;
+
+        std::string frame = request.dump();
+        return m_endpoint->send_request(con_id, id, frame, std::move(callback));
+    }
+
 private:
+    // sessions are authenticated from the caller's and the session supervisor's threads
+    std::mutex m_token_mutex;
     std::string m_access_token;
+    std::string m_refresh_token;
+
+    std::mutex m_channels_mutex;
+    std::set<std::string> m_channels; // subscribed channels, restored on a reconnected market data session
+    std::atomic<request_id_type> m_next_request_id {1};
+    deribit_order_encoder m_encoder;
+
+    // batches are built on the caller's thread, like single orders
+    frame_batch m_batch;
+    std::vector<std::size_t> m_batched; // index in the caller's orders of each request in the batch
+    std::vector<rpc_future> m_batch_responses;
+
+    std::chrono::seconds m_heartbeat_interval {DERIBIT_HEARTBEAT_INTERVAL};
+    exchange_clock m_clock;
+    instrument_cache m_instruments; // filled on the order network thread, read by the threads sending orders
+
+    std::mutex m_probe_mutex;
+    std::condition_variable m_probe_cv;
+    std::thread m_probe_thread;
+    bool m_probe_running = false;
+
+    order_manager m_orders; // updated on both network threads, read from any thread
+    std::atomic<bool> m_tracking_orders {false};
+
+    // attached to every order entry request: one which fails without a response (its session went down,
+    // or it expired) is no longer pending, the order is forgotten until a notification or a resync brings it
+    // captures only this, so copying it per request does not allocate
+    const rpc_callback m_request_failed = [this](const rpc_response& response) {
+        if(response.payload.empty())
+            m_orders.on_send_failed(response.id);
+    };
+
+    // only used on the order network thread
+    deribit_message_parser m_order_parser {true}; // parses the orders in responses
+    order_session_listener m_order_listener;
+
+    // only used on the network thread
+    deribit_message_parser m_parser;
+    con_id_type m_receiving_con_id = WS_CON_ERR_CODE; // session of the message being parsed
+    order_book_manager m_books;
+    std::atomic<deribit_feed_listener*> m_feed_listener {nullptr};
 };
\ No newline at end of file
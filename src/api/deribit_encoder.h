@@ -0,0 +1,315 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <api/trade_handler.h>
+
+constexpr std::size_t DERIBIT_ENCODER_CAPACITY = 1024;
+constexpr std::size_t DERIBIT_TEMPLATE_ID_WIDTH = 20;     // digits of the largest request id
+constexpr std::size_t DERIBIT_TEMPLATE_NUMBER_WIDTH = 24; // longest fixed_decimal, eg. -92233720368.54775807
+constexpr std::size_t DERIBIT_TEMPLATE_LABEL_WIDTH = 64;  // longest label deribit accepts
+
+// Helpers writing deribit JSON-RPC frames into a reusable buffer, shared by the encoder and the order templates
+class deribit_frame_writer {
+protected:
+    void begin_frame(request_id_type id, std::string_view method) {
+        m_buffer.clear();
+
+        put("{\"id\":");
+        put_uint(id);
+        put(",\"jsonrpc\":\"2.0\",\"method\":");
+        put_string(method);
+        put(",\"params\":{");
+    }
+
+    std::string_view end_frame() {
+        put("}}");
+        return std::string_view{m_buffer.data(), m_buffer.size()};
+    }
+
+    void put(std::string_view s) { m_buffer.append(s.data(), s.size()); }
+
+    void put_uint(std::uint64_t value) {
+        char digits[20];
+        auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+        m_buffer.append(digits, end - digits);
+    }
+
+    void put_decimal(fixed_decimal value) {
+        char digits[32];
+        char* end = value.to_chars(digits, digits + sizeof(digits));
+        m_buffer.append(digits, end - digits);
+    }
+
+    // escapes the same characters as nlohmann's serializer (without ensure_ascii)
+    void put_string(std::string_view s) {
+        static constexpr char hex[] = "0123456789abcdef";
+
+        m_buffer.push_back('"');
+
+        std::size_t run_start = 0;
+        for(std::size_t i = 0; i < s.size(); i++) {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            if(c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            m_buffer.append(s.data() + run_start, i - run_start);
+            run_start = i + 1;
+
+            switch(c) {
+                case '"':  put("\\\""); break;
+                case '\\': put("\\\\"); break;
+                case '\b': put("\\b"); break;
+                case '\f': put("\\f"); break;
+                case '\n': put("\\n"); break;
+                case '\r': put("\\r"); break;
+                case '\t': put("\\t"); break;
+                default: {
+                    char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                    m_buffer.append(escaped, sizeof(escaped));
+                }
+            }
+        }
+
+        m_buffer.append(s.data() + run_start, s.size() - run_start);
+        m_buffer.push_back('"');
+    }
+
+    void put_decimal_field(const char*& sep, std::string_view key, fixed_decimal value) {
+        put(sep);
+        put(key);
+        put_decimal(value);
+        sep = ",";
+    }
+
+    // tokens never need escaping
+    template<typename Enum>
+    void put_token_field(const char*& sep, std::string_view key, Enum value) {
+        put(sep);
+        put(key);
+        m_buffer.push_back('"');
+        put(to_token(value));
+        m_buffer.push_back('"');
+        sep = ",";
+    }
+
+    void put_string_field(const char*& sep, std::string_view key, std::string_view value) {
+        put(sep);
+        put(key);
+        put_string(value);
+        sep = ",";
+    }
+
+    std::string m_buffer;
+};
+
+// Writes deribit JSON-RPC order frames into a reusable buffer without building a json object.
+// The output is request.dump() of the equivalent nlohmann::json request: keys are emitted in sorted order
+// (json objects are std::map based), except that prices and amounts are written as exact decimals.
+// The returned view is valid until the next encode call, the encoder is not thread-safe.
+class deribit_order_encoder : private deribit_frame_writer {
+public:
+    deribit_order_encoder() { m_buffer.reserve(DERIBIT_ENCODER_CAPACITY); }
+
+    // private/buy and private/sell
+    std::string_view encode_order(std::string_view method, request_id_type id, const trade_handler::order_params& params) {
+        begin_frame(id, method);
+
+        // params are listed in lexicographic order of their keys
+        const char* sep = "";
+        if(params.amount.has_value())
+            put_decimal_field(sep, "\"amount\":", params.amount);
+        if(params.contracts.has_value())
+            put_decimal_field(sep, "\"contracts\":", params.contracts);
+        put_string_field(sep, "\"instrument_name\":", params.instrument);
+        if(!params.label.empty())
+            put_string_field(sep, "\"label\":", params.label);
+        if(params.price.has_value())
+            put_decimal_field(sep, "\"price\":", params.price);
+        if(params.time_in_force != trade_handler::order_time_in_force::unset)
+            put_token_field(sep, "\"time_in_force\":", params.time_in_force);
+        if(params.trigger != trade_handler::order_trigger::unset) {
+            put_token_field(sep, "\"trigger\":", params.trigger);
+            put_decimal_field(sep, "\"trigger_price\":", params.trigger_price);
+        }
+        if(params.type != trade_handler::order_type::unset)
+            put_token_field(sep, "\"type\":", params.type);
+
+        return end_frame();
+    }
+
+    // private/edit
+    std::string_view encode_edit(request_id_type id, const trade_handler::order_params& params) {
+        begin_frame(id, "private/edit");
+
+        const char* sep = "";
+        if(params.amount.has_value())
+            put_decimal_field(sep, "\"amount\":", params.amount);
+        if(params.contracts.has_value())
+            put_decimal_field(sep, "\"contracts\":", params.contracts);
+        put_string_field(sep, "\"order_id\":", params.order_id);
+        if(params.price.has_value())
+            put_decimal_field(sep, "\"price\":", params.price);
+        if(params.trigger_price.has_value())
+            put_decimal_field(sep, "\"trigger_price\":", params.trigger_price);
+
+        return end_frame();
+    }
+
+    // private/cancel
+    std::string_view encode_cancel(request_id_type id, const trade_handler::order_params& params) {
+        begin_frame(id, "private/cancel");
+
+        const char* sep = "";
+        put_string_field(sep, "\"order_id\":", params.order_id);
+
+        return end_frame();
+    }
+
+    std::string_view encode_cancel_all_by_instrument(request_id_type id, std::string_view instrument, std::string_view type) {
+        begin_frame(id, "private/cancel_all_by_instrument");
+
+        const char* sep = "";
+        put_string_field(sep, "\"instrument_name\":", instrument);
+        if(!type.empty())
+            put_string_field(sep, "\"type\":", type);
+
+        return end_frame();
+    }
+
+    std::string_view encode_cancel_by_label(request_id_type id, std::string_view label, trade_handler::currency_code currency) {
+        begin_frame(id, "private/cancel_by_label");
+
+        const char* sep = "";
+        if(currency != trade_handler::currency_code::unset)
+            put_token_field(sep, "\"currency\":", currency);
+        put_string_field(sep, "\"label\":", label);
+
+        return end_frame();
+    }
+};
+
+// A private/buy or private/sell frame for repeated orders on one instrument, serialized once: the id, the
+// size (amount or contracts, as given to compile), the price and the label get fixed-width slots padded
+// with spaces, and frame() only writes the new values into their slots.
+// The frame has the same members and values as the encoder's, the padding is insignificant JSON whitespace.
+// Not thread-safe, the returned view is valid until the next frame() call.
+class deribit_order_template : private deribit_frame_writer {
+public:
+    // params must already be validated, their size, price and label are placeholders
+    // a template compiled without a price or a label has no slot for it
+    void compile(std::string_view method, const trade_handler::order_params& params) {
+        m_instrument = params.instrument;
+        m_buy = method == "private/buy";
+
+        begin_frame(0, method);
+        m_id_slot = m_buffer.find(',') - 1;
+        m_buffer.replace(m_id_slot, 1, DERIBIT_TEMPLATE_ID_WIDTH, ' ');
+
+        // params are listed in lexicographic order of their keys, like encode_order
+        put(params.amount.has_value() ? "\"amount\":" : "\"contracts\":");
+        m_size_slot = put_slot(DERIBIT_TEMPLATE_NUMBER_WIDTH);
+
+        const char* sep = ",";
+        put_string_field(sep, "\"instrument_name\":", params.instrument);
+        m_label_slot = 0;
+        if(!params.label.empty()) {
+            put(",\"label\":");
+            m_label_slot = put_slot(DERIBIT_TEMPLATE_LABEL_WIDTH + 2);
+        }
+        m_price_slot = 0;
+        if(params.price.has_value()) {
+            put(",\"price\":");
+            m_price_slot = put_slot(DERIBIT_TEMPLATE_NUMBER_WIDTH);
+        }
+        if(params.time_in_force != trade_handler::order_time_in_force::unset)
+            put_token_field(sep, "\"time_in_force\":", params.time_in_force);
+        if(params.trigger != trade_handler::order_trigger::unset) {
+            put_token_field(sep, "\"trigger\":", params.trigger);
+            put_decimal_field(sep, "\"trigger_price\":", params.trigger_price);
+        }
+        if(params.type != trade_handler::order_type::unset)
+            put_token_field(sep, "\"type\":", params.type);
+
+        end_frame();
+    }
+
+    bool compiled() const { return !m_buffer.empty(); }
+    bool has_price() const { return m_price_slot != 0; }
+    bool has_label() const { return m_label_slot != 0; }
+
+    // the orders the template places, for tracking them
+    std::string_view instrument() const { return m_instrument; }
+    bool buy() const { return m_buy; }
+
+    // an empty view if the template is not compiled, the size or the price of a template with a price is unset,
+    // or the label has no slot, is too long or would need escaping
+    std::string_view frame(request_id_type id, fixed_decimal size, fixed_decimal price, std::string_view label = {}) {
+        if(!compiled() || !size.has_value() || (m_price_slot && !price.has_value()))
+            return {};
+
+        char digits[DERIBIT_TEMPLATE_ID_WIDTH];
+        auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), id);
+        fill_slot(m_id_slot, DERIBIT_TEMPLATE_ID_WIDTH, digits, end - digits);
+
+        patch_decimal(m_size_slot, size);
+        if(m_price_slot)
+            patch_decimal(m_price_slot, price);
+
+        if(m_label_slot) {
+            if(!patch_label(label))
+                return {};
+        } else if(!label.empty()) {
+            return {};
+        }
+
+        return std::string_view{m_buffer.data(), m_buffer.size()};
+    }
+
+private:
+    // reserve a slot at the end of the buffer, returns its offset
+    std::size_t put_slot(std::size_t width) {
+        std::size_t offset = m_buffer.size();
+        m_buffer.append(width, ' ');
+        return offset;
+    }
+
+    void fill_slot(std::size_t offset, std::size_t width, const char* value, std::size_t length) {
+        std::memcpy(&m_buffer[offset], value, length);
+        std::memset(&m_buffer[offset + length], ' ', width - length);
+    }
+
+    void patch_decimal(std::size_t offset, fixed_decimal value) {
+        char digits[DERIBIT_TEMPLATE_NUMBER_WIDTH];
+        char* end = value.to_chars(digits, digits + sizeof(digits));
+        fill_slot(offset, DERIBIT_TEMPLATE_NUMBER_WIDTH, digits, end - digits);
+    }
+
+    bool patch_label(std::string_view label) {
+        if(label.size() > DERIBIT_TEMPLATE_LABEL_WIDTH)
+            return false;
+
+        for(char c : label) {
+            if(static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\')
+                return false;
+        }
+
+        char* slot = &m_buffer[m_label_slot];
+        slot[0] = '"';
+        std::memcpy(slot + 1, label.data(), label.size());
+        slot[label.size() + 1] = '"';
+        std::memset(slot + label.size() + 2, ' ', DERIBIT_TEMPLATE_LABEL_WIDTH - label.size());
+        return true;
+    }
+
+    std::size_t m_id_slot = 0;
+    std::size_t m_size_slot = 0;
+    std::size_t m_label_slot = 0; // 0 without a label
+    std::size_t m_price_slot = 0; // 0 without a price
+
+    inline_string<trade_handler::instrument_capacity> m_instrument;
+    bool m_buy = false;
+};
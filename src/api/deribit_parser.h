@@ -0,0 +1,572 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <lib/fixed_decimal.h>
+#include <lib/json_scanner.h>
+#include <lib/symbol_table.h>
+#include <lib/token_table.h>
+#include <market/book_update.h>
+
+// Typed views of deribit subscription notifications.
+// String views point into the received payload and are only valid during the listener callback.
+
+struct trade_tick {
+    std::string_view instrument;
+    symbol_id instrument_id = NO_SYMBOL;
+    std::string_view trade_id;
+    std::int64_t trade_seq = 0;
+    std::int64_t timestamp = 0;
+    double price = 0;
+    double amount = 0;
+    bool buy = false; // direction of the taker
+};
+
+// trades.{instrument}.{interval}
+struct trades_update {
+    std::string_view channel;
+    std::vector<trade_tick> trades;
+};
+
+// states of deribit orders, and the local ones of an order tracked by the client (see order_manager)
+enum class order_state : std::uint8_t {
+    unset,
+    pending,          // sent, not acknowledged yet (local)
+    open,
+    partially_filled, // open with a filled amount (local)
+    filled,
+    cancelled,
+    rejected,
+    untriggered
+};
+
+enum class order_direction : std::uint8_t {
+    unset,
+    buy,
+    sell
+};
+
+template<>
+struct enum_tokens<order_state> {
+    static constexpr token_table<order_state, 8> table {{
+        "", "pending", "open", "partially_filled", "filled", "cancelled", "rejected", "untriggered"
+    }};
+};
+
+template<>
+struct enum_tokens<order_direction> {
+    static constexpr token_table<order_direction, 3> table {{"", "buy", "sell"}};
+};
+
+// an order, as sent in user.orders.* notifications and in the responses to order requests
+struct order_update {
+    std::string_view order_id;
+    std::string_view instrument;
+    symbol_id instrument_id = NO_SYMBOL;
+    std::string_view label;
+    order_direction direction = order_direction::unset;
+    order_state state = order_state::unset;
+    fixed_decimal amount;
+    fixed_decimal filled_amount; // cumulative
+    fixed_decimal price;         // unset for market orders
+    fixed_decimal average_price;
+    std::int64_t last_update_timestamp = 0;
+};
+
+// user.orders.{instrument}.raw (one order at a time) and user.orders.{kind}.{currency}.{interval}
+struct orders_update {
+    std::string_view channel;
+    std::vector<order_update> orders;
+};
+
+// a fill of one of the user's orders
+struct user_trade {
+    std::string_view trade_id;
+    std::string_view order_id;
+    std::string_view instrument;
+    symbol_id instrument_id = NO_SYMBOL;
+    order_direction direction = order_direction::unset;
+    order_state state = order_state::unset; // of the order after the trade
+    fixed_decimal amount;
+    fixed_decimal price;
+    std::int64_t timestamp = 0;
+};
+
+// user.trades.{instrument}.{interval} and user.trades.{kind}.{currency}.{interval}
+struct user_trades_update {
+    std::string_view channel;
+    std::vector<user_trade> trades;
+};
+
+// the orders in a response on the order entry session: the order placed, edited or cancelled, or the
+// open orders; none for an error or a response to another request
+struct order_response {
+    std::uint64_t id = 0;
+    bool error = false;
+    std::vector<order_update> orders;
+};
+
+// receives parsed notifications on the network thread
+class deribit_feed_listener {
+public:
+    virtual ~deribit_feed_listener() {}
+
+    virtual void on_book(const book_update& /*update*/) {}
+    virtual void on_trades(const trades_update& /*update*/) {}
+    virtual void on_orders(const orders_update& /*update*/) {}
+    virtual void on_user_trades(const user_trades_update& /*update*/) {}
+    // only from a parser which parses responses
+    virtual void on_order_response(const order_response& /*response*/) {}
+    // subscription channels without a typed parser, data is the raw json value
+    virtual void on_notification(std::string_view /*channel*/, std::string_view /*data*/) {}
+    // method "heartbeat", type is "heartbeat" or "test_request"
+    virtual void on_heartbeat(std::string_view /*type*/) {}
+};
+
+// Parses deribit notifications in a single forward pass and dispatches on method / params.channel.
+// Responses to requests (messages carrying an id) are matched by the request tracker, they are ignored
+// unless the parser parses responses, which it does for the orders they carry (see order_response).
+// Instruments are resolved to their ids from the raw bytes of the payload, an instrument seen for the
+// first time is interned.
+// The update buffers are reused between messages, so parsing allocates only until they reach
+// their working size.
+class deribit_message_parser {
+public:
+    explicit deribit_message_parser(bool parse_responses = false): m_parse_responses{parse_responses} {}
+
+    // returns false if the message could not be parsed
+    bool parse(std::string_view payload, deribit_feed_listener& listener) {
+        json_scanner scanner {payload};
+        std::string_view key;
+        std::string_view method;
+        std::string_view result;
+        bool response = false;
+
+        if(!scanner.enter_object())
+            return false;
+
+        m_response.error = false;
+
+        while(scanner.next_key(key)) {
+            if(key == "id") {
+                if(!m_parse_responses)
+                    return true; // response to a request
+                if(!scanner.read_uint(m_response.id))
+                    return false;
+                response = true;
+            } else if(key == "result") {
+                if(!scanner.skip_value(&result))
+                    return false;
+            } else if(key == "error") {
+                m_response.error = true;
+                if(!scanner.skip_value())
+                    return false;
+            } else if(key == "method") {
+                if(!scanner.read_string(method))
+                    return false;
+            } else if(key == "params") {
+                if(!parse_params(scanner, method, listener))
+                    return false;
+            } else if(!scanner.skip_value()) {
+                return false;
+            }
+        }
+
+        if(scanner.failed())
+            return false;
+
+        if(response)
+            return parse_response(result, listener);
+
+        return true;
+    }
+
+    // a JSON number as an exact decimal, numbers in exponent notation (eg. 1e-4) are rounded to 8 places
+    // anything else (eg. "market_price") leaves the value as it was
+    static bool read_decimal(json_scanner& scanner, fixed_decimal& value) {
+        std::string_view raw;
+        if(!scanner.skip_value(&raw))
+            return false;
+
+        if(fixed_decimal::parse(raw, value))
+            return true;
+
+        double number;
+        if(std::from_chars(raw.data(), raw.data() + raw.size(), number).ec == std::errc())
+            value = fixed_decimal::from_double(number);
+        return true;
+    }
+
+    // the second segment of a channel, eg. BTC-PERPETUAL in book.BTC-PERPETUAL.100ms
+    // (instrument names have no dots)
+    static std::string_view channel_instrument(std::string_view channel) {
+        std::size_t start = channel.find('.');
+        if(start == std::string_view::npos)
+            return {};
+
+        std::size_t end = channel.find('.', start + 1);
+        return channel.substr(start + 1, end == std::string_view::npos ? std::string_view::npos : end - start - 1);
+    }
+
+    // an order object, or an object with the order under "order" (the result of private/buy, sell and edit)
+    static bool read_order(json_scanner& scanner, order_update& order) {
+        std::string_view key;
+        std::string_view text;
+
+        if(!scanner.enter_object())
+            return false;
+
+        while(scanner.next_key(key)) {
+            bool ok = true;
+
+            if(key == "order") {
+                ok = read_order(scanner, order);
+            } else if(key == "order_id") {
+                ok = scanner.read_string(order.order_id);
+            } else if(key == "instrument_name") {
+                ok = scanner.read_string(order.instrument);
+            } else if(key == "label") {
+                ok = scanner.read_string(order.label);
+            } else if(key == "direction") {
+                ok = scanner.read_string(text);
+                parse_token(text, order.direction);
+            } else if(key == "order_state") {
+                ok = scanner.read_string(text);
+                parse_token(text, order.state);
+            } else if(key == "amount") {
+                ok = read_decimal(scanner, order.amount);
+            } else if(key == "filled_amount") {
+                ok = read_decimal(scanner, order.filled_amount);
+            } else if(key == "price") {
+                ok = read_decimal(scanner, order.price);
+            } else if(key == "average_price") {
+                ok = read_decimal(scanner, order.average_price);
+            } else if(key == "last_update_timestamp") {
+                ok = scanner.read_int(order.last_update_timestamp);
+            } else {
+                ok = scanner.skip_value();
+            }
+
+            if(!ok)
+                return false;
+        }
+
+        return !scanner.failed();
+    }
+
+private:
+    // the result is an order, an array of orders or anything else (without orders)
+    bool parse_response(std::string_view result, deribit_feed_listener& listener) {
+        m_response.orders.clear();
+
+        json_scanner scanner {result};
+        bool ok = true;
+
+        if(scanner.peek() == '{') {
+            ok = add_order(scanner, m_response.orders);
+        } else if(scanner.peek() == '[') {
+            scanner.enter_array();
+            while(ok && scanner.next_element())
+                ok = scanner.peek() == '{' ? add_order(scanner, m_response.orders) : scanner.skip_value();
+        }
+
+        if(!ok || scanner.failed())
+            return false;
+
+        listener.on_order_response(m_response);
+        return true;
+    }
+
+    // objects without an order id (eg. positions, instruments) are not orders
+    static bool add_order(json_scanner& scanner, std::vector<order_update>& orders) {
+        order_update order;
+        if(!read_order(scanner, order))
+            return false;
+
+        if(!order.order_id.empty()) {
+            order.instrument_id = instrument_symbols().intern(order.instrument);
+            orders.push_back(order);
+        }
+        return true;
+    }
+
+    bool parse_params(json_scanner& scanner, std::string_view method, deribit_feed_listener& listener) {
+        std::string_view key;
+        std::string_view channel;
+        std::string_view data; // raw data, if it appears before the channel
+
+        if(!scanner.enter_object())
+            return false;
+
+        while(scanner.next_key(key)) {
+            if(key == "channel") {
+                if(!scanner.read_string(channel))
+                    return false;
+            } else if(key == "data" && !channel.empty()) {
+                if(!parse_data(scanner, channel, listener))
+                    return false;
+            } else if(key == "data") {
+                if(!scanner.skip_value(&data))
+                    return false;
+            } else if(key == "type" && method == "heartbeat") {
+                std::string_view type;
+                if(!scanner.read_string(type))
+                    return false;
+                listener.on_heartbeat(type);
+            } else if(!scanner.skip_value()) {
+                return false;
+            }
+        }
+
+        if(scanner.failed())
+            return false;
+
+        if(!data.empty() && !channel.empty()) {
+            json_scanner data_scanner {data};
+            return parse_data(data_scanner, channel, listener);
+        }
+
+        return true;
+    }
+
+    bool parse_data(json_scanner& scanner, std::string_view channel, deribit_feed_listener& listener) {
+        if(channel.compare(0, 5, "book.") == 0) {
+            if(!parse_book(scanner, channel))
+                return false;
+            listener.on_book(m_book);
+        } else if(channel.compare(0, 7, "trades.") == 0) {
+            if(!parse_trades(scanner, channel))
+                return false;
+            listener.on_trades(m_trades);
+        } else if(channel.compare(0, 12, "user.orders.") == 0) {
+            if(!parse_user_orders(scanner, channel))
+                return false;
+            listener.on_orders(m_orders);
+        } else if(channel.compare(0, 12, "user.trades.") == 0) {
+            if(!parse_user_trades(scanner, channel))
+                return false;
+            listener.on_user_trades(m_user_trades);
+        } else {
+            std::string_view data;
+            if(!scanner.skip_value(&data))
+                return false;
+            listener.on_notification(channel, data);
+        }
+
+        return true;
+    }
+
+    bool parse_book(json_scanner& scanner, std::string_view channel) {
+        std::string_view key;
+
+        m_book.channel = channel;
+        m_book.instrument = channel_instrument(channel);
+        m_book.instrument_id = instrument_symbols().intern(m_book.instrument);
+        m_book.snapshot = true;
+        m_book.timestamp = m_book.change_id = m_book.prev_change_id = 0;
+        m_book.bids.clear();
+        m_book.asks.clear();
+
+        if(!scanner.enter_object())
+            return false;
+
+        while(scanner.next_key(key)) {
+            bool ok = true;
+
+            if(key == "type") {
+                std::string_view type;
+                ok = scanner.read_string(type);
+                m_book.snapshot = (type == "snapshot");
+            } else if(key == "instrument_name") {
+                ok = scanner.read_string(m_book.instrument);
+            } else if(key == "timestamp") {
+                ok = scanner.read_int(m_book.timestamp);
+            } else if(key == "change_id") {
+                ok = scanner.read_int(m_book.change_id);
+            } else if(key == "prev_change_id") {
+                ok = scanner.read_int(m_book.prev_change_id);
+            } else if(key == "bids") {
+                ok = parse_levels(scanner, m_book.bids);
+            } else if(key == "asks") {
+                ok = parse_levels(scanner, m_book.asks);
+            } else {
+                ok = scanner.skip_value();
+            }
+
+            if(!ok)
+                return false;
+        }
+
+        return !scanner.failed();
+    }
+
+    // levels are ["new" | "change" | "delete", price, amount] or [price, amount] for grouped books
+    bool parse_levels(json_scanner& scanner, std::vector<book_level>& levels) {
+        if(!scanner.enter_array())
+            return false;
+
+        while(scanner.next_element()) {
+            book_level level {book_action::new_level, 0, 0};
+
+            if(!scanner.enter_array() || !scanner.next_element())
+                return false;
+
+            if(scanner.peek() == '"') {
+                std::string_view action;
+                if(!scanner.read_string(action) || !scanner.next_element())
+                    return false;
+
+                if(action == "change")
+                    level.action = book_action::change;
+                else if(action == "delete")
+                    level.action = book_action::remove;
+            }
+
+            if(!scanner.read_double(level.price) || !scanner.next_element() || !scanner.read_double(level.amount))
+                return false;
+
+            if(scanner.next_element())
+                return false; // unexpected extra field
+
+            levels.push_back(level);
+        }
+
+        return !scanner.failed();
+    }
+
+    bool parse_trades(json_scanner& scanner, std::string_view channel) {
+        m_trades.channel = channel;
+        m_trades.trades.clear();
+
+        if(!scanner.enter_array())
+            return false;
+
+        while(scanner.next_element()) {
+            trade_tick trade;
+            std::string_view key;
+
+            if(!scanner.enter_object())
+                return false;
+
+            while(scanner.next_key(key)) {
+                bool ok = true;
+
+                if(key == "price") {
+                    ok = scanner.read_double(trade.price);
+                } else if(key == "amount") {
+                    ok = scanner.read_double(trade.amount);
+                } else if(key == "direction") {
+                    std::string_view direction;
+                    ok = scanner.read_string(direction);
+                    trade.buy = (direction == "buy");
+                } else if(key == "timestamp") {
+                    ok = scanner.read_int(trade.timestamp);
+                } else if(key == "trade_seq") {
+                    ok = scanner.read_int(trade.trade_seq);
+                } else if(key == "trade_id") {
+                    ok = scanner.read_string(trade.trade_id);
+                } else if(key == "instrument_name") {
+                    ok = scanner.read_string(trade.instrument);
+                } else {
+                    ok = scanner.skip_value();
+                }
+
+                if(!ok)
+                    return false;
+            }
+
+            if(scanner.failed())
+                return false;
+
+            trade.instrument_id = instrument_symbols().intern(trade.instrument);
+            m_trades.trades.push_back(trade);
+        }
+
+        return !scanner.failed();
+    }
+
+    // one order for raw channels, an array of orders for the others
+    bool parse_user_orders(json_scanner& scanner, std::string_view channel) {
+        m_orders.channel = channel;
+        m_orders.orders.clear();
+
+        if(scanner.peek() == '{')
+            return add_order(scanner, m_orders.orders);
+
+        if(!scanner.enter_array())
+            return false;
+
+        while(scanner.next_element()) {
+            if(!add_order(scanner, m_orders.orders))
+                return false;
+        }
+
+        return !scanner.failed();
+    }
+
+    bool parse_user_trades(json_scanner& scanner, std::string_view channel) {
+        m_user_trades.channel = channel;
+        m_user_trades.trades.clear();
+
+        if(!scanner.enter_array())
+            return false;
+
+        while(scanner.next_element()) {
+            user_trade trade;
+            std::string_view key;
+            std::string_view text;
+
+            if(!scanner.enter_object())
+                return false;
+
+            while(scanner.next_key(key)) {
+                bool ok = true;
+
+                if(key == "trade_id") {
+                    ok = scanner.read_string(trade.trade_id);
+                } else if(key == "order_id") {
+                    ok = scanner.read_string(trade.order_id);
+                } else if(key == "instrument_name") {
+                    ok = scanner.read_string(trade.instrument);
+                } else if(key == "direction") {
+                    ok = scanner.read_string(text);
+                    parse_token(text, trade.direction);
+                } else if(key == "state") {
+                    ok = scanner.read_string(text);
+                    parse_token(text, trade.state);
+                } else if(key == "amount") {
+                    ok = read_decimal(scanner, trade.amount);
+                } else if(key == "price") {
+                    ok = read_decimal(scanner, trade.price);
+                } else if(key == "timestamp") {
+                    ok = scanner.read_int(trade.timestamp);
+                } else {
+                    ok = scanner.skip_value();
+                }
+
+                if(!ok)
+                    return false;
+            }
+
+            if(scanner.failed())
+                return false;
+
+            trade.instrument_id = instrument_symbols().intern(trade.instrument);
+            m_user_trades.trades.push_back(trade);
+        }
+
+        return !scanner.failed();
+    }
+
+private:
+    const bool m_parse_responses;
+
+    book_update m_book;
+    trades_update m_trades;
+    orders_update m_orders;
+    user_trades_update m_user_trades;
+    order_response m_response;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include <lib/latency_histogram.h>
+#include <lib/tsc_clock.h>
+
+constexpr std::size_t EXCHANGE_CLOCK_WINDOW = 16; // samples the offset is chosen from
+
+// Round trip time to the exchange and offset of the exchange clock, estimated from requests returning
+// the exchange time (eg. public/get_time), in the manner of NTP:
+// - the exchange is assumed to read its clock halfway through the round trip
+// - the offset comes from the sample with the lowest round trip of the last EXCHANGE_CLOCK_WINDOW,
+//   the one least distorted by queuing on either path
+// - the round trip is smoothed like TCP's SRTT (1/8 weight for a new sample)
+// Samples are added from a network thread, the estimates can be read from any thread.
+class exchange_clock {
+public:
+    struct estimate {
+        std::uint64_t samples = 0;
+        std::int64_t rtt_ns = 0;     // smoothed round trip
+        std::int64_t min_rtt_ns = 0; // round trip of the sample the offset comes from
+        std::int64_t offset_ns = 0;  // exchange time (ns since the unix epoch) - tsc_clock time
+        std::int64_t skew_ns = 0;    // exchange clock - local system_clock
+
+        bool valid() const { return samples > 0; }
+    };
+
+    // round trips are only kept in the estimate once the latency registry is full
+    exchange_clock(): m_rtt_histogram(latency_registry::instance().histogram("exchange_rtt")) {}
+
+    // exchange_time_ms: the exchange clock read while handling a request sent at `sent` and answered at `received`
+    void add_sample(tsc_clock::time_point sent, std::int64_t exchange_time_ms, tsc_clock::time_point received) {
+        std::int64_t rtt = (received - sent).count();
+        if(rtt < 0)
+            return;
+
+        if(m_rtt_histogram)
+            m_rtt_histogram->record(rtt);
+
+        std::int64_t midpoint = sent.time_since_epoch().count() + rtt / 2;
+        // the exchange reports milliseconds, take the middle of the millisecond
+        std::int64_t exchange_ns = exchange_time_ms * 1000000 + 500000;
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        m_window[m_samples % EXCHANGE_CLOCK_WINDOW] = {rtt, exchange_ns - midpoint};
+        m_samples++;
+
+        const sample* best = &m_window[0];
+        for(std::size_t i = 1; i < std::min<std::uint64_t>(m_samples, EXCHANGE_CLOCK_WINDOW); i++) {
+            if(m_window[i].rtt < best->rtt)
+                best = &m_window[i];
+        }
+
+        m_estimate.samples = m_samples;
+        m_estimate.rtt_ns = m_estimate.rtt_ns ? m_estimate.rtt_ns + (rtt - m_estimate.rtt_ns) / 8 : rtt;
+        m_estimate.min_rtt_ns = best->rtt;
+        m_estimate.offset_ns = best->offset;
+        m_estimate.skew_ns = best->offset - system_clock_offset();
+
+        m_offset.store(best->offset, std::memory_order_relaxed);
+        m_valid.store(true, std::memory_order_release);
+    }
+
+    estimate get() const {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        return m_estimate;
+    }
+
+    bool valid() const { return m_valid.load(std::memory_order_acquire); }
+
+    // a local time point in exchange time, ns since the unix epoch (the local system_clock until the first sample)
+    std::int64_t to_exchange_time(tsc_clock::time_point tp) const {
+        std::int64_t offset = valid() ? m_offset.load(std::memory_order_relaxed) : system_clock_offset();
+        return tp.time_since_epoch().count() + offset;
+    }
+
+    std::int64_t exchange_now() const { return to_exchange_time(tsc_clock::now()); }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        m_samples = 0;
+        m_estimate = estimate{};
+        m_valid.store(false, std::memory_order_release);
+    }
+
+private:
+    struct sample {
+        std::int64_t rtt;
+        std::int64_t offset;
+    };
+
+    // system_clock - tsc_clock, ns
+    static std::int64_t system_clock_offset() {
+        auto wall_clock = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        return wall_clock.count() - tsc_clock::now().time_since_epoch().count();
+    }
+
+    latency_histogram* m_rtt_histogram; // nullptr if the latency registry was full
+    std::atomic<std::int64_t> m_offset {0};
+    std::atomic<bool> m_valid {false};
+
+    mutable std::mutex m_mutex;
+    std::array<sample, EXCHANGE_CLOCK_WINDOW> m_window {};
+    std::uint64_t m_samples = 0;
+    estimate m_estimate;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <api/trade_handler.h>
+#include <lib/fixed_decimal.h>
+#include <lib/symbol_table.h>
+
+// Trading rules of an instrument, as given by the exchange
+struct instrument_info {
+    fixed_decimal tick_size;        // prices are multiples of it
+    fixed_decimal contract_size;    // amount of one contract
+    fixed_decimal min_trade_amount; // amounts are multiples of it, and at least it
+    trade_handler::instrument_kind kind = trade_handler::instrument_kind::unset;
+
+    // prices and amounts as integer counts of ticks and lots, exact for values on the grid
+    std::int64_t ticks(fixed_decimal price) const { return price.units() / tick_size.units(); }
+    fixed_decimal price(std::int64_t ticks) const { return fixed_decimal::from_units(ticks * tick_size.units()); }
+    std::int64_t lots(fixed_decimal amount) const { return amount.units() / min_trade_amount.units(); }
+    fixed_decimal amount(std::int64_t lots) const { return fixed_decimal::from_units(lots * min_trade_amount.units()); }
+
+    bool valid() const {
+        return tick_size.has_value() && tick_size.units() > 0 && min_trade_amount.has_value() && min_trade_amount.units() > 0;
+    }
+
+    bool operator==(const instrument_info& other) const {
+        return tick_size == other.tick_size && contract_size == other.contract_size
+            && min_trade_amount == other.min_trade_amount && kind == other.kind;
+    }
+    bool operator!=(const instrument_info& other) const { return !(*this == other); }
+};
+
+// Trading rules of the instruments of an exchange, loaded once at startup, so that an order the
+// exchange would reject for its price or amount is rejected locally instead of after a round trip.
+// Rules are kept in a flat table indexed by instrument id (see instrument_symbols).
+// Instruments are added from one thread at a time (eg. the network thread parsing the response which
+// lists them) and looked up lock-free from any thread. Adding an instrument again replaces its rules:
+// the new rules are published as a new immutable copy, the replaced ones stay valid (for the threads
+// which may still read them) until the cache is destroyed. Rules rarely change, a reload which finds
+// them unchanged allocates nothing.
+class instrument_cache {
+public:
+    instrument_cache(): m_entries(std::make_unique<std::atomic<const instrument_info*>[]>(symbol_table::capacity)) {}
+
+    instrument_cache(const instrument_cache&) = delete;
+    instrument_cache& operator=(const instrument_cache&) = delete;
+
+    // false if the rules are invalid or the cache is full
+    bool add(std::string_view instrument, const instrument_info& info) {
+        if(!info.valid())
+            return false;
+
+        symbol_id id = instrument_symbols().intern(instrument);
+        if(id == NO_SYMBOL)
+            return false;
+
+        std::atomic<const instrument_info*>& entry = m_entries[id];
+        const instrument_info* current = entry.load(std::memory_order_relaxed);
+        if(current && *current == info)
+            return true;
+
+        m_versions.push_back(std::make_unique<const instrument_info>(info));
+        entry.store(m_versions.back().get(), std::memory_order_release);
+        if(!current)
+            m_count.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    symbol_id find(std::string_view instrument) const { return instrument_symbols().find(instrument); }
+
+    // nullptr for an instrument which is not in the cache
+    const instrument_info* get(symbol_id id) const {
+        if(id >= symbol_table::capacity)
+            return nullptr;
+        return m_entries[id].load(std::memory_order_acquire);
+    }
+
+    const instrument_info* get(std::string_view instrument) const { return get(find(instrument)); }
+
+    std::string_view name(symbol_id id) const { return instrument_symbols().name(id); }
+
+    std::size_t size() const { return m_count.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    // the reason the exchange would reject the price or the amount of an order, empty if it would not
+    // an empty cache has no rules to check, every order passes
+    std::string_view check(const trade_handler::order_params& params) const {
+        if(empty())
+            return {};
+
+        const instrument_info* info = get(std::string_view{params.instrument});
+        if(!info)
+            return "unknown instrument";
+
+        // options have coarser ticks above some prices, the smallest one is only a necessary condition
+        if(params.price.has_value() && params.price.units() % info->tick_size.units() != 0)
+            return "price is not a multiple of the tick size";
+
+        if(params.trigger_price.has_value() && params.trigger_price.units() % info->tick_size.units() != 0)
+            return "trigger price is not a multiple of the tick size";
+
+        fixed_decimal amount = params.amount.has_value() ? params.amount : contracts_amount(params.contracts, *info);
+        if(!amount.has_value())
+            return "contracts out of range";
+
+        if(amount < info->min_trade_amount)
+            return "amount is below the minimum trade amount";
+
+        if(amount.units() % info->min_trade_amount.units() != 0)
+            return "amount is not a multiple of the minimum trade amount";
+
+        return {};
+    }
+
+private:
+    // contracts * contract_size, unset if out of range or if either is unset
+    static fixed_decimal contracts_amount(fixed_decimal contracts, const instrument_info& info) {
+        if(!contracts.has_value() || !info.contract_size.has_value())
+            return {};
+
+        __int128 units = static_cast<__int128>(contracts.units()) * info.contract_size.units() / fixed_decimal::scale;
+        if(units <= INT64_MIN || units > INT64_MAX)
+            return {};
+        return fixed_decimal::from_units(static_cast<std::int64_t>(units));
+    }
+
+    std::unique_ptr<std::atomic<const instrument_info*>[]> m_entries; // indexed by symbol id, current rules
+    std::vector<std::unique_ptr<const instrument_info>> m_versions;   // every version of the rules published
+    std::atomic<std::size_t> m_count {0};
+};
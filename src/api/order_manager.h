@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <api/trade_handler.h>
+#include <api/deribit_parser.h>
+#include <lib/inline_string.h>
+#include <lib/symbol_table.h>
+
+constexpr std::size_t ORDER_MANAGER_HISTORY = 4096; // closed orders kept for lookups, the oldest are forgotten
+
+// an order as known locally
+struct tracked_order {
+    inline_string<trade_handler::order_id_capacity> order_id; // empty until acknowledged
+    inline_string<trade_handler::label_capacity> label;
+    symbol_id instrument = NO_SYMBOL;
+    order_direction direction = order_direction::unset;
+    order_state state = order_state::unset;
+    fixed_decimal amount;
+    fixed_decimal filled_amount;
+    fixed_decimal price;
+    fixed_decimal average_price;
+    std::uint64_t request_id = 0;           // of the request which placed it, 0 if placed elsewhere
+    std::int64_t last_update_timestamp = 0; // exchange time (ms) of the last update applied
+
+    bool is_open() const { return is_open(state); }
+
+    static bool is_open(order_state state) {
+        return state == order_state::pending || state == order_state::open || state == order_state::partially_filled
+            || state == order_state::untriggered;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const tracked_order& order) {
+        os << (order.order_id.empty() ? std::string_view{"(pending)"} : std::string_view{order.order_id}) << " "
+           << instrument_symbols().name(order.instrument) << " " << order.direction << " " << order.amount
+           << " @ " << order.price << ", " << order.state << ", filled " << order.filled_amount;
+        if(order.average_price.has_value())
+            os << " @ " << order.average_price;
+        if(!order.label.empty())
+            os << ", label " << order.label;
+        return os;
+    }
+};
+
+// State of the user's orders kept locally, so that what is open (on an instrument, under a label...) is
+// known without a round trip to the exchange.
+// An order is pending from the moment its request is sent, then updated from:
+// - the response to its request, with its order id, or rejected
+// - user.orders.* notifications, with its state and cumulative filled amount
+// - user.trades.* notifications, fills applied only when newer than the last order update, since a fill
+//   is reported on both channels and the order update is authoritative
+// Orders placed elsewhere (eg. the web interface, an earlier run) are tracked from their first update,
+// eg. the response to private/get_open_orders at startup. An order notified before its response is
+// tracked twice, pending and by order id, until the response merges them.
+// A pending order whose request fails without a response (its session went down, or it expired) is
+// forgotten: the exchange may still have accepted it, which a notification or a resync with
+// private/get_open_orders then brings as a single order.
+// Orders are found by order id or label through hash indexes, and listed per instrument from a flat table
+// indexed by instrument id. Updates come from the network threads and queries from any thread, under one
+// mutex; queries copy the orders out.
+class order_manager {
+public:
+    order_manager(): m_open(std::make_unique<std::vector<std::uint32_t>[]>(symbol_table::capacity)) {}
+
+    order_manager(const order_manager&) = delete;
+    order_manager& operator=(const order_manager&) = delete;
+
+    // an order about to be sent, registered before the request is written so that its response finds it
+    void on_sent(std::uint64_t request_id, std::string_view instrument, std::string_view label, order_direction direction,
+        fixed_decimal amount, fixed_decimal price) {
+        symbol_id instrument_id = instrument_symbols().intern(instrument);
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        std::uint32_t index = allocate(request_id, label);
+        tracked_order& order = m_orders[index];
+        order.direction = direction;
+        order.amount = amount;
+        order.price = price;
+
+        set_instrument(index, instrument_id);
+        set_state(index, order_state::pending);
+        m_pending[request_id] = index;
+    }
+
+    // the request of a pending order could not be sent or got no response, the order is forgotten
+    void on_send_failed(std::uint64_t request_id) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        auto pending = m_pending.find(request_id);
+        if(pending == m_pending.end())
+            return;
+
+        std::uint32_t index = pending->second;
+        m_pending.erase(pending);
+        forget(index);
+    }
+
+    // the response to a request on the order entry session: the ack or rejection of a pending order,
+    // or orders for any other request (edit, cancel, get_open_orders)
+    void apply(const order_response& response) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        auto pending = m_pending.find(response.id);
+        if(pending == m_pending.end()) {
+            for(const order_update& update : response.orders)
+                update_order(update);
+            return;
+        }
+
+        std::uint32_t index = pending->second;
+        m_pending.erase(pending);
+
+        if(response.error || response.orders.empty()) {
+            set_state(index, order_state::rejected);
+            return;
+        }
+
+        const order_update& update = response.orders.front();
+        auto known = m_by_order_id.find(update.order_id);
+
+        // a notification of the order arrived before the response
+        if(known != m_by_order_id.end()) {
+            m_orders[known->second].request_id = response.id;
+            forget(index);
+            index = known->second;
+        } else {
+            set_order_id(index, update.order_id);
+        }
+
+        update_order(index, update);
+    }
+
+    void apply(const orders_update& update) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        for(const order_update& order : update.orders)
+            update_order(order);
+    }
+
+    void apply(const user_trades_update& update) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        for(const user_trade& trade : update.trades) {
+            auto known = m_by_order_id.find(trade.order_id);
+            if(known == m_by_order_id.end())
+                continue; // its order update brings it
+
+            tracked_order& order = m_orders[known->second];
+            if(trade.timestamp <= order.last_update_timestamp || !trade.amount.has_value())
+                continue;
+
+            order.filled_amount = fixed_decimal::from_units((order.filled_amount.has_value() ? order.filled_amount.units() : 0) + trade.amount.units());
+            order.last_update_timestamp = trade.timestamp;
+            set_state(known->second, local_state(trade.state != order_state::unset ? trade.state : order.state, order.filled_amount));
+        }
+    }
+
+    // false if no order has the id
+    bool find(std::string_view order_id, tracked_order& order) const {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        auto known = m_by_order_id.find(order_id);
+        if(known == m_by_order_id.end())
+            return false;
+
+        order = m_orders[known->second];
+        return true;
+    }
+
+    // the orders with a label, open or not, returns their number
+    std::size_t find_by_label(std::string_view label, std::vector<tracked_order>& orders) const {
+        orders.clear();
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        auto [first, last] = m_by_label.equal_range(label);
+        for(auto it = first; it != last; ++it)
+            orders.push_back(m_orders[it->second]);
+
+        return orders.size();
+    }
+
+    // the open orders of an instrument, pending ones included, returns their number
+    std::size_t open_orders(symbol_id instrument, std::vector<tracked_order>& orders) const {
+        orders.clear();
+        if(instrument >= symbol_table::capacity)
+            return 0;
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        for(std::uint32_t index : m_open[instrument])
+            orders.push_back(m_orders[index]);
+
+        return orders.size();
+    }
+
+    std::size_t open_orders(std::string_view instrument, std::vector<tracked_order>& orders) const {
+        return open_orders(instrument_symbols().find(instrument), orders);
+    }
+
+    // every open order
+    std::size_t open_orders(std::vector<tracked_order>& orders) const {
+        orders.clear();
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        for(const tracked_order& order : m_orders) {
+            if(order.is_open())
+                orders.push_back(order);
+        }
+
+        return orders.size();
+    }
+
+    struct stats {
+        std::size_t tracked = 0;
+        std::size_t open = 0; // pending included
+        std::size_t pending = 0;
+    };
+
+    stats get_stats() const {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        return {m_orders.size() - m_free.size(), m_open_count, m_pending.size()};
+    }
+
+private:
+    static constexpr std::uint32_t no_index = ~std::uint32_t{0};
+
+    // an open order with a filled amount is partially filled
+    static order_state local_state(order_state state, fixed_decimal filled_amount) {
+        if(state == order_state::open && filled_amount.has_value() && filled_amount.units() > 0)
+            return order_state::partially_filled;
+        return state;
+    }
+
+    // apply an update to the order with its id, tracking it if it is new
+    void update_order(const order_update& update) {
+        if(update.order_id.empty())
+            return;
+
+        auto known = m_by_order_id.find(update.order_id);
+        if(known != m_by_order_id.end()) {
+            update_order(known->second, update);
+            return;
+        }
+
+        std::uint32_t index = allocate(0, update.label);
+        set_order_id(index, update.order_id);
+        update_order(index, update);
+    }
+
+    // updates older than the last one applied are ignored
+    void update_order(std::uint32_t index, const order_update& update) {
+        tracked_order& order = m_orders[index];
+        if(update.last_update_timestamp < order.last_update_timestamp)
+            return;
+
+        order.last_update_timestamp = update.last_update_timestamp;
+        if(order.direction == order_direction::unset)
+            order.direction = update.direction;
+        if(update.amount.has_value())
+            order.amount = update.amount;
+        if(update.filled_amount.has_value())
+            order.filled_amount = update.filled_amount;
+        if(update.price.has_value())
+            order.price = update.price;
+        if(update.average_price.has_value())
+            order.average_price = update.average_price;
+
+        if(order.instrument == NO_SYMBOL)
+            set_instrument(index, update.instrument_id);
+        if(update.state != order_state::unset)
+            set_state(index, local_state(update.state, order.filled_amount));
+    }
+
+    std::uint32_t allocate(std::uint64_t request_id, std::string_view label) {
+        std::uint32_t index;
+        if(!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+            m_orders[index] = tracked_order{};
+        } else {
+            index = static_cast<std::uint32_t>(m_orders.size());
+            m_orders.emplace_back();
+        }
+
+        tracked_order& order = m_orders[index];
+        order.request_id = request_id;
+        if(order.label.assign(label) && !order.label.empty())
+            m_by_label.emplace(std::string_view{order.label}, index);
+
+        return index;
+    }
+
+    // the indexes view the strings of the order, which stay in place (a deque never moves its elements)
+    void set_order_id(std::uint32_t index, std::string_view order_id) {
+        tracked_order& order = m_orders[index];
+        if(order.order_id.assign(order_id))
+            m_by_order_id.emplace(std::string_view{order.order_id}, index);
+    }
+
+    void set_instrument(std::uint32_t index, symbol_id instrument) {
+        tracked_order& order = m_orders[index];
+        if(order.instrument != NO_SYMBOL || instrument >= symbol_table::capacity)
+            return;
+
+        order.instrument = instrument;
+        if(order.is_open())
+            m_open[instrument].push_back(index);
+    }
+
+    // keeps the open lists and the history of closed orders
+    void set_state(std::uint32_t index, order_state state) {
+        tracked_order& order = m_orders[index];
+        bool was_open = order.is_open();
+        bool was_closed = !was_open && order.state != order_state::unset;
+        bool now_open = tracked_order::is_open(state);
+        order.state = state;
+
+        if(now_open) {
+            if(!was_open) {
+                m_open_count++;
+                if(order.instrument != NO_SYMBOL)
+                    m_open[order.instrument].push_back(index);
+            }
+            return;
+        }
+
+        if(was_closed)
+            return;
+
+        // first seen closed (eg. a notification of an order placed elsewhere) or just closed
+        if(was_open) {
+            m_open_count--;
+            if(order.instrument != NO_SYMBOL)
+                remove_open(order.instrument, index);
+        }
+
+        m_closed.push_back(index);
+        if(m_closed.size() > ORDER_MANAGER_HISTORY) {
+            std::uint32_t oldest = m_closed.front();
+            m_closed.pop_front();
+
+            if(!m_orders[oldest].is_open())
+                forget(oldest);
+        }
+    }
+
+    void remove_open(symbol_id instrument, std::uint32_t index) {
+        std::vector<std::uint32_t>& open = m_open[instrument];
+        auto it = std::find(open.begin(), open.end(), index);
+        if(it != open.end()) {
+            *it = open.back();
+            open.pop_back();
+        }
+    }
+
+    // drop an order from every index and reuse its slot
+    void forget(std::uint32_t index) {
+        tracked_order& order = m_orders[index];
+
+        if(order.is_open()) {
+            m_open_count--;
+            if(order.instrument != NO_SYMBOL)
+                remove_open(order.instrument, index);
+        }
+
+        if(!order.order_id.empty())
+            m_by_order_id.erase(std::string_view{order.order_id});
+
+        auto [first, last] = m_by_label.equal_range(std::string_view{order.label});
+        for(auto it = first; it != last; ++it) {
+            if(it->second == index) {
+                m_by_label.erase(it);
+                break;
+            }
+        }
+
+        order = tracked_order{};
+        m_free.push_back(index);
+    }
+
+private:
+    mutable std::mutex m_mutex;
+
+    std::deque<tracked_order> m_orders;
+    std::vector<std::uint32_t> m_free;   // slots of forgotten orders
+    std::deque<std::uint32_t> m_closed;  // closed orders, oldest first
+
+    std::unordered_map<std::string_view, std::uint32_t> m_by_order_id;
+    std::unordered_multimap<std::string_view, std::uint32_t> m_by_label;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_pending; // by request id
+
+    std::unique_ptr<std::vector<std::uint32_t>[]> m_open; // open orders by instrument id
+    std::size_t m_open_count = 0;
+};
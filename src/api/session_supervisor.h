@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <api/trade_handler.h>
+#include <lib/latency_histogram.h>
+#include <lib/tsc_clock.h>
+#include <lib/utilities.h>
+
+// Keeps the sessions of a trade handler up. A failed session is reconnected with exponential backoff,
+// authenticated again and its subscriptions restored, on the supervisor's own thread.
+// The order entry session also has a hot standby, opened and authenticated in advance: when the order
+// entry session fails the standby becomes the active session right away, on the network thread which
+// reported the failure, and a new standby is prepared in the background.
+class session_supervisor : private session_observer {
+public:
+    struct options {
+        bool standby = true; // keep an authenticated standby for the order entry session
+        std::chrono::milliseconds initial_backoff {100};
+        std::chrono::milliseconds max_backoff {10000};
+        std::chrono::milliseconds open_timeout {5000}; // for a new session to complete its handshakes
+    };
+
+    struct stats {
+        std::uint64_t failovers = 0;       // order entry session replaced by the standby
+        std::uint64_t reconnects = 0;      // sessions replaced by a new connection
+        std::uint64_t failed_attempts = 0; // connections which could not be opened or authenticated
+        con_id_type standby = WS_CON_ERR_CODE;
+    };
+
+    explicit session_supervisor(trade_handler& handler): session_supervisor(handler, options{}) {}
+
+    session_supervisor(trade_handler& handler, options opts)
+        : m_handler(handler)
+        , m_options(opts)
+        , m_failover_latency(latency_registry::instance().histogram("session_failover")) {}
+
+    ~session_supervisor() { stop(); }
+
+    session_supervisor(const session_supervisor&) = delete;
+    session_supervisor& operator=(const session_supervisor&) = delete;
+
+    // supervise the handler's active sessions, they must already be connected and authenticated
+    void start() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        if(m_running)
+            return;
+
+        m_running = true;
+        m_handler.set_session_observer(this);
+        m_thread = std::thread(&session_supervisor::run, this);
+    }
+
+    // the standby is closed, the active sessions are left as they are
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            if(!m_running)
+                return;
+
+            m_running = false;
+        }
+
+        m_cv.notify_all();
+        m_thread.join();
+        m_handler.set_session_observer(nullptr);
+
+        con_id_type standby;
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            standby = m_standby;
+            m_standby = WS_CON_ERR_CODE;
+        }
+        m_handler.close_session(standby, "supervisor stopped");
+    }
+
+    stats get_stats() const {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        stats result = m_stats;
+        result.standby = m_standby;
+        return result;
+    }
+
+private:
+    typedef trade_handler::session_kind session_kind;
+
+    // a session being opened by the supervisor
+    struct pending_session {
+        bool open = false;
+        bool down = false;
+    };
+
+    void on_session_open(con_id_type id) override {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_pending[id].open = true;
+        }
+        m_cv.notify_all();
+    }
+
+    void on_session_down(con_id_type id) override {
+        tsc_clock::time_point start = tsc_clock::now();
+        bool failed_over = false;
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+
+            auto it = m_pending.find(id);
+            if(it != m_pending.end())
+                it->second.down = true;
+
+            if(!m_running)
+                return;
+
+            if(id == m_handler.active_session(session_kind::order_entry)) {
+                if(m_standby != WS_CON_ERR_CODE) {
+                    // fail over without waiting for a new connection
+                    m_handler.activate_session(session_kind::order_entry, m_standby);
+                    m_standby = WS_CON_ERR_CODE;
+                    m_stats.failovers++;
+                    if(m_failover_latency)
+                        m_failover_latency->record((tsc_clock::now() - start).count());
+                    failed_over = true;
+
+                    APP_LOG(log_flags::trade_handler, "(supervisor) order entry session " << id << " down, failed over to "
+                        << m_handler.active_session(session_kind::order_entry));
+                } else {
+                    m_order_down = true;
+                    APP_LOG(log_flags::trade_handler, "(supervisor) order entry session " << id << " down, reconnecting");
+                }
+            } else if(id == m_handler.active_session(session_kind::market_data)) {
+                m_market_data_down = true;
+                APP_LOG(log_flags::trade_handler, "(supervisor) market data session " << id << " down, reconnecting");
+            } else if(id == m_standby) {
+                m_standby = WS_CON_ERR_CODE;
+            }
+        }
+        m_cv.notify_all();
+
+        // the resync sends a request, not under the lock which the supervisor thread waits on
+        if(failed_over)
+            m_handler.resync_session(session_kind::order_entry);
+    }
+
+    void run() {
+        std::chrono::milliseconds backoff = m_options.initial_backoff;
+        std::unique_lock<std::mutex> lock {m_mutex};
+
+        while(m_running) {
+            bool order_down = m_order_down;
+            bool market_data_down = m_market_data_down;
+            bool need_standby = m_options.standby && m_standby == WS_CON_ERR_CODE;
+
+            if(!order_down && !market_data_down && !need_standby) {
+                m_cv.wait(lock);
+                continue;
+            }
+
+            lock.unlock();
+
+            // the active sessions come first, the standby is prepared once they are up
+            bool ok = true;
+            if(order_down)
+                ok = replace(session_kind::order_entry) && ok;
+            if(market_data_down)
+                ok = replace(session_kind::market_data) && ok;
+            if(need_standby && ok)
+                ok = prepare_standby();
+
+            lock.lock();
+
+            if(ok) {
+                backoff = m_options.initial_backoff;
+                continue;
+            }
+
+            m_cv.wait_for(lock, backoff, [this] { return !m_running; });
+            backoff = std::min(backoff * 2, m_options.max_backoff);
+        }
+    }
+
+    // make a new session the active one of its kind
+    bool replace(session_kind kind) {
+        con_id_type id = establish(kind);
+        if(id == WS_CON_ERR_CODE)
+            return false;
+
+        std::unique_lock<std::mutex> lock {m_mutex};
+
+        // the session may have failed between its authentication and now
+        bool down = m_pending[id].down;
+        m_pending.erase(id);
+        if(down || !m_running) {
+            m_stats.failed_attempts++;
+            lock.unlock();
+
+            m_handler.close_session(id, "supervisor stopped");
+            return false;
+        }
+
+        m_handler.activate_session(kind, id);
+        (kind == session_kind::order_entry ? m_order_down : m_market_data_down) = false;
+        m_stats.reconnects++;
+        lock.unlock();
+
+        m_handler.resync_session(kind);
+
+        APP_LOG(log_flags::trade_handler, "(supervisor) " << (kind == session_kind::order_entry ? "order entry" : "market data")
+            << " session reconnected as " << id);
+        return true;
+    }
+
+    bool prepare_standby() {
+        con_id_type id = establish(session_kind::order_entry);
+        if(id == WS_CON_ERR_CODE)
+            return false;
+
+        std::unique_lock<std::mutex> lock {m_mutex};
+
+        bool down = m_pending[id].down;
+        m_pending.erase(id);
+        if(down || !m_running) {
+            m_stats.failed_attempts++;
+            lock.unlock();
+
+            m_handler.close_session(id, "supervisor stopped");
+            return false;
+        }
+
+        m_standby = id;
+        return true;
+    }
+
+    // open, authenticate and restore a session, it stays pending until the caller takes it
+    con_id_type establish(session_kind kind) {
+        con_id_type id = m_handler.open_session(kind);
+
+        std::unique_lock<std::mutex> lock {m_mutex};
+        if(id == WS_CON_ERR_CODE) {
+            m_stats.failed_attempts++;
+            return id;
+        }
+
+        pending_session& pending = m_pending[id];
+        m_cv.wait_for(lock, m_options.open_timeout, [&] { return pending.open || pending.down || !m_running; });
+
+        bool open = pending.open && !pending.down && m_running;
+        lock.unlock();
+
+        if(open && !m_handler.auth_session(id)) {
+            m_handler.restore_session(kind, id);
+            return id;
+        }
+
+        lock.lock();
+        m_pending.erase(id);
+        m_stats.failed_attempts++;
+        lock.unlock();
+
+        m_handler.close_session(id, "session could not be established");
+        return WS_CON_ERR_CODE;
+    }
+
+private:
+    trade_handler& m_handler;
+    const options m_options;
+    latency_histogram* m_failover_latency; // nullptr if the latency registry was full
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+
+    // guarded by m_mutex
+    bool m_running = false;
+    bool m_order_down = false;
+    bool m_market_data_down = false;
+    con_id_type m_standby = WS_CON_ERR_CODE;
+    std::map<con_id_type, pending_session> m_pending;
+    stats m_stats;
+};
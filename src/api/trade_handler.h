@@ -1,10 +1,30 @@
 #pragma once
 
 #include <websocket/websocket.h>
+#include <market/order_book.h>
+#include <lib/inline_string.h>
+#include <lib/fixed_decimal.h>
+#include <lib/token_table.h>
+#include <api/exchange_clock.h>
+
+#include <atomic>
+#include <memory>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+class instrument_cache;
+class order_manager;
+
+// notified on the network thread when a session of a trade handler opens, fails or closes
+class session_observer {
+public:
+    virtual ~session_observer() {}
+
+    virtual void on_session_open(con_id_type id) {}
+    virtual void on_session_down(con_id_type id) {}
+};
+
 class trade_handler {
 public:
     // We can specify additional fields for a different API in the structs
@@ -14,26 +34,59 @@ public:
         std::string secret;
     };
 
+    // capacities of the order_params strings
+    static constexpr std::size_t instrument_capacity = 64;
+    static constexpr std::size_t label_capacity = 64;
+    static constexpr std::size_t order_id_capacity = 64;
+
+    // fields with a fixed set of values, unset unless given (their tokens are in enum_tokens below)
+    enum class order_type : std::uint8_t {
+        unset, limit, stop_limit, take_limit, market, stop_market, take_market, market_limit, trailing_stop
+    };
+
+    enum class order_time_in_force : std::uint8_t {
+        unset, good_til_cancelled, good_til_day, fill_or_kill, immediate_or_cancel
+    };
+
+    enum class order_trigger : std::uint8_t {
+        unset, index_price, mark_price, last_price
+    };
+
+    enum class instrument_kind : std::uint8_t {
+        unset, future, option, spot, future_combo, option_combo
+    };
+
+    enum class open_orders_type : std::uint8_t {
+        unset, all, limit, trigger_all, stop_all, stop_limit, stop_market, take_all, take_limit, take_market,
+        trailing_all, trailing_stop
+    };
+
+    enum class currency_code : std::uint8_t {
+        unset, BTC, ETH, USDC, USDT, EURR, any
+    };
+
     // order_params can be used for buy, sell, edit and cancel orders
+    // strings are stored inline so that an order can be built and passed down without allocating,
+    // prices and amounts are exact decimals and unset unless given
     struct order_params {
-        float amount;
-        float contracts;
-        float price;
-        float trigger_price;
+        fixed_decimal amount;
+        fixed_decimal contracts;
+        fixed_decimal price;
+        fixed_decimal trigger_price;
 
-        std::string instrument;
-        std::string type;
-        std::string label;
-        std::string time_in_force;
-        std::string trigger;
+        inline_string<instrument_capacity> instrument;
+        order_type type = order_type::unset;
+        inline_string<label_capacity> label;
+        order_time_in_force time_in_force = order_time_in_force::unset;
+        order_trigger trigger = order_trigger::unset;
 
         // only for edit and cancel orders
-        std::string order_id;
+        inline_string<order_id_capacity> order_id;
     };
 
     struct open_orders_params {
-        std::string kind;
-        std::string type;
+        instrument_kind kind = instrument_kind::unset;
+        open_orders_type type = open_orders_type::unset;
     };
 
     struct order_book_params {
@@ -42,8 +95,8 @@ public:
     };
 
     struct positions_params {
-        std::string currency;
-        std::string kind;
+        currency_code currency = currency_code::unset;
+        instrument_kind kind = instrument_kind::unset;
     };
 
     struct logout_params {
@@ -54,6 +107,16 @@ public:
         std::vector<std::string> channels;
     };
 
+    struct cancel_all_params {
+        std::string instrument;
+        std::string type; // kind of orders to cancel, empty for all
+    };
+
+    struct cancel_label_params {
+        std::string label;
+        currency_code currency = currency_code::unset; // unset for every currency
+    };
+
 public:    
     trade_handler(std::string url): m_url{url} {}
     virtual ~trade_handler() {}
@@ -63,28 +126,226 @@ public:
         m_key = key;
     }
 
+    // network threads of the two sessions, the same thread if the endpoint only has one
+    static constexpr std::size_t order_worker = 0;
+    static constexpr std::size_t market_data_worker = 1;
+
+    enum class session_kind {
+        order_entry,
+        market_data
+    };
+
+    // order entry and market data use separate sessions, so that bursts of feed traffic never queue
+    // ahead of order traffic, returns the order entry connection
+    con_id_type connect() {
+        con_id_type order_id = open_session(session_kind::order_entry);
+        if(order_id == WS_CON_ERR_CODE)
+            return order_id;
+
+        con_id_type md_id = open_session(session_kind::market_data);
+        if(md_id == WS_CON_ERR_CODE) {
+            close_session(order_id, "market data connection failed");
+            return WS_CON_ERR_CODE;
+        }
+
+        activate_session(session_kind::order_entry, order_id);
+        activate_session(session_kind::market_data, md_id);
+        return order_id;
+    }
+
+    void disconnect(const std::string& reason) {
+        close_session(activate_session(session_kind::order_entry, WS_CON_ERR_CODE), reason);
+        close_session(activate_session(session_kind::market_data, WS_CON_ERR_CODE), reason);
+    }
+
+    con_id_type order_con_id() const { return m_con_id; }
+    con_id_type market_data_con_id() const { return m_md_con_id; }
+
+    // open a session of a kind without making it active, its state changes go to the session observer
+    con_id_type open_session(session_kind kind) {
+        state_listener on_state = [this](con_id_type id, bool open) { on_session_state(id, open); };
+
+        // the id is only known once connect() returns, before anything can be sent on the session
+        auto session_id = std::make_shared<std::atomic<con_id_type>>(WS_CON_ERR_CODE);
+        con_id_type id;
+
+        if(kind == session_kind::order_entry) {
+            id = m_endpoint->connect(m_url, [this, session_id](std::string_view payload) {
+                on_order_message(session_id->load(std::memory_order_relaxed), payload);
+            }, order_worker, std::move(on_state));
+        } else {
+            id = m_endpoint->connect(m_url, [this, session_id](std::string_view payload) {
+                on_message(session_id->load(std::memory_order_relaxed), payload);
+            }, market_data_worker, std::move(on_state));
+        }
+
+        session_id->store(id, std::memory_order_relaxed);
+        return id;
+    }
+
+    void close_session(con_id_type id, const std::string& reason) {
+        if(id != WS_CON_ERR_CODE)
+            m_endpoint->close(id, websocketpp::close::status::going_away, reason);
+    }
+
+    // the active session of a kind carries the requests of that kind, returns the previously active one
+    con_id_type activate_session(session_kind kind, con_id_type id) {
+        return (kind == session_kind::order_entry ? m_con_id : m_md_con_id).exchange(id, std::memory_order_acq_rel);
+    }
+
+    con_id_type active_session(session_kind kind) const {
+        return kind == session_kind::order_entry ? m_con_id.load(std::memory_order_acquire) : m_md_con_id.load(std::memory_order_acquire);
+    }
+
+    // receives the state changes of every session opened afterwards, eg. a session_supervisor
+    void set_session_observer(session_observer* observer) { m_session_observer.store(observer, std::memory_order_release); }
+
     // common trade methods which must be implemented
-    con_id_type connect() { m_con_id = m_endpoint->connect(m_url); return m_con_id; }
+
     virtual websocketpp::lib::error_code auth() = 0;
-    virtual void test() = 0;
+    virtual rpc_future test() = 0;
+
+    // authenticate a single session, eg. one replacing a failed session
+    virtual websocketpp::lib::error_code auth_session(con_id_type id) { return {}; }
+
+    // bring a replacement session to the state of the one it replaces, eg. its subscriptions
+    virtual void restore_session(session_kind kind, con_id_type id) {}
+
+    // a replacement session is now active, catch up on what was missed while its kind was down
+    virtual void resync_session(session_kind kind) {}
 
     // these methods may or may not be implemented by derived classes
-    virtual void buy(order_params params) {}
-    virtual void sell(order_params params) {}
-    virtual void edit(order_params params) {}
-    virtual void cancel(order_params params) {}
-    virtual void get_open_orders(open_orders_params params) {}
-    virtual void get_order_book(order_book_params params) {}
-    virtual void get_positions(positions_params params) {}
+    // the returned future completes when the response to the request arrives
+    virtual rpc_future buy(const order_params& params) { return {}; }
+    virtual rpc_future sell(const order_params& params) { return {}; }
+    virtual rpc_future edit(const order_params& params) { return {}; }
+    virtual rpc_future cancel(const order_params& params) { return {}; }
+    virtual rpc_future get_open_orders(const open_orders_params& params) { return {}; }
+    virtual rpc_future get_order_book(const order_book_params& params) { return {}; }
+    virtual rpc_future get_positions(const positions_params& params) { return {}; }
+
+    // orders sent together on the order entry session, in one write
+    // one future per order, in order, invalid for an order rejected before sending
+    virtual std::vector<rpc_future> buy_batch(const order_params* orders, std::size_t count) { return std::vector<rpc_future>(count); }
+    virtual std::vector<rpc_future> sell_batch(const order_params* orders, std::size_t count) { return std::vector<rpc_future>(count); }
+    virtual std::vector<rpc_future> cancel_batch(const order_params* orders, std::size_t count) { return std::vector<rpc_future>(count); }
+
+    // cancel every order of an instrument, or every order carrying a label, in one request
+    virtual rpc_future cancel_all_by_instrument(const cancel_all_params& params) { return {}; }
+    virtual rpc_future cancel_by_label(const cancel_label_params& params) { return {}; }
+
+    virtual rpc_future subscribe(const subscriptions_params& params) { return {}; }
+    virtual rpc_future unsubscribe_all() { return {}; }
+
+    virtual rpc_future logout(const logout_params& params) { return {}; }
+
+    // order books maintained locally from book subscriptions, nullptr if not supported
+    virtual const order_book_manager* get_order_books() const { return nullptr; }
+
+    // trading rules (tick size, minimum amount...) of the instruments of a currency, any for every currency,
+    // loaded into the instrument cache when the response arrives
+    virtual rpc_future load_instruments(currency_code currency) { return {}; }
+
+    // instruments loaded so far, orders are checked against them before sending, nullptr if not supported
+    virtual const instrument_cache* get_instruments() const { return nullptr; }
 
-    virtual void subscribe(subscriptions_params params) {}
-    virtual void unsubscribe_all() {}
+    // keep the state of the user's orders locally, from the orders sent and the exchange notifications,
+    // starting from the orders open on the exchange
+    virtual rpc_future track_orders() { return {}; }
 
-    virtual void logout(logout_params params) {}
+    // orders tracked so far, nullptr if not supported
+    virtual const order_manager* get_orders() const { return nullptr; }
+
+    // round trip and clock offset to the exchange, nullptr if not supported
+    virtual const exchange_clock* get_exchange_clock() const { return nullptr; }
+
+    // sample the exchange clock periodically in the background
+    virtual void start_clock_probe(std::chrono::milliseconds interval) {}
+    virtual void stop_clock_probe() {}
+
+    // record the messages received on the market data connection into a journal
+    bool start_recording(const std::string& path) { return m_endpoint->start_recording(m_md_con_id, path); }
+    void stop_recording() { m_endpoint->stop_recording(m_md_con_id); }
+
+    // pass the messages of a journal through on_message, as if they were received on the market data connection
+    replay_stats replay(const std::string& path, double speed) {
+        return m_endpoint->replay(path, speed, [this](std::string_view payload) { on_message(WS_CON_ERR_CODE, payload); });
+    }
+
+protected:
+    // runs on the market data network thread for every message received on a market data session
+    // (con_id is WS_CON_ERR_CODE for replayed messages)
+    virtual void on_message(con_id_type con_id, std::string_view payload) {}
+
+    // runs on the order network thread for every message received on an order entry session,
+    // responses have already completed their request's future
+    virtual void on_order_message(con_id_type con_id, std::string_view payload) {}
+
+private:
+    void on_session_state(con_id_type id, bool open) {
+        session_observer* observer = m_session_observer.load(std::memory_order_acquire);
+        if(!observer)
+            return;
+
+        if(open)
+            observer->on_session_open(id);
+        else
+            observer->on_session_down(id);
+    }
 
 protected:
     const std::string m_url;
     websocket_endpoint* m_endpoint;
     api_key m_key;
-    con_id_type m_con_id;
-};
\ No newline at end of file
+    // active sessions, replaced by the session supervisor while other threads send on them
+    std::atomic<con_id_type> m_con_id {WS_CON_ERR_CODE};    // order entry
+    std::atomic<con_id_type> m_md_con_id {WS_CON_ERR_CODE}; // market data
+
+private:
+    std::atomic<session_observer*> m_session_observer {nullptr};
+};
+
+// the exact tokens of the exchange APIs, indexed by enum value
+
+template<>
+struct enum_tokens<trade_handler::order_type> {
+    static constexpr token_table<trade_handler::order_type, 9> table {{
+        "", "limit", "stop_limit", "take_limit", "market", "stop_market", "take_market", "market_limit", "trailing_stop"
+    }};
+};
+
+template<>
+struct enum_tokens<trade_handler::order_time_in_force> {
+    static constexpr token_table<trade_handler::order_time_in_force, 5> table {{
+        "", "good_til_cancelled", "good_til_day", "fill_or_kill", "immediate_or_cancel"
+    }};
+};
+
+template<>
+struct enum_tokens<trade_handler::order_trigger> {
+    static constexpr token_table<trade_handler::order_trigger, 4> table {{
+        "", "index_price", "mark_price", "last_price"
+    }};
+};
+
+template<>
+struct enum_tokens<trade_handler::instrument_kind> {
+    static constexpr token_table<trade_handler::instrument_kind, 6> table {{
+        "", "future", "option", "spot", "future_combo", "option_combo"
+    }};
+};
+
+template<>
+struct enum_tokens<trade_handler::open_orders_type> {
+    static constexpr token_table<trade_handler::open_orders_type, 12> table {{
+        "", "all", "limit", "trigger_all", "stop_all", "stop_limit", "stop_market", "take_all", "take_limit", "take_market",
+        "trailing_all", "trailing_stop"
+    }};
+};
+
+template<>
+struct enum_tokens<trade_handler::currency_code> {
+    static constexpr token_table<trade_handler::currency_code, 7> table {{
+        "", "BTC", "ETH", "USDC", "USDT", "EURR", "any"
+    }};
+};
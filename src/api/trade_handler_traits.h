@@ -0,0 +1,89 @@
+#pragma once
+
+#include <type_traits>
+
+#include <api/trade_handler.h>
+
+// Operations a trade handler implements, known at compile time.
+// trade_handler declares most operations with an empty default body, an adapter implements one by
+// overriding it. &Adapter::op has the type of a member of the class which declares op, so an operation
+// left to its default is a member of trade_handler rather than of the adapter.
+// trade_handler itself implements every operation, dispatched at runtime to whichever adapter it is.
+namespace trade_handler_detail {
+
+template<typename Pointer>
+struct member_class {};
+
+template<typename R, typename C, typename... Args>
+struct member_class<R (C::*)(Args...)> { typedef C type; };
+
+template<typename R, typename C, typename... Args>
+struct member_class<R (C::*)(Args...) const> { typedef C type; };
+
+template<typename Handler, template<typename> class Member, typename = void>
+struct implements : std::false_type {};
+
+template<typename Handler, template<typename> class Member>
+struct implements<Handler, Member, std::void_t<Member<Handler>>>
+    : std::bool_constant<std::is_same_v<Handler, trade_handler>
+        || !std::is_same_v<typename member_class<Member<Handler>>::type, trade_handler>> {};
+
+template<typename H> using buy = decltype(&H::buy);
+template<typename H> using sell = decltype(&H::sell);
+template<typename H> using edit = decltype(&H::edit);
+template<typename H> using cancel = decltype(&H::cancel);
+template<typename H> using get_open_orders = decltype(&H::get_open_orders);
+template<typename H> using get_order_book = decltype(&H::get_order_book);
+template<typename H> using get_positions = decltype(&H::get_positions);
+template<typename H> using buy_batch = decltype(&H::buy_batch);
+template<typename H> using sell_batch = decltype(&H::sell_batch);
+template<typename H> using cancel_batch = decltype(&H::cancel_batch);
+template<typename H> using cancel_all_by_instrument = decltype(&H::cancel_all_by_instrument);
+template<typename H> using cancel_by_label = decltype(&H::cancel_by_label);
+template<typename H> using subscribe = decltype(&H::subscribe);
+template<typename H> using unsubscribe_all = decltype(&H::unsubscribe_all);
+template<typename H> using logout = decltype(&H::logout);
+template<typename H> using get_order_books = decltype(&H::get_order_books);
+template<typename H> using get_exchange_clock = decltype(&H::get_exchange_clock);
+template<typename H> using load_instruments = decltype(&H::load_instruments);
+template<typename H> using track_orders = decltype(&H::track_orders);
+
+// not part of trade_handler, only adapters with order templates declare it (see deribit_order_template)
+template<typename H> using make_buy_template = decltype(&H::make_buy_template);
+
+}
+
+template<typename Handler>
+struct trade_handler_traits {
+    static_assert(std::is_base_of_v<trade_handler, Handler>, "trade handlers derive from trade_handler");
+
+    template<template<typename> class Member>
+    static constexpr bool implements = trade_handler_detail::implements<Handler, Member>::value;
+
+    static constexpr bool buy = implements<trade_handler_detail::buy>;
+    static constexpr bool sell = implements<trade_handler_detail::sell>;
+    static constexpr bool edit = implements<trade_handler_detail::edit>;
+    static constexpr bool cancel = implements<trade_handler_detail::cancel>;
+    static constexpr bool get_open_orders = implements<trade_handler_detail::get_open_orders>;
+    static constexpr bool get_order_book = implements<trade_handler_detail::get_order_book>;
+    static constexpr bool get_positions = implements<trade_handler_detail::get_positions>;
+    static constexpr bool buy_batch = implements<trade_handler_detail::buy_batch>;
+    static constexpr bool sell_batch = implements<trade_handler_detail::sell_batch>;
+    static constexpr bool cancel_batch = implements<trade_handler_detail::cancel_batch>;
+    static constexpr bool cancel_all_by_instrument = implements<trade_handler_detail::cancel_all_by_instrument>;
+    static constexpr bool cancel_by_label = implements<trade_handler_detail::cancel_by_label>;
+    static constexpr bool subscribe = implements<trade_handler_detail::subscribe>;
+    static constexpr bool unsubscribe_all = implements<trade_handler_detail::unsubscribe_all>;
+    static constexpr bool logout = implements<trade_handler_detail::logout>;
+    static constexpr bool order_books = implements<trade_handler_detail::get_order_books>;
+    static constexpr bool exchange_clock = implements<trade_handler_detail::get_exchange_clock>;
+    static constexpr bool instruments = implements<trade_handler_detail::load_instruments>;
+    static constexpr bool order_tracking = implements<trade_handler_detail::track_orders>;
+
+    // detected rather than implemented: trade_handler has no order templates to dispatch to
+    static constexpr bool order_templates = !std::is_same_v<Handler, trade_handler>
+        && implements<trade_handler_detail::make_buy_template>;
+
+    // calls to a final adapter are bound at compile time and can be inlined
+    static constexpr bool static_dispatch = std::is_final_v<Handler>;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+
+#include <api/trade_handler.h>
+#include <api/deribit_encoder.h>
+#include <websocket/message_ring.h>
+#include <bench/bench_util.h>
+
+namespace allocation_bench {
+
+// order parameters as they were before the inline strings, passed by value at every layer
+struct string_order_params {
+    float amount;
+    float contracts;
+    float price;
+    float trigger_price;
+
+    std::string instrument;
+    std::string type;
+    std::string label;
+    std::string time_in_force;
+    std::string trigger;
+    std::string order_id;
+};
+
+// trade handler which encodes an order and records the frame, as the send path does after encoding
+struct recording_handler : trade_handler {
+    recording_handler(): trade_handler{""}, messages{16, 1024} {}
+
+    websocketpp::lib::error_code auth() override { return {}; }
+    rpc_future test() override { return {}; }
+
+    rpc_future buy(const order_params& params) override {
+        std::string_view frame = encoder.encode_order("private/buy", 1, params);
+        messages.push(message_direction::sent, frame.data(), frame.size());
+        return {};
+    }
+
+    deribit_order_encoder encoder;
+    message_ring messages;
+};
+
+struct string_recording_handler {
+    string_recording_handler(): messages{16, 1024} {}
+
+    void send(std::string message) {
+        messages.push(message_direction::sent, message.data(), message.size());
+    }
+
+    void buy(string_order_params params) {
+        trade_handler::order_params encoded;
+        if(params.amount != -1)
+            encoded.amount = fixed_decimal::from_double(params.amount);
+        if(params.price != -1)
+            encoded.price = fixed_decimal::from_double(params.price);
+        encoded.instrument = params.instrument;
+        parse_token(params.type, encoded.type);
+        encoded.label = params.label;
+        parse_token(params.time_in_force, encoded.time_in_force);
+
+        send(std::string{encoder.encode_order("private/buy", 1, encoded)});
+    }
+
+    deribit_order_encoder encoder;
+    message_ring messages;
+};
+
+// REPL -> client_trader -> trade_handler -> send, mirroring the layers of the order path
+inline void client_buy(trade_handler& handler, const trade_handler::order_params& params) { handler.buy(params); }
+inline void string_client_buy(string_recording_handler& handler, string_order_params params) { handler.buy(params); }
+
+template<typename F>
+std::size_t allocations_per_call(F&& fn) {
+    static constexpr std::size_t calls = 1000;
+
+    fn(); // buffers reach their working size
+
+    std::size_t before = thread_allocation_count();
+    for(std::size_t i = 0; i < calls; i++)
+        fn();
+    return (thread_allocation_count() - before) / calls;
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 1000000;
+
+    std::cout << "allocations: one private/buy order from the REPL to the send buffer\n";
+
+    // strings long enough to defeat the small string optimization
+    const std::string_view instrument = "BTC-27JUN25-100000-C";
+    const std::string_view label = "strategy-alpha-0001";
+
+    recording_handler handler;
+    string_recording_handler string_handler;
+
+    auto order_path = [&] {
+        trade_handler::order_params params;
+        params.amount = fixed_decimal::from_integer(10);
+        params.price = fixed_decimal::from_units(9712350000000);
+        params.instrument = instrument;
+        params.type = trade_handler::order_type::limit;
+        params.label = label;
+        params.time_in_force = trade_handler::order_time_in_force::good_til_cancelled;
+
+        client_buy(handler, params);
+    };
+
+    auto string_order_path = [&] {
+        string_order_params params;
+        params.amount = 10;
+        params.contracts = -1;
+        params.price = 97123.5f;
+        params.trigger_price = -1;
+        params.instrument = instrument;
+        params.type = "limit";
+        params.label = label;
+        params.time_in_force = "good_til_cancelled";
+
+        string_client_buy(string_handler, params);
+    };
+
+    std::size_t string_allocations = allocations_per_call(string_order_path);
+    std::size_t inline_allocations = allocations_per_call(order_path);
+
+    std::cout << "  std::string params by value                " << string_allocations << " allocations/order\n";
+    std::cout << "  inline_string params by reference          " << inline_allocations << " allocations/order\n";
+
+    print_bench_result("std::string params by value", measure_ns_per_op(string_order_path, iterations));
+    print_bench_result("inline_string params by reference", measure_ns_per_op(order_path, iterations));
+
+    if(inline_allocations != 0) {
+        std::cout << "  order path allocates\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <websocket/audit_journal.h>
+#include <bench/bench_util.h>
+#include <bench/parse_bench.h>
+
+namespace audit_bench {
+
+// reads a journal back and checks that every record is present, in order
+inline bool verify(const std::string& base, std::uint64_t first_segment, std::uint64_t expected, std::uint64_t& segments) {
+    audit_journal_reader reader;
+    if(!reader.open(base, first_segment))
+        return false;
+
+    audit_record record;
+    std::uint64_t count = 0;
+    while(reader.next(record)) {
+        bool sent = (count % 2 == 0);
+        const std::string& payload = sent ? parse_bench::trades_payload : parse_bench::book_change_payload;
+
+        if(record.sequence != count || record.con_id != 3 || record.payload != payload
+            || record.direction != (sent ? message_direction::sent : message_direction::received))
+            return false;
+        count++;
+    }
+
+    segments = reader.segment() - first_segment; // the reader moved past the end record written on close
+    return count == expected;
+}
+
+inline void remove_segments(const std::string& base, std::uint64_t first, std::uint64_t count) {
+    for(std::uint64_t i = first; i < first + count; i++)
+        std::remove(audit_segment_path(base, i).c_str());
+}
+
+// append alternating sent and received messages, then read them back
+inline int append_run(const std::string& label, std::size_t segment_size) {
+    static constexpr std::size_t iterations = 200000;
+
+    const std::string base = "/tmp/client_bench_audit";
+    const std::string& sent = parse_bench::trades_payload;
+    const std::string& received = parse_bench::book_change_payload;
+
+    audit_journal journal;
+    if(!journal.open(base, segment_size)) {
+        std::cout << "  could not open " << audit_segment_path(base, 0) << "\n";
+        return 1;
+    }
+    std::uint64_t first = journal.first_segment();
+
+    // let the background thread prepare the next segment before measuring
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::size_t allocations = thread_allocation_count();
+    std::size_t i = 0;
+
+    print_bench_result(label, measure_ns_per_op([&] {
+        if(i++ % 2 == 0)
+            journal.append(message_direction::sent, 3, journal_frame::text, sent.data(), sent.size());
+        else
+            journal.append(message_direction::received, 3, journal_frame::text, received.data(), received.size());
+    }, iterations));
+
+    allocations = thread_allocation_count() - allocations;
+    std::uint64_t records = journal.records();
+    journal.close();
+
+    std::uint64_t segments = 0;
+    bool valid = verify(base, first, records, segments);
+    remove_segments(base, first, segments);
+
+    std::cout << "    " << records << " records in " << segments << " segments, " << allocations << " allocations\n";
+
+    if(!valid) {
+        std::cout << "  journal read back does not match what was appended\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+inline int run() {
+    std::cout << "audit: memory-mapped audit journal, " << (parse_bench::trades_payload.size() + parse_bench::book_change_payload.size()) / 2
+        << " bytes per message\n";
+
+    // a segment large enough for the whole run, then small ones which rotate every ~9000 messages,
+    // faster than the next segment can be prepared, so that run includes waiting for it
+    if(append_run("append", 128 << 20) != 0 || append_run("append (rotating 4 MiB segments)", 4 << 20) != 0)
+        return 1;
+
+    return 0;
+}
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <api/deribit_encoder.h>
+#include <websocket/frame_batch.h>
+#include <bench/bench_util.h>
+#include <bench/serialize_bench.h>
+
+namespace batch_bench {
+
+constexpr std::size_t BATCH_ORDERS = 100;
+
+// unmask the frames of a batch and compare them with the payloads, returns the number of bad frames
+inline int check_frames(const frame_batch& batch) {
+    const std::string& data = batch.frames();
+    std::size_t pos = 0;
+    int bad = 0;
+
+    for(const frame_batch::request& request : batch.requests()) {
+        if(pos + 2 > data.size() || static_cast<unsigned char>(data[pos]) != 0x81 || !(data[pos + 1] & 0x80))
+            return bad + 1;
+
+        std::uint64_t length = data[pos + 1] & 0x7f;
+        pos += 2;
+        int extended = (length == 126) ? 2 : (length == 127) ? 8 : 0;
+        if(extended) {
+            length = 0;
+            for(int i = 0; i < extended; i++)
+                length = (length << 8) | static_cast<unsigned char>(data[pos++]);
+        }
+
+        const char* mask = &data[pos];
+        pos += 4;
+
+        std::string payload = data.substr(pos, length);
+        for(std::size_t i = 0; i < payload.size(); i++)
+            payload[i] ^= mask[i & 3];
+        pos += length;
+
+        if(payload != batch.payload(request))
+            bad++;
+    }
+
+    return bad + (pos != data.size());
+}
+
+// a connected pair of loopback TCP sockets, with TCP_NODELAY like the client's sockets
+struct loopback_pair {
+    int sender = -1;
+    int receiver = -1;
+
+    bool open() {
+        int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+
+        if(listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || ::listen(listener, 1) != 0 || ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            ::close(listener);
+            return false;
+        }
+
+        sender = ::socket(AF_INET, SOCK_STREAM, 0);
+        bool connected = sender >= 0 && ::connect(sender, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        receiver = connected ? ::accept(listener, nullptr, nullptr) : -1;
+        ::close(listener);
+
+        int enabled = 1;
+        ::setsockopt(sender, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        return receiver >= 0;
+    }
+
+    // read everything sent so far, outside the timed region
+    void drain(std::size_t bytes) {
+        char buf[64 * 1024];
+        while(bytes > 0) {
+            ssize_t n = ::recv(receiver, buf, std::min(bytes, sizeof(buf)), 0);
+            if(n <= 0)
+                return;
+            bytes -= n;
+        }
+    }
+
+    ~loopback_pair() {
+        ::close(sender);
+        ::close(receiver);
+    }
+};
+
+inline int run() {
+    static constexpr std::size_t rounds = 2000;
+
+    std::cout << "batch: " << BATCH_ORDERS << " private/buy orders, framed and written to a loopback socket\n";
+
+    std::vector<trade_handler::order_params> orders;
+    for(std::size_t i = 0; i < BATCH_ORDERS; i++)
+        orders.push_back(serialize_bench::make_order("10", "", std::to_string(97000 + i), "batch_" + std::to_string(i)));
+
+    deribit_order_encoder encoder;
+    frame_batch batch;
+    request_id_type next_id = 1;
+
+    auto add_order = [&](frame_batch& target, const trade_handler::order_params& order) {
+        request_id_type id = next_id++;
+        target.append_request(id, encoder.encode_order("private/buy", id, order));
+    };
+
+    for(const auto& order : orders)
+        add_order(batch, order);
+
+    if(int bad = check_frames(batch)) {
+        std::cout << "  " << bad << " frames do not decode to their payload\n";
+        return 1;
+    }
+
+    print_bench_result("encode and frame 100 orders", measure_ns_per_op([&] {
+        batch.clear();
+        for(const auto& order : orders)
+            add_order(batch, order);
+        do_not_optimize(batch.frames().data());
+    }, rounds));
+
+    loopback_pair sockets;
+    if(!sockets.open()) {
+        std::cout << "  could not open loopback sockets: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // one write per order, as buy() sends them
+    std::vector<frame_batch> single(BATCH_ORDERS);
+    std::size_t sequential_bytes = 0;
+    for(std::size_t i = 0; i < BATCH_ORDERS; i++) {
+        add_order(single[i], orders[i]);
+        sequential_bytes += single[i].frames().size();
+    }
+
+    double sequential = 0;
+    double pipelined = 0;
+
+    for(std::size_t round = 0; round < rounds; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for(const frame_batch& frame : single)
+            ::send(sockets.sender, frame.frames().data(), frame.frames().size(), MSG_NOSIGNAL);
+        sequential += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        sockets.drain(sequential_bytes);
+
+        start = std::chrono::steady_clock::now();
+        ::send(sockets.sender, batch.frames().data(), batch.frames().size(), MSG_NOSIGNAL);
+        pipelined += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        sockets.drain(batch.frames().size());
+    }
+
+    print_bench_result("100 orders, one write each (sequential)", sequential / rounds);
+    print_bench_result("100 orders, one write (pipelined)", pipelined / rounds);
+
+    return 0;
+}
+
+}
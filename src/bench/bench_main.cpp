@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <iostream>
+
+#include <lib/utilities.h>
+#include <lib/benchmark.h>
+
+#include <bench/serialize_bench.h>
+#include <bench/parse_bench.h>
+#include <bench/order_book_bench.h>
+#include <bench/logging_bench.h>
+#include <bench/latency_bench.h>
+#include <bench/clock_bench.h>
+#include <bench/connection_bench.h>
+#include <bench/allocation_bench.h>
+#include <bench/replay_bench.h>
+#include <bench/audit_bench.h>
+#include <bench/wakeup_bench.h>
+#include <bench/batch_bench.h>
+#include <bench/instrument_bench.h>
+#include <bench/order_state_bench.h>
+
+tsc_clock::time_point g_timer_start;
+thread_local benchmark g_benchmark {"g_benchmark"};
+
+// count heap allocations per thread, for the allocations suite
+static thread_local std::size_t t_allocations = 0;
+
+std::size_t thread_allocation_count() { return t_allocations; }
+
+void* operator new(std::size_t size) {
+    t_allocations++;
+
+    if(void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+// not inlined, so that the compiler does not pair new expressions with free()
+__attribute__((noinline)) void operator delete(void* ptr) noexcept { std::free(ptr); }
+__attribute__((noinline)) void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+struct bench_suite {
+    const char* name;
+    int (*run)();
+};
+
+static constexpr bench_suite suites[] = {
+    {"serialize", serialize_bench::run},
+    {"parse", parse_bench::run},
+    {"order_book", order_book_bench::run},
+    {"logging", logging_bench::run},
+    {"latency", latency_bench::run},
+    {"clock", clock_bench::run},
+    {"connection_table", connection_bench::run},
+    {"allocations", allocation_bench::run},
+    {"replay", replay_bench::run},
+    {"audit", audit_bench::run},
+    {"wakeup", wakeup_bench::run},
+    {"batch", batch_bench::run},
+    {"instruments", instrument_bench::run},
+    {"orders", order_state_bench::run},
+};
+
+// usage: client_bench [suite...]
+// runs every suite when none is given, returns non-zero if a suite fails its checks
+int main(int argc, char* argv[]) {
+    tsc_clock::calibrate();
+    g_timer_start = tsc_clock::now();
+
+    int failed = 0;
+
+    for(const bench_suite& suite : suites) {
+        bool selected = (argc == 1);
+        for(int i = 1; i < argc; i++)
+            selected |= (std::strcmp(argv[i], suite.name) == 0);
+
+        if(selected && suite.run() != 0) {
+            std::cout << "suite failed: " << suite.name << "\n";
+            failed++;
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// number of heap allocations made by the calling thread so far (counted by client_bench's operator new)
+std::size_t thread_allocation_count();
+
+// keep the compiler from optimizing away a value computed in a benchmark loop
+template<typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// run fn() for the given number of iterations (after a short warm up) and return the mean time per call
+template<typename F>
+double measure_ns_per_op(F&& fn, std::size_t iterations) {
+    for(std::size_t i = 0; i < iterations / 10 + 1; i++)
+        fn();
+
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; i++)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+inline void print_bench_result(const std::string& label, double ns_per_op) {
+    static constexpr int label_width = 52;
+
+    std::ios_base::fmtflags original_flags = std::cout.flags();
+    std::cout << "  " << std::left << std::setw(label_width) << label
+        << std::right << std::fixed << std::setprecision(1) << std::setw(10) << ns_per_op << " ns/op\n";
+    std::cout.flags(original_flags);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <lib/tsc_clock.h>
+#include <api/exchange_clock.h>
+#include <bench/bench_util.h>
+
+#include <random>
+
+namespace clock_bench {
+
+// drift above this is reported as a failure, the calibration interval is too short or the TSC is unstable
+constexpr double MAX_DRIFT_PPM = 200;
+// the exchange reports milliseconds, an offset estimate within one millisecond is as good as it gets
+constexpr std::int64_t MAX_OFFSET_ERROR_NS = 1000000;
+
+// samples with a known exchange clock offset and queuing delays on both paths
+inline bool check_exchange_clock() {
+    static constexpr std::int64_t true_offset = 1700000000123456789;
+    static constexpr int samples = 64;
+
+    std::mt19937_64 rng {42};
+    std::uniform_int_distribution<std::int64_t> base_delay {200000, 300000}; // one way, ns
+    std::exponential_distribution<double> queuing {1.0 / 2000000};             // mean 2 ms
+
+    exchange_clock clock;
+    tsc_clock::time_point sent = tsc_clock::now();
+
+    for(int i = 0; i < samples; i++) {
+        auto outbound = std::chrono::nanoseconds(base_delay(rng) + static_cast<std::int64_t>(queuing(rng)));
+        auto inbound = std::chrono::nanoseconds(base_delay(rng) + static_cast<std::int64_t>(queuing(rng)));
+
+        std::int64_t exchange_ns = (sent + outbound).time_since_epoch().count() + true_offset;
+        clock.add_sample(sent, exchange_ns / 1000000, sent + outbound + inbound);
+        sent += std::chrono::milliseconds(100);
+    }
+
+    exchange_clock::estimate estimate = clock.get();
+    std::int64_t error = estimate.offset_ns - true_offset;
+    std::cout << "  exchange clock offset error " << error / 1000 << " us, best round trip " << estimate.min_rtt_ns / 1000 << " us\n";
+
+    print_bench_result("exchange_clock::to_exchange_time", measure_ns_per_op([&clock] {
+        do_not_optimize(clock.to_exchange_time(tsc_clock::now()));
+    }, 10000000));
+
+    return std::abs(error) <= MAX_OFFSET_ERROR_NS;
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 10000000;
+
+    std::cout << "clock: timestamp sources\n";
+
+    tsc_clock::calibration_report report = tsc_clock::self_test();
+    if(report.tsc)
+        std::cout << "  tsc " << report.ghz << " GHz, drift " << report.drift_ppm << " ppm, offset " << report.offset_ns << " ns\n";
+    else
+        std::cout << "  no invariant TSC, using steady_clock\n";
+
+    print_bench_result("steady_clock::now", measure_ns_per_op([] {
+        do_not_optimize(std::chrono::steady_clock::now());
+    }, iterations));
+
+    print_bench_result("tsc_clock::now", measure_ns_per_op([] {
+        do_not_optimize(tsc_clock::now());
+    }, iterations));
+
+    print_bench_result("tsc_clock::now_ordered", measure_ns_per_op([] {
+        do_not_optimize(tsc_clock::now_ordered());
+    }, iterations));
+
+    if(!check_exchange_clock()) {
+        std::cout << "  exchange clock offset error above " << MAX_OFFSET_ERROR_NS / 1000 << " us\n";
+        return 1;
+    }
+
+    if(report.tsc && std::abs(report.drift_ppm) > MAX_DRIFT_PPM) {
+        std::cout << "  tsc calibration drift above " << MAX_DRIFT_PPM << " ppm\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+}
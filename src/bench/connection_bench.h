@@ -0,0 +1,94 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <websocket/connection_table.h>
+#include <bench/bench_util.h>
+
+namespace connection_bench {
+
+struct test_connection {
+    explicit test_connection(int id_): id{id_} {}
+    int get_id() const { return id; }
+
+    int id;
+};
+
+inline int run() {
+    static constexpr std::size_t iterations = 10000000;
+    static constexpr int connections = 4;
+    static constexpr std::size_t capacity = 16;
+
+    std::cout << "connection_table: connection lookup on the send path\n";
+
+    std::map<int, std::shared_ptr<test_connection>> map;
+    connection_table<test_connection, capacity> table;
+
+    for(int id = 0; id < connections; id++) {
+        auto connection = std::make_shared<test_connection>(id);
+        map[id] = connection;
+        table.insert(connection);
+    }
+
+    // an id reusing a slot replaces the older connection, which is then no longer found,
+    // but stays valid for a caller which found it before, and is released after that caller is done
+    std::weak_ptr<test_connection> replaced = map[0];
+    map.erase(0);
+    connection_table<test_connection, capacity>::ptr found = table.find(0);
+
+    table.insert(std::make_shared<test_connection>(static_cast<int>(capacity)));
+    if(table.find(0) || !table.find(capacity) || !table.find(1) || table.find(-1) || table.find(connections)) {
+        std::cout << "  unexpected lookup result after slot reuse\n";
+        return 1;
+    }
+
+    if(replaced.expired() || found->get_id() != 0) {
+        std::cout << "  replaced connection released while still in use\n";
+        return 1;
+    }
+
+    found.reset();
+    if(!replaced.expired()) {
+        std::cout << "  replaced connection not released\n";
+        return 1;
+    }
+
+    // ids whose slot is in use are skipped: slots 0 to 3 are occupied, only the connection in slot 2 is finished
+    auto finished = [](const test_connection& connection) { return connection.get_id() % capacity == 2; };
+    if(table.next_free(capacity + 1, finished) != static_cast<int>(capacity + 2)
+        || table.next_free(0, [](const test_connection&) { return false; }) != connections) {
+        std::cout << "  unexpected free slot\n";
+        return 1;
+    }
+
+    int id = 0;
+    print_bench_result("std::map find + shared_ptr copy", measure_ns_per_op([&] {
+        auto it = map.find(1 + id++ % (connections - 1));
+        std::shared_ptr<test_connection> connection = it->second;
+        do_not_optimize(connection);
+    }, iterations));
+
+    // the map shared with the network threads needs a lock
+    std::mutex map_mutex;
+    id = 0;
+    print_bench_result("std::map find + shared_ptr copy, locked", measure_ns_per_op([&] {
+        std::shared_ptr<test_connection> connection;
+        {
+            std::lock_guard<std::mutex> lock {map_mutex};
+            connection = map.find(1 + id++ % (connections - 1))->second;
+        }
+        do_not_optimize(connection);
+    }, iterations));
+
+    id = 1;
+    print_bench_result("connection_table::find", measure_ns_per_op([&] {
+        connection_table<test_connection, capacity>::ptr connection = table.find(1 + id++ % (connections - 1));
+        do_not_optimize(connection);
+    }, iterations));
+
+    return 0;
+}
+
+}
@@ -0,0 +1,295 @@
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <api/deribit.h>
+#include <client/client_trader.h>
+#include <mock/mock_deribit_server.h>
+#include <lib/utilities.h>
+#include <lib/benchmark.h>
+
+tsc_clock::time_point g_timer_start;
+thread_local benchmark g_benchmark {"g_benchmark"};
+
+constexpr auto E2E_CONNECT_TIMEOUT = std::chrono::seconds(10);
+constexpr auto E2E_TICK_TIMEOUT = std::chrono::seconds(60);
+constexpr auto E2E_MOCK_TICK_INTERVAL = std::chrono::microseconds(1000);
+constexpr std::size_t E2E_BATCH_ORDERS = 100;
+constexpr std::size_t E2E_BATCH_ROUNDS = 50;
+#define E2E_INSTRUMENT "BTC-PERPETUAL"
+
+// places an order on every book change and records the time spent from the parsed tick to the sent order
+class tick_to_order_listener : public deribit_feed_listener {
+public:
+    tick_to_order_listener(client_trader& trader, std::size_t orders)
+        : m_trader{trader}
+        , m_remaining{orders}
+        , m_tick_to_order{latency_registry::instance().histogram("e2e_tick_to_order")} {}
+
+    void on_book(const book_update& update) override {
+        if (update.snapshot || m_remaining == 0)
+            return;
+
+        tsc_clock::time_point tick_time = tsc_clock::now();
+
+        trade_handler::order_params params = order(update.change_id);
+        m_trader.buy(params);
+
+        if (m_tick_to_order)
+            m_tick_to_order->record((tsc_clock::now_ordered() - tick_time).count());
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+        if (--m_remaining == 0)
+            m_done.notify_all();
+    }
+
+    bool wait() {
+        std::unique_lock<std::mutex> lock {m_mutex};
+        return m_done.wait_for(lock, E2E_TICK_TIMEOUT, [&] { return m_remaining == 0; });
+    }
+
+    // immediate or cancel below the market, so that no order is left resting on a real exchange
+    static trade_handler::order_params order(std::int64_t change_id) {
+        trade_handler::order_params params;
+        params.amount = fixed_decimal::from_integer(10);
+        params.price = fixed_decimal::from_integer(50000);
+        params.instrument = E2E_INSTRUMENT;
+        params.type = trade_handler::order_type::limit;
+        params.time_in_force = trade_handler::order_time_in_force::immediate_or_cancel;
+
+        char label[32];
+        std::snprintf(label, sizeof(label), "tick-%lld", static_cast<long long>(change_id));
+        params.label = label;
+
+        return params;
+    }
+
+private:
+    client_trader& m_trader;
+    std::size_t m_remaining;
+    latency_histogram* m_tick_to_order;
+
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+};
+
+// waits for every response, returns false on a timeout
+static bool wait_all(std::vector<rpc_future>& responses) {
+    for (rpc_future& response : responses) {
+        if (!response.valid() || response.wait_for(DERIBIT_RESPONSE_TIMEOUT) != std::future_status::ready)
+            return false;
+        response.get();
+    }
+    return true;
+}
+
+// total time from sending the first of E2E_BATCH_ORDERS orders to receiving the last ack
+static bool measure_batches(client_trader& trader) {
+    latency_histogram* sequential = latency_registry::instance().histogram("e2e_100_orders_sequential");
+    latency_histogram* pipelined = latency_registry::instance().histogram("e2e_100_orders_pipelined");
+
+    std::vector<trade_handler::order_params> orders(E2E_BATCH_ORDERS, tick_to_order_listener::order(0));
+    std::vector<rpc_future> responses;
+
+    for (std::size_t round = 0; round < E2E_BATCH_ROUNDS; round++) {
+        tsc_clock::time_point start = tsc_clock::now();
+        responses.clear();
+        for (const auto& order : orders)
+            responses.push_back(trader.buy(order));
+        if (!wait_all(responses)) {
+            std::cout << "No response to a sequential order" << std::endl;
+            return false;
+        }
+        if (sequential)
+            sequential->record((tsc_clock::now() - start).count());
+
+        start = tsc_clock::now();
+        responses = trader.buy_batch(orders);
+        if (!wait_all(responses)) {
+            std::cout << "No response to a batched order" << std::endl;
+            return false;
+        }
+        if (pipelined)
+            pipelined->record((tsc_clock::now() - start).count());
+    }
+
+    return true;
+}
+
+// one order through the whole buy() path, from the client to the frame queued on the connection, and until its ack
+template<typename Trader>
+static bool measure_buy(Trader& trader, latency_histogram* call, latency_histogram* ack) {
+    trade_handler::order_params order = tick_to_order_listener::order(0);
+
+    tsc_clock::time_point start = tsc_clock::now();
+    rpc_future response = trader.buy(order);
+    if (call)
+        call->record((tsc_clock::now_ordered() - start).count());
+
+    if (!response.valid() || response.wait_for(DERIBIT_RESPONSE_TIMEOUT) != std::future_status::ready)
+        return false;
+
+    rpc_response answer = response.get();
+    if (ack)
+        ack->record(answer.round_trip.count());
+    return true;
+}
+
+// buy() through client_trader (virtual calls into the trade handler) and basic_client_trader<deribit>
+// (bound at compile time), alternating so that both see the same network conditions
+template<typename StaticTrader>
+static bool measure_dispatch(client_trader& dynamic_trader, StaticTrader& static_trader, std::size_t orders) {
+    latency_registry& registry = latency_registry::instance();
+    latency_histogram* virtual_call = registry.histogram("e2e_buy_call_virtual");
+    latency_histogram* virtual_ack = registry.histogram("e2e_order_to_ack_virtual");
+    latency_histogram* static_call = registry.histogram("e2e_buy_call_static");
+    latency_histogram* static_ack = registry.histogram("e2e_order_to_ack_static");
+
+    for (std::size_t i = 0; i < orders; i++) {
+        if (!measure_buy(dynamic_trader, virtual_call, virtual_ack) || !measure_buy(static_trader, static_call, static_ack)) {
+            std::cout << "No response to order " << i << " of the dispatch comparison" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// authentication fails until the connection is open
+template<typename Trader>
+static bool connect_and_auth(Trader& trader, const std::string& url) {
+    if (trader.connect_trade_api() == WS_CON_ERR_CODE)
+        return false;
+
+    auto deadline = std::chrono::steady_clock::now() + E2E_CONNECT_TIMEOUT;
+    while (!trader.trade_api_auth()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cout << "Could not connect and authenticate to " << url << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    return true;
+}
+
+static void load_keys(const std::string& filename, trade_handler::api_key& key) {
+    std::ifstream ifs (filename);
+    json data = json::parse(ifs, nullptr, false);
+
+    if (data.is_discarded() || !data.contains("client_id")) {
+        key.id = key.secret = "mock";
+        return;
+    }
+
+    key.id = data["client_id"];
+    key.secret = data["client_secret"];
+}
+
+// usage: client_e2e_bench [url] [orders] [csv_file]
+// without a url (or with "mock") a mock server is started in-process on MOCK_DEFAULT_PORT
+// reports order-to-ack (request round trip) and tick-to-order (book change to order sent) latencies,
+// the time until the last ack of 100 orders sent one by one or as one batch, and the buy() path with
+// virtual and static dispatch
+int main(int argc, char* argv[]) {
+    tsc_clock::calibrate();
+    g_timer_start = tsc_clock::now();
+
+    std::string url = (argc > 1) ? argv[1] : "mock";
+    std::size_t orders = (argc > 2) ? std::stoul(argv[2]) : 1000;
+    std::string csv_file = (argc > 3) ? argv[3] : "";
+
+    std::unique_ptr<mock_deribit_server> mock;
+    if (url == "mock") {
+        mock_deribit_server::options opts;
+        opts.tick_interval = E2E_MOCK_TICK_INTERVAL;
+
+        mock = std::make_unique<mock_deribit_server>(opts);
+        if (!mock->start())
+            return 1;
+
+        url = "wss://localhost:" + std::to_string(opts.port);
+    }
+
+    trade_handler::api_key key;
+    load_keys("api_key.json", key);
+
+    deribit api {url};
+    client_trader trader {&api, key};
+
+    if (!connect_and_auth(trader, url))
+        return 1;
+
+    std::cout << "Connected to " << url << ", sending " << orders << " orders" << std::endl;
+
+    // order-to-ack: one order in flight at a time
+    latency_histogram* order_to_ack = latency_registry::instance().histogram("e2e_order_to_ack");
+    for (std::size_t i = 0; i < orders; i++) {
+        rpc_future response = trader.buy(tick_to_order_listener::order(0));
+
+        if (!response.valid() || response.wait_for(DERIBIT_RESPONSE_TIMEOUT) != std::future_status::ready) {
+            std::cout << "No response to order " << i << std::endl;
+            return 1;
+        }
+
+        rpc_response ack = response.get();
+        if (order_to_ack)
+            order_to_ack->record(ack.round_trip.count());
+    }
+
+    // 100 orders until the last ack: sent one by one, or in one batch written to the socket at once
+    if (!measure_batches(trader))
+        return 1;
+
+    // the same buy() path with the adapter type known at compile time, on its own connection
+    {
+        deribit static_api {url};
+        basic_client_trader<deribit> static_trader {&static_api, key};
+
+        if (!connect_and_auth(static_trader, url) || !measure_dispatch(trader, static_trader, orders))
+            return 1;
+
+        trade_handler::logout_params logout;
+        static_trader.logout(logout);
+    }
+
+    // tick-to-order: react to book changes on the network thread
+    tick_to_order_listener listener {trader, orders};
+    api.set_feed_listener(&listener);
+
+    trade_handler::subscriptions_params params;
+    params.channels = {"book." E2E_INSTRUMENT ".100ms"};
+    trader.subscribe(params);
+
+    bool completed = listener.wait();
+    trader.unsubscribe_all();
+    api.set_feed_listener(nullptr);
+
+    if (!completed)
+        std::cout << "Timed out waiting for book changes" << std::endl;
+
+    // let the responses to the last orders arrive before closing
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    trade_handler::logout_params logout;
+    trader.logout(logout);
+
+    if (mock)
+        mock->stop();
+
+    async_logger::instance().flush();
+    latency_registry::instance().print(std::cout);
+
+    if (!csv_file.empty()) {
+        std::ofstream ofs {csv_file};
+        latency_registry::instance().write_csv(ofs);
+        std::cout << "Wrote " << csv_file << std::endl;
+    }
+
+    return completed ? 0 : 1;
+}
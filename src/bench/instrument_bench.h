@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include <api/instrument_cache.h>
+#include <bench/bench_util.h>
+#include <bench/serialize_bench.h>
+
+namespace instrument_bench {
+
+// about as many instruments as deribit lists for every currency
+constexpr std::size_t INSTRUMENT_COUNT = 3000;
+
+inline instrument_info make_info(const char* tick_size, const char* contract_size, const char* min_trade_amount,
+    trade_handler::instrument_kind kind) {
+    instrument_info info;
+    info.tick_size = serialize_bench::decimal(tick_size);
+    info.contract_size = serialize_bench::decimal(contract_size);
+    info.min_trade_amount = serialize_bench::decimal(min_trade_amount);
+    info.kind = kind;
+    return info;
+}
+
+inline std::string option_name(std::size_t i) {
+    return "BTC-27DEC24-" + std::to_string(10000 + 1000 * i) + (i % 2 ? "-C" : "-P");
+}
+
+// orders the exchange would accept or reject for their price or amount, returns the number checked wrongly
+inline int check_rules(const instrument_cache& cache) {
+    struct test_order {
+        const char* instrument;
+        const char* amount;
+        const char* contracts;
+        const char* price;
+        bool valid;
+    };
+
+    static constexpr test_order orders[] = {
+        {"BTC-PERPETUAL", "10", "", "97123.5", true},
+        {"BTC-PERPETUAL", "", "3", "97123", true},          // 3 contracts of 10 USD
+        {"BTC-PERPETUAL", "10", "", "97123.25", false},     // off the 0.5 tick
+        {"BTC-PERPETUAL", "15", "", "97123.5", false},      // not a multiple of 10
+        {"BTC-PERPETUAL", "0", "", "97123.5", false},       // below the minimum
+        {"BTC-27DEC24-11000-C", "0.1", "", "0.0125", true},
+        {"BTC-27DEC24-11000-C", "0.05", "", "0.0125", false},
+        {"BTC-27DEC24-11000-C", "0.3", "", "0.01255", false},
+        {"BTC-27DEC24-11000-C", "", "0.2", "0.0125", true},
+        {"ETH-27DEC24-4000-C", "1", "", "0.05", false},     // unknown instrument
+    };
+
+    int failures = 0;
+    for(const test_order& order : orders) {
+        trade_handler::order_params params = serialize_bench::make_order(order.amount, order.contracts, order.price, "");
+        params.instrument = order.instrument;
+        failures += cache.check(params).empty() != order.valid;
+    }
+
+    // integer ticks and lots map back to the same decimals
+    const instrument_info* perpetual = cache.get("BTC-PERPETUAL");
+    failures += perpetual->ticks(serialize_bench::decimal("97123.5")) != 194247
+        || perpetual->price(194247) != serialize_bench::decimal("97123.5")
+        || perpetual->lots(serialize_bench::decimal("30")) != 3 || perpetual->amount(3) != serialize_bench::decimal("30");
+
+    return failures;
+}
+
+// adding an instrument again replaces its rules, the replaced rules stay readable
+inline int check_reload() {
+    instrument_cache cache;
+    cache.add("BTC-PERPETUAL", make_info("0.5", "10", "10", trade_handler::instrument_kind::future));
+    const instrument_info* before = cache.get("BTC-PERPETUAL");
+
+    trade_handler::order_params order = serialize_bench::make_order("10", "", "97123.5", "");
+    order.instrument = "BTC-PERPETUAL";
+
+    int failures = !cache.check(order).empty();
+
+    cache.add("BTC-PERPETUAL", make_info("1", "10", "10", trade_handler::instrument_kind::future));
+    failures += cache.check(order).empty() || cache.size() != 1 || cache.get("BTC-PERPETUAL") == before
+        || before->tick_size != serialize_bench::decimal("0.5");
+
+    // unchanged rules are not published again
+    const instrument_info* after = cache.get("BTC-PERPETUAL");
+    cache.add("BTC-PERPETUAL", make_info("1", "10", "10", trade_handler::instrument_kind::future));
+    failures += cache.get("BTC-PERPETUAL") != after;
+
+    return failures;
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 1000000;
+
+    std::cout << "instruments: " << INSTRUMENT_COUNT << " instruments, order checked before sending\n";
+
+    instrument_cache cache;
+    std::unordered_map<std::string, instrument_info> by_name; // reference: the rules in a map keyed by name
+
+    cache.add("BTC-PERPETUAL", make_info("0.5", "10", "10", trade_handler::instrument_kind::future));
+    by_name["BTC-PERPETUAL"] = *cache.get("BTC-PERPETUAL");
+
+    for(std::size_t i = 1; cache.size() < INSTRUMENT_COUNT; i++) {
+        std::string name = option_name(i);
+        instrument_info info = make_info("0.0005", "1", "0.1", trade_handler::instrument_kind::option);
+
+        cache.add(name, info);
+        by_name[name] = info;
+    }
+
+    if(int failures = check_rules(cache) + check_reload()) {
+        std::cout << "  " << failures << " orders checked wrongly\n";
+        return 1;
+    }
+
+    trade_handler::order_params order = serialize_bench::make_order("10", "", "97123.5", "strategy_a");
+
+    double check_ns = measure_ns_per_op([&] {
+        std::string_view reason = cache.check(order);
+        do_not_optimize(reason);
+    }, iterations);
+
+    double map_ns = measure_ns_per_op([&] {
+        auto it = by_name.find(std::string{std::string_view{order.instrument}});
+        do_not_optimize(it);
+    }, iterations);
+
+    double intern_ns = measure_ns_per_op([&] {
+        symbol_id id = cache.find(std::string_view{order.instrument});
+        do_not_optimize(id);
+    }, iterations);
+
+    print_bench_result("instrument_cache::check (lookup and rules)", check_ns);
+    print_bench_result("unordered_map<std::string> lookup by name", map_ns);
+    print_bench_result("symbol_table lookup by name", intern_ns);
+
+    return 0;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <lib/latency_histogram.h>
+#include <bench/bench_util.h>
+
+namespace latency_bench {
+
+// percentiles of the histogram must be within its resolution of the exact percentiles
+inline bool check_percentiles(const latency_histogram& hist, std::vector<std::uint64_t> samples) {
+    std::sort(samples.begin(), samples.end());
+
+    auto exact = [&](double percentile) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(percentile / 100 * samples.size()));
+        return samples[std::max<std::size_t>(rank, 1) - 1];
+    };
+
+    latency_histogram::summary s = hist.summarize();
+    const std::pair<std::uint64_t, std::uint64_t> checks[] = {
+        {s.p50, exact(50)}, {s.p90, exact(90)}, {s.p99, exact(99)}, {s.p999, exact(99.9)},
+        {s.min, samples.front()}, {s.max, samples.back()},
+    };
+
+    for(auto [reported, expected] : checks) {
+        double error = std::abs(static_cast<double>(reported) - static_cast<double>(expected)) / expected;
+        if(error > 1.0 / latency_histogram::SUB_BUCKET_HALF)
+            return false;
+    }
+
+    return s.count == samples.size();
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 10000000;
+    static constexpr std::size_t samples_count = 100000;
+
+    std::cout << "latency: histogram recording\n";
+
+    // log-normal latencies around 50us with a long tail
+    std::mt19937_64 rng {42};
+    std::lognormal_distribution<double> distribution {std::log(50000.0), 0.8};
+
+    latency_histogram hist;
+    std::vector<std::uint64_t> samples(samples_count);
+    for(std::uint64_t& sample : samples) {
+        sample = static_cast<std::uint64_t>(distribution(rng)) + 1;
+        hist.record(sample);
+    }
+
+    if(!check_percentiles(hist, samples)) {
+        std::cout << "  histogram percentiles outside of the expected error\n";
+        return 1;
+    }
+
+    std::uint64_t value = 0;
+    print_bench_result("latency_histogram::record", measure_ns_per_op([&] {
+        hist.record(samples[value++ % samples_count]);
+    }, iterations));
+
+    print_bench_result("latency_histogram::summarize", measure_ns_per_op([&] {
+        latency_histogram::summary s = hist.summarize();
+        do_not_optimize(s);
+    }, 1000));
+
+    return 0;
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <lib/utilities.h>
+#include <lib/benchmark.h>
+#include <bench/bench_util.h>
+
+namespace logging_bench {
+
+// APP_LOG before the async logger: formatted and flushed on the calling thread
+#define SYNC_APP_LOG(flag, message) \
+    do { \
+        if((ENABLED_LOG_FLAGS & flag) == log_flags::none) break; \
+        std::clog << "[" << std::right << std::setw(10) \
+        << std::chrono::duration_cast<std::chrono::milliseconds>(tsc_clock::now() - g_timer_start).count() \
+        << "ms] "; \
+        if(flag == log_flags::ws) std::clog << "websocket: "; \
+        std::clog << message << std::endl; \
+    } while(false)
+
+// time statements in batches smaller than the log queue, draining the queue between batches
+template<typename F>
+double measure_batched_ns_per_op(F&& fn) {
+    static constexpr std::size_t batches = 200;
+    static constexpr std::size_t batch_size = LOG_QUEUE_CAPACITY / 4;
+
+    std::chrono::nanoseconds total {0};
+
+    for(std::size_t b = 0; b < batches; b++) {
+        auto start = std::chrono::steady_clock::now();
+        for(std::size_t i = 0; i < batch_size; i++)
+            fn();
+        total += std::chrono::steady_clock::now() - start;
+
+        async_logger::instance().flush();
+    }
+
+    return static_cast<double>(total.count()) / (batches * batch_size);
+}
+
+// a char array is copied into the record, it may be reused before the logger thread formats it
+inline bool check_char_array_copied() {
+    std::ostringstream out;
+    std::streambuf* clog_buf = std::clog.rdbuf(out.rdbuf());
+
+    char buffer[16] = "first";
+    APP_LOG(log_flags::ws, "buffer: "_lit << buffer);
+    std::strcpy(buffer, "second");
+    async_logger::instance().flush();
+
+    std::clog.rdbuf(clog_buf);
+    return out.str().find("buffer: first") != std::string::npos;
+}
+
+inline int run() {
+    std::cout << "logging: cost on the calling thread (output to /dev/null)\n";
+
+    if(!check_char_array_copied()) {
+        std::cout << "  a logged char array was not copied\n";
+        return 1;
+    }
+
+    // measure the logging cost without terminal I/O
+    std::ofstream null_stream {"/dev/null"};
+    std::streambuf* clog_buf = std::clog.rdbuf(null_stream.rdbuf());
+
+    std::string label = "send_request_benchmark";
+    long elapsed = 42;
+
+    double sync_ns = measure_batched_ns_per_op([&] {
+        SYNC_APP_LOG(log_flags::ws, "Benchmark: " << label << ", took " << elapsed << " us");
+    });
+
+    double async_ns = measure_batched_ns_per_op([&] {
+        APP_LOG(log_flags::ws, "Benchmark: " << label << ", took " << elapsed << " us");
+    });
+
+    double literal_ns = measure_batched_ns_per_op([&] {
+        APP_LOG(log_flags::ws, "Benchmark: "_lit << label << ", took "_lit << elapsed << " us"_lit);
+    });
+
+    // start() and end() of the benchmark wrapped around every websocket send
+    benchmark send_benchmark {"send_request_benchmark"};
+    double benchmark_ns = measure_batched_ns_per_op([&] {
+        send_benchmark.start();
+        send_benchmark.end();
+    });
+
+    async_logger::instance().flush();
+    std::clog.rdbuf(clog_buf);
+
+    print_bench_result("synchronous APP_LOG (std::endl)", sync_ns);
+    print_bench_result("async APP_LOG", async_ns);
+    print_bench_result("async APP_LOG (_lit literals)", literal_ns);
+    print_bench_result("send_request_benchmark start + end", benchmark_ns);
+
+    return 0;
+}
+
+#undef SYNC_APP_LOG
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <market/order_book.h>
+#include <bench/bench_util.h>
+#include <bench/parse_bench.h>
+
+namespace order_book_bench {
+
+// feeds parsed book updates into the manager
+struct book_listener : deribit_feed_listener {
+    explicit book_listener(order_book_manager& books_): books{books_} {}
+    void on_book(const book_update& update) override { books.apply(update); }
+
+    order_book_manager& books;
+};
+
+inline int run() {
+    static constexpr std::size_t iterations = 1000000;
+
+    order_book_manager books;
+    int resnapshots = 0;
+    books.set_resnapshot_handler([&](std::string_view) { resnapshots++; });
+
+    deribit_message_parser parser;
+    book_listener listener {books};
+
+    std::cout << "order_book: local L2 book\n";
+
+    // snapshot, then a change continuing from it (prev_change_id is the snapshot's change_id)
+    const std::string& change = parse_bench::book_change_payload;
+    parser.parse(parse_bench::make_book_snapshot_payload(), listener);
+    parser.parse(change, listener);
+
+    price_level bid, ask;
+    if(!books.top_of_book("BTC-PERPETUAL", bid, ask) || bid.price != 104580.5 || bid.amount != 36220 || ask.price != 104581 || ask.amount != 17510) {
+        std::cout << "  unexpected top of book after snapshot + change\n";
+        return 1;
+    }
+
+    // replaying the same change is a gap
+    parser.parse(change, listener);
+    if(resnapshots != 1 || books.top_of_book("BTC-PERPETUAL", bid, ask)) {
+        std::cout << "  change_id gap was not detected\n";
+        return 1;
+    }
+    parser.parse(parse_bench::make_book_snapshot_payload(), listener);
+
+    // a change from another book channel of the instrument is ignored, not seen as a gap
+    std::string other_channel = change;
+    other_channel.replace(other_channel.find("100ms"), 5, "raw");
+    parser.parse(other_channel, listener);
+    if(resnapshots != 1 || !books.top_of_book("BTC-PERPETUAL", bid, ask)) {
+        std::cout << "  change from another book channel was applied\n";
+        return 1;
+    }
+
+    std::vector<price_level> bids, asks;
+    bids.reserve(10);
+    asks.reserve(10);
+
+    symbol_id instrument = instrument_symbols().find("BTC-PERPETUAL");
+
+    print_bench_result("top_of_book by name", measure_ns_per_op([&] {
+        books.top_of_book("BTC-PERPETUAL", bid, ask);
+        do_not_optimize(bid);
+    }, iterations));
+
+    print_bench_result("top_of_book by instrument id", measure_ns_per_op([&] {
+        books.top_of_book(instrument, bid, ask);
+        do_not_optimize(bid);
+    }, iterations));
+
+    print_bench_result("depth(10)", measure_ns_per_op([&] {
+        books.depth("BTC-PERPETUAL", 10, bids, asks);
+        do_not_optimize(bids);
+    }, iterations));
+
+    // alternate a level in and out of the book near the top
+    book_update update;
+    update.instrument = "BTC-PERPETUAL";
+    update.instrument_id = instrument;
+    update.bids.push_back(book_level{book_action::new_level, 104579.75, 100});
+    std::int64_t change_id = 75034532115;
+
+    print_bench_result("apply change (1 level)", measure_ns_per_op([&] {
+        update.prev_change_id = change_id;
+        update.change_id = ++change_id;
+        update.bids[0].action = (change_id & 1) ? book_action::new_level : book_action::remove;
+        books.apply(update);
+    }, iterations));
+
+    return 0;
+}
+
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <api/order_manager.h>
+#include <bench/bench_util.h>
+#include <bench/serialize_bench.h>
+
+namespace order_state_bench {
+
+// open orders resting on one instrument while the others are queried
+constexpr std::size_t OPEN_ORDERS = 1000;
+
+// messages recorded from test.deribit.com
+inline const std::string order_notification_payload =
+    R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"user.orders.any.any.raw","data":{)"
+    R"("web":false,"time_in_force":"good_til_cancelled","replaced":false,"reduce_only":false,"price":97123.5,)"
+    R"("post_only":false,"order_type":"limit","order_state":"open","order_id":"28736412833","max_show":20.0,)"
+    R"("last_update_timestamp":1737542318400,"label":"strategy_a","is_liquidation":false,"instrument_name":"BTC-PERPETUAL",)"
+    R"("filled_amount":10.0,"direction":"buy","creation_timestamp":1737542318367,"average_price":97123.5,"api":true,"amount":20.0}}})";
+
+inline const std::string buy_response_payload =
+    R"({"jsonrpc":"2.0","id":42,"result":{"trades":[],"order":{"time_in_force":"good_til_cancelled","price":97123.5,)"
+    R"("order_type":"limit","order_state":"open","order_id":"28736412833","last_update_timestamp":1737542318367,)"
+    R"("label":"strategy_a","instrument_name":"BTC-PERPETUAL","filled_amount":0.0,"direction":"buy","amount":20.0}},)"
+    R"("usIn":1737542318367012,"usOut":1737542318367234,"usDiff":222,"testnet":true})";
+
+inline const std::string user_trades_payload =
+    R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"user.trades.any.any.raw","data":[)"
+    R"({"trade_seq":147853014,"trade_id":"333853457","timestamp":1737542318500,"state":"filled","price":97123.5,)"
+    R"("order_id":"28736412833","instrument_name":"BTC-PERPETUAL","direction":"buy","amount":10.0}]}})";
+
+// keeps the last parsed messages
+struct recording_listener : deribit_feed_listener {
+    void on_orders(const orders_update& update) override { orders = update.orders; }
+    void on_user_trades(const user_trades_update& update) override { trades = update.trades; }
+    void on_order_response(const order_response& response) override { responses.push_back(response); }
+
+    std::vector<order_update> orders;
+    std::vector<user_trade> trades;
+    std::vector<order_response> responses;
+};
+
+inline order_update make_update(const char* order_id, const char* instrument, order_state state, const char* amount,
+    const char* filled_amount, std::int64_t timestamp, const char* label = "") {
+    order_update update;
+    update.order_id = order_id;
+    update.instrument = instrument;
+    update.instrument_id = instrument_symbols().intern(instrument);
+    update.label = label;
+    update.direction = order_direction::buy;
+    update.state = state;
+    update.amount = serialize_bench::decimal(amount);
+    update.filled_amount = serialize_bench::decimal(filled_amount);
+    update.price = serialize_bench::decimal("97123.5");
+    update.last_update_timestamp = timestamp;
+    return update;
+}
+
+inline order_response make_response(std::uint64_t id, const order_update& update) {
+    order_response response;
+    response.id = id;
+    response.orders.push_back(update);
+    return response;
+}
+
+// the parser and the lifecycle of orders, returns the number of failed checks
+inline int check_orders() {
+    int failures = 0;
+
+    recording_listener listener;
+    deribit_message_parser notifications;
+    deribit_message_parser responses {true};
+
+    // notifications, and a response only from a parser which parses responses
+    failures += !notifications.parse(order_notification_payload, listener) || listener.orders.size() != 1
+        || listener.orders[0].order_id != "28736412833" || listener.orders[0].state != order_state::open
+        || listener.orders[0].filled_amount != serialize_bench::decimal("10")
+        || listener.orders[0].instrument_id != instrument_symbols().find("BTC-PERPETUAL");
+
+    failures += !notifications.parse(buy_response_payload, listener) || !listener.responses.empty();
+
+    failures += !responses.parse(buy_response_payload, listener) || listener.responses.size() != 1
+        || listener.responses[0].id != 42 || listener.responses[0].orders.size() != 1
+        || listener.responses[0].orders[0].amount != serialize_bench::decimal("20")
+        || listener.responses[0].orders[0].direction != order_direction::buy;
+
+    failures += !notifications.parse(user_trades_payload, listener) || listener.trades.size() != 1
+        || listener.trades[0].state != order_state::filled || listener.trades[0].amount != serialize_bench::decimal("10");
+
+    order_manager orders;
+    tracked_order order;
+    std::vector<tracked_order> found;
+
+    // pending from the request, open from its response
+    orders.on_sent(1, "BTC-PERPETUAL", "a", order_direction::buy, serialize_bench::decimal("20"), serialize_bench::decimal("97123.5"));
+    failures += orders.open_orders("BTC-PERPETUAL", found) != 1 || found[0].state != order_state::pending;
+
+    orders.apply(make_response(1, make_update("A1", "BTC-PERPETUAL", order_state::open, "20", "0", 100, "a")));
+    failures += !orders.find("A1", order) || order.state != order_state::open || order.request_id != 1
+        || orders.get_stats().pending != 0 || orders.get_stats().tracked != 1;
+
+    // partially filled from a trade, the later order update is authoritative
+    user_trades_update trades;
+    trades.trades.push_back({"T1", "A1", "BTC-PERPETUAL", NO_SYMBOL, order_direction::buy, order_state::open,
+        serialize_bench::decimal("10"), serialize_bench::decimal("97123.5"), 200});
+    orders.apply(trades);
+    failures += !orders.find("A1", order) || order.state != order_state::partially_filled
+        || order.filled_amount != serialize_bench::decimal("10");
+
+    orders_update update;
+    update.orders.push_back(make_update("A1", "BTC-PERPETUAL", order_state::filled, "20", "20", 300, "a"));
+    orders.apply(update);
+    orders.apply(trades); // older than the order update
+    failures += !orders.find("A1", order) || order.state != order_state::filled || order.filled_amount != serialize_bench::decimal("20")
+        || orders.open_orders("BTC-PERPETUAL", found) != 0;
+
+    // notified before its response, tracked once the response merges them
+    orders.on_sent(2, "BTC-PERPETUAL", "b", order_direction::buy, serialize_bench::decimal("10"), serialize_bench::decimal("97000"));
+    update.orders.assign(1, make_update("B1", "BTC-PERPETUAL", order_state::open, "10", "0", 400, "b"));
+    orders.apply(update);
+    failures += orders.open_orders("BTC-PERPETUAL", found) != 2;
+
+    orders.apply(make_response(2, make_update("B1", "BTC-PERPETUAL", order_state::open, "10", "0", 400, "b")));
+    failures += orders.open_orders("BTC-PERPETUAL", found) != 1 || found[0].request_id != 2
+        || orders.find_by_label("b", found) != 1 || orders.get_stats().pending != 0;
+
+    // rejected, or never sent
+    orders.on_sent(3, "BTC-PERPETUAL", "c", order_direction::sell, serialize_bench::decimal("10"), serialize_bench::decimal("99000"));
+    order_response rejection;
+    rejection.id = 3;
+    rejection.error = true;
+    orders.apply(rejection);
+    failures += orders.find_by_label("c", found) != 1 || found[0].state != order_state::rejected;
+
+    orders.on_sent(4, "BTC-PERPETUAL", "d", order_direction::sell, serialize_bench::decimal("10"), serialize_bench::decimal("99000"));
+    orders.on_send_failed(4);
+    failures += orders.find_by_label("d", found) != 0 || orders.open_orders(found) != 1;
+
+    // closed orders are forgotten once the history is full
+    for(std::size_t i = 0; i < ORDER_MANAGER_HISTORY; i++) {
+        std::string id = "H" + std::to_string(i);
+        update.orders.assign(1, make_update(id.c_str(), "ETH-PERPETUAL", order_state::cancelled, "1", "0", 500));
+        orders.apply(update);
+    }
+    failures += orders.find("A1", order) || !orders.find("B1", order) || orders.get_stats().tracked != ORDER_MANAGER_HISTORY + 1;
+
+    // its session went down before the response, the exchange had accepted it: tracked once, from the resync
+    orders.on_sent(5, "BTC-PERPETUAL", "e", order_direction::buy, serialize_bench::decimal("10"), serialize_bench::decimal("96000"));
+    orders.on_send_failed(5);
+    order_response resync;
+    resync.id = 6;
+    resync.orders.push_back(make_update("E1", "BTC-PERPETUAL", order_state::open, "10", "0", 600, "e"));
+    orders.apply(resync);
+    failures += orders.find_by_label("e", found) != 1 || found[0].order_id != std::string_view{"E1"}
+        || orders.get_stats().pending != 0;
+
+    return failures;
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 1000000;
+
+    std::cout << "orders: order state tracked locally, " << OPEN_ORDERS << " open orders on another instrument\n";
+
+    if(int failures = check_orders()) {
+        std::cout << "  " << failures << " order state checks failed\n";
+        return 1;
+    }
+
+    order_manager orders;
+    orders_update update;
+    std::vector<std::string> ids;
+
+    for(std::size_t i = 0; i < OPEN_ORDERS; i++)
+        ids.push_back("E" + std::to_string(i));
+    for(std::size_t i = 0; i < OPEN_ORDERS; i++)
+        update.orders.push_back(make_update(ids[i].c_str(), "ETH-PERPETUAL", order_state::open, "1", "0", 100));
+    orders.apply(update);
+
+    // a few orders on the instrument of interest, the reference scans every tracked order
+    update.orders.clear();
+    for(const char* id : {"B1", "B2", "B3"})
+        update.orders.push_back(make_update(id, "BTC-PERPETUAL", order_state::open, "10", "0", 100));
+    orders.apply(update);
+
+    symbol_id instrument = instrument_symbols().find("BTC-PERPETUAL");
+    std::vector<tracked_order> found;
+    found.reserve(OPEN_ORDERS + 3);
+
+    double by_instrument_ns = measure_ns_per_op([&] {
+        std::size_t count = orders.open_orders(instrument, found);
+        do_not_optimize(count);
+    }, iterations);
+
+    double scan_ns = measure_ns_per_op([&] {
+        orders.open_orders(found);
+        std::size_t count = 0;
+        for(const tracked_order& order : found)
+            count += order.instrument == instrument;
+        do_not_optimize(count);
+    }, iterations / 100);
+
+    // a fill notified on an open order
+    update.orders.assign(1, make_update("B1", "BTC-PERPETUAL", order_state::open, "10", "0", 100));
+    std::int64_t timestamp = 100;
+
+    double apply_ns = measure_ns_per_op([&] {
+        update.orders[0].last_update_timestamp = ++timestamp;
+        orders.apply(update);
+    }, iterations);
+
+    tracked_order order;
+    double find_ns = measure_ns_per_op([&] {
+        bool known = orders.find("B2", order);
+        do_not_optimize(known);
+    }, iterations);
+
+    print_bench_result("order_manager::open_orders (by instrument id)", by_instrument_ns);
+    print_bench_result("every open order, filtered by instrument", scan_ns);
+    print_bench_result("order_manager::apply (order notification)", apply_ns);
+    print_bench_result("order_manager::find (by order id)", find_ns);
+
+    return 0;
+}
+
+}
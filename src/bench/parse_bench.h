@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string>
+
+#include <api/deribit_parser.h>
+#include <bench/bench_util.h>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace parse_bench {
+
+// notifications recorded from test.deribit.com
+inline const std::string book_change_payload =
+    R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"change",)"
+    R"("timestamp":1737542318367,"prev_change_id":75034532115,"instrument_name":"BTC-PERPETUAL","change_id":75034532205,)"
+    R"("bids":[["change",104580.5,36220.0],["new",104577.0,1240.0],["delete",104560.0,0.0]],)"
+    R"("asks":[["change",104581.0,17510.0],["new",104590.5,2000.0]]}}})";
+
+inline const std::string trades_payload =
+    R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"trades.BTC-PERPETUAL.100ms","data":[)"
+    R"({"trade_seq":147853014,"trade_id":"333853457","timestamp":1737542318379,"tick_direction":0,"price":104581.0,)"
+    R"("mark_price":104578.33,"instrument_name":"BTC-PERPETUAL","index_price":104534.46,"direction":"buy","amount":10.0},)"
+    R"({"trade_seq":147853015,"trade_id":"333853458","timestamp":1737542318379,"tick_direction":1,"price":104581.0,)"
+    R"("mark_price":104578.33,"instrument_name":"BTC-PERPETUAL","index_price":104534.46,"direction":"buy","amount":2500.0}]}})";
+
+// 50 levels per side, as sent on subscribing to book.BTC-PERPETUAL.100ms
+inline std::string make_book_snapshot_payload() {
+    std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"snapshot",)"
+        R"("timestamp":1737542318267,"instrument_name":"BTC-PERPETUAL","change_id":75034532115,"bids":[)";
+
+    for(int i = 0; i < 50; i++)
+        payload += (i ? "," : "") + std::string{"[\"new\","} + std::to_string(104580.5 - i * 0.5).substr(0, 8) + "," + std::to_string(1000 + 10 * i) + ".0]";
+    payload += R"(],"asks":[)";
+    for(int i = 0; i < 50; i++)
+        payload += (i ? "," : "") + std::string{"[\"new\","} + std::to_string(104581.0 + i * 0.5).substr(0, 8) + "," + std::to_string(2000 + 10 * i) + ".0]";
+    payload += "]}}}";
+
+    return payload;
+}
+
+// counts what the listener received, so that the parse is not optimized away
+struct counting_listener : deribit_feed_listener {
+    void on_book(const book_update& update) override {
+        levels += update.bids.size() + update.asks.size();
+        checksum += update.change_id + update.instrument_id;
+        for(auto& level : update.bids)
+            checksum += level.price * level.amount;
+        for(auto& level : update.asks)
+            checksum += level.price * level.amount;
+    }
+
+    void on_trades(const trades_update& update) override {
+        levels += update.trades.size();
+        for(auto& trade : update.trades)
+            checksum += trade.price * trade.amount + trade.trade_seq + trade.instrument_id;
+    }
+
+    std::size_t levels = 0;
+    double checksum = 0;
+};
+
+// the same extraction done on a json DOM
+inline void dom_parse(const std::string& payload, counting_listener& listener) {
+    json j = json::parse(payload);
+    const json& params = j["params"];
+    const std::string& channel = params["channel"].get_ref<const std::string&>();
+    const json& data = params["data"];
+
+    if(channel.compare(0, 5, "book.") == 0) {
+        book_update update;
+        update.snapshot = data["type"] == "snapshot";
+        update.instrument = data["instrument_name"].get_ref<const std::string&>();
+        update.instrument_id = instrument_symbols().intern(update.instrument);
+        update.timestamp = data["timestamp"];
+        update.change_id = data["change_id"];
+        update.prev_change_id = data.value("prev_change_id", 0);
+
+        for(const char* side : {"bids", "asks"}) {
+            auto& levels = (side[0] == 'b') ? update.bids : update.asks;
+            for(auto& level : data[side]) {
+                const std::string& action = level[0].get_ref<const std::string&>();
+                levels.push_back({action == "new" ? book_action::new_level : action == "change" ? book_action::change : book_action::remove,
+                    level[1].get<double>(), level[2].get<double>()});
+            }
+        }
+
+        listener.on_book(update);
+    } else {
+        trades_update update;
+        for(auto& item : data) {
+            trade_tick trade;
+            trade.price = item["price"];
+            trade.amount = item["amount"];
+            trade.buy = item["direction"] == "buy";
+            trade.timestamp = item["timestamp"];
+            trade.trade_seq = item["trade_seq"];
+            trade.instrument = item["instrument_name"].get_ref<const std::string&>();
+            trade.instrument_id = instrument_symbols().intern(trade.instrument);
+            trade.trade_id = item["trade_id"].get_ref<const std::string&>();
+            update.trades.push_back(trade);
+        }
+
+        listener.on_trades(update);
+    }
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 100000;
+
+    const std::string snapshot_payload = make_book_snapshot_payload();
+    const std::pair<const char*, const std::string*> payloads[] = {
+        {"book change (5 levels)", &book_change_payload},
+        {"book snapshot (100 levels)", &snapshot_payload},
+        {"trades (2 trades)", &trades_payload},
+    };
+
+    deribit_message_parser parser;
+    std::cout << "parse: inbound notifications\n";
+
+    for(auto& [name, payload] : payloads) {
+        // both parsers must extract the same values
+        counting_listener dom_result, scanner_result;
+        dom_parse(*payload, dom_result);
+        if(!parser.parse(*payload, scanner_result) || dom_result.levels != scanner_result.levels
+            || dom_result.checksum != scanner_result.checksum) {
+            std::cout << "  scanner result differs from json::parse for " << name << "\n";
+            return 1;
+        }
+
+        counting_listener listener;
+        double dom_ns = measure_ns_per_op([&] { dom_parse(*payload, listener); }, iterations);
+        double scanner_ns = measure_ns_per_op([&] { parser.parse(*payload, listener); }, iterations);
+        do_not_optimize(listener.checksum);
+
+        print_bench_result(std::string{name} + ", json::parse", dom_ns);
+        print_bench_result(std::string{name} + ", deribit_message_parser", scanner_ns);
+    }
+
+    return 0;
+}
+
+}
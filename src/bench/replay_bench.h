@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include <market/order_book.h>
+#include <websocket/message_journal.h>
+#include <bench/bench_util.h>
+#include <bench/order_book_bench.h>
+#include <bench/parse_bench.h>
+
+namespace replay_bench {
+
+// book change continuing from prev_change_id, alternately adding and removing a level below the top
+inline std::string make_book_change_payload(std::int64_t prev_change_id, std::int64_t change_id) {
+    const char* action = (change_id & 1) ? "new" : "delete";
+
+    return R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"change",)"
+        R"("timestamp":1737542318367,"prev_change_id":)" + std::to_string(prev_change_id) + R"(,"instrument_name":"BTC-PERPETUAL",)"
+        R"("change_id":)" + std::to_string(change_id) + R"(,"bids":[[")" + action + R"(",104577.0,1240.0]],"asks":[]}}})";
+}
+
+// journal of a book snapshot followed by a chain of changes, one every interval
+inline bool write_journal(const std::string& path, std::size_t changes, tsc_clock::duration interval) {
+    message_journal_writer writer;
+    if(!writer.open(path))
+        return false;
+
+    const std::string snapshot = parse_bench::make_book_snapshot_payload();
+    tsc_clock::time_point timestamp = tsc_clock::now();
+    writer.append(timestamp, journal_frame::text, snapshot.data(), snapshot.size());
+
+    std::int64_t change_id = 75034532115; // the snapshot's change_id
+    for(std::size_t i = 0; i < changes; i++, change_id++) {
+        const std::string change = make_book_change_payload(change_id, change_id + 1);
+        timestamp += interval;
+        writer.append(timestamp, journal_frame::text, change.data(), change.size());
+    }
+
+    return true;
+}
+
+// replay through the parser into a fresh book, returns non-zero on an unexpected result
+inline int replay(const std::string& path, double speed, std::size_t expected, replay_stats& stats) {
+    order_book_manager books;
+    int resnapshots = 0;
+    books.set_resnapshot_handler([&](std::string_view) { resnapshots++; });
+
+    deribit_message_parser parser;
+    order_book_bench::book_listener listener {books};
+
+    message_journal_reader reader;
+    if(!reader.open(path)) {
+        std::cout << "  could not open journal " << path << "\n";
+        return 1;
+    }
+
+    bool parsed = true;
+    stats = replay_journal(reader, speed, [&](const journal_record& record) {
+        parsed &= parser.parse(record.payload, listener);
+    });
+
+    price_level bid, ask;
+    if(!parsed || stats.messages != expected || resnapshots != 0 || !books.top_of_book("BTC-PERPETUAL", bid, ask)) {
+        std::cout << "  replay of " << path << " did not rebuild the book (" << stats.messages << " of " << expected << " messages)\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+inline int run() {
+    static constexpr std::size_t changes = 200000;
+    static constexpr std::size_t paced_changes = 1000;
+    static constexpr auto paced_interval = std::chrono::microseconds(20);
+
+    const std::string path = "/tmp/client_bench_replay.jrnl";
+
+    std::cout << "replay: recorded book feed through the parser and local book\n";
+
+    if(!write_journal(path, changes, std::chrono::microseconds(100))) {
+        std::cout << "  could not write journal " << path << "\n";
+        return 1;
+    }
+
+    replay_stats stats;
+    if(replay(path, 0, changes + 1, stats) != 0)
+        return 1;
+
+    print_bench_result("as fast as possible (" + std::to_string(changes + 1) + " messages)", static_cast<double>(stats.elapsed.count()) / stats.messages);
+    std::cout << "  " << static_cast<std::uint64_t>(stats.messages_per_second()) << " msg/s, "
+        << stats.bytes / (1 << 20) << " MiB\n";
+
+    // paced replay keeps the recorded spacing
+    if(!write_journal(path, paced_changes, paced_interval))
+        return 1;
+
+    if(replay(path, 1, paced_changes + 1, stats) != 0)
+        return 1;
+
+    auto recorded = std::chrono::duration_cast<std::chrono::nanoseconds>(paced_interval * paced_changes);
+    std::cout << "  paced replay (x1): " << stats.elapsed.count() / 1000 << " us for "
+        << recorded.count() / 1000 << " us recorded\n";
+
+    std::remove(path.c_str());
+
+    if(stats.elapsed < recorded) {
+        std::cout << "  paced replay ran ahead of the recording\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <api/deribit_encoder.h>
+#include <bench/bench_util.h>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace serialize_bench {
+
+// the request built by deribit::buy before the encoder was introduced
+inline std::string dump_order(const std::string& method, request_id_type id, const trade_handler::order_params& params) {
+    json request;
+    request["params"] = json::object();
+    request["params"]["instrument_name"] = params.instrument;
+
+    if(params.amount.has_value())
+        request["params"]["amount"] = params.amount.to_double();
+    if(params.contracts.has_value())
+        request["params"]["contracts"] = params.contracts.to_double();
+    if(params.type != trade_handler::order_type::unset)
+        request["params"]["type"] = to_token(params.type);
+    if(!params.label.empty())
+        request["params"]["label"] = params.label;
+    if(params.price.has_value())
+        request["params"]["price"] = params.price.to_double();
+    if(params.time_in_force != trade_handler::order_time_in_force::unset)
+        request["params"]["time_in_force"] = to_token(params.time_in_force);
+    if(params.trigger != trade_handler::order_trigger::unset) {
+        request["params"]["trigger"] = to_token(params.trigger);
+        request["params"]["trigger_price"] = params.trigger_price.to_double();
+    }
+
+    request["method"] = method;
+    request["jsonrpc"] = "2.0";
+    request["id"] = id;
+
+    return request.dump();
+}
+
+inline std::string dump_edit(request_id_type id, const trade_handler::order_params& params) {
+    json request;
+    request["params"] = json::object();
+    request["params"]["order_id"] = params.order_id;
+
+    if(params.amount.has_value())
+        request["params"]["amount"] = params.amount.to_double();
+    if(params.contracts.has_value())
+        request["params"]["contracts"] = params.contracts.to_double();
+    if(params.price.has_value())
+        request["params"]["price"] = params.price.to_double();
+    if(params.trigger_price.has_value())
+        request["params"]["trigger_price"] = params.trigger_price.to_double();
+
+    request["method"] = "private/edit";
+    request["jsonrpc"] = "2.0";
+    request["id"] = id;
+
+    return request.dump();
+}
+
+inline fixed_decimal decimal(std::string_view text) {
+    fixed_decimal value;
+    fixed_decimal::parse(text, value);
+    return value;
+}
+
+// amount, contracts and price as decimal text, empty for unset
+inline trade_handler::order_params make_order(std::string_view amount, std::string_view contracts, std::string_view price, std::string label) {
+    trade_handler::order_params params;
+    params.amount = decimal(amount);
+    params.contracts = decimal(contracts);
+    params.price = decimal(price);
+    params.instrument = "BTC-PERPETUAL";
+    params.type = trade_handler::order_type::limit;
+    params.label = label;
+    params.time_in_force = trade_handler::order_time_in_force::good_til_cancelled;
+    params.order_id = "ETH-349223";
+    return params;
+}
+
+// returns the number of frames which differ from the json output, compared as parsed json: the
+// frames write decimals exactly ("10"), json writes the nearest double ("10.0")
+inline int check_wire_format() {
+    std::vector<trade_handler::order_params> orders = {
+        make_order("10", "", "97123.5", "strategy_a"),
+        make_order("0.1", "0.1", "3150.25", ""),
+        make_order("", "40", "0.0001", "quote \" and \\ backslash"),
+        make_order("92233720368.54775807", "", "0.00000001", "tab\tcontrol\x01"),
+        make_order("-12.3456789", "", "97123.45", "negative"),
+    };
+
+    orders[1].trigger = trade_handler::order_trigger::mark_price;
+    orders[1].trigger_price = decimal("3100.5");
+    orders[2].type = trade_handler::order_type::unset;
+    orders[2].time_in_force = trade_handler::order_time_in_force::unset;
+
+    deribit_order_encoder encoder;
+    int mismatches = 0;
+    request_id_type id = 1;
+
+    auto compare = [&](const std::string& expected, std::string_view actual) {
+        if(json::parse(expected) == json::parse(actual, nullptr, false))
+            return;
+        mismatches++;
+        std::cout << "  mismatch:\n    json:    " << expected << "\n    encoder: " << actual << "\n";
+    };
+
+    for(auto& order : orders) {
+        compare(dump_order("private/buy", id, order), encoder.encode_order("private/buy", id, order));
+        compare(dump_order("private/sell", id, order), encoder.encode_order("private/sell", id, order));
+        compare(dump_edit(id, order), encoder.encode_edit(id, order));
+        compare(json{{"id", id}, {"jsonrpc", "2.0"}, {"method", "private/cancel"}, {"params", {{"order_id", order.order_id}}}}.dump(),
+            encoder.encode_cancel(id, order));
+        compare(json{{"id", id}, {"jsonrpc", "2.0"}, {"method", "private/cancel_all_by_instrument"},
+            {"params", {{"instrument_name", order.instrument}, {"type", "limit"}}}}.dump(),
+            encoder.encode_cancel_all_by_instrument(id, order.instrument, "limit"));
+        compare(json{{"id", id}, {"jsonrpc", "2.0"}, {"method", "private/cancel_by_label"},
+            {"params", {{"currency", "BTC"}, {"label", order.label}}}}.dump(),
+            encoder.encode_cancel_by_label(id, order.label, trade_handler::currency_code::BTC));
+        id = id * 1000 + 7;
+    }
+
+    // templates carry the same members, padded with whitespace, and refuse labels which need escaping
+    deribit_order_template order_template;
+    for(auto& order : orders) {
+        trade_handler::order_params expected = order;
+        if(expected.amount.has_value())
+            expected.contracts = {}; // a template has a single size member
+
+        // patched twice, the second frame must not keep anything of the first
+        order_template.compile("private/sell", order);
+        order_template.frame(id, decimal("-92233720368.54775807"), decimal("-0.5"), order.label.empty() ? "" : "a_placeholder_label");
+        std::string_view frame = order_template.frame(id, expected.amount.has_value() ? expected.amount : expected.contracts,
+            order.price, order.label);
+
+        std::string_view label = order.label;
+        bool plain = std::none_of(label.begin(), label.end(), [](char c) {
+            return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+        });
+
+        if(plain ? json::parse(frame, nullptr, false) != json::parse(dump_order("private/sell", id, expected)) : !frame.empty()) {
+            mismatches++;
+            std::cout << "  mismatch:\n    json:     " << dump_order("private/sell", id, expected) << "\n    template: " << frame << "\n";
+        }
+        id = id * 1000 + 7;
+    }
+
+    return mismatches;
+}
+
+// every token parses back to its value, anything else is rejected; returns the number of failures
+template<typename Enum, std::size_t N>
+int check_tokens(const std::string_view (&tokens)[N]) {
+    int failures = 0;
+
+    for(std::size_t i = 0; i < N; i++) {
+        Enum value = static_cast<Enum>(N - 1 - i);
+        failures += !parse_token(tokens[i], value) || value != static_cast<Enum>(i) || to_token(value) != tokens[i];
+    }
+
+    for(std::string_view unknown : {"limt", "LIMIT", "limit ", "all_", "x"}) {
+        Enum value {};
+        failures += parse_token(unknown, value) && to_token(value) != unknown;
+    }
+
+    return failures;
+}
+
+// decimals written by to_chars parse back to the same value, and the text is the shortest exact one
+inline int check_decimals() {
+    static constexpr std::string_view valid[] = {"0", "10", "97123.5", "0.00000001", "-0.0001", "92233720368.54775807",
+        "-92233720368.54775807", "3100.25"};
+    static constexpr std::string_view invalid[] = {"", "-", "1.", "1.000000001", "1e5", "92233720368.54775808", "1,5", "0x10"};
+
+    int failures = 0;
+    for(std::string_view text : valid) {
+        fixed_decimal value;
+        char written[32];
+        failures += !fixed_decimal::parse(text, value)
+            || std::string_view{written, static_cast<std::size_t>(value.to_chars(written, written + sizeof(written)) - written)} != text;
+    }
+
+    for(std::string_view text : invalid) {
+        fixed_decimal value;
+        failures += fixed_decimal::parse(text, value);
+    }
+
+    // the float the order fields used to be
+    failures += fixed_decimal::from_double(97123.45).units() != 9712345000000 || static_cast<double>(97123.45f) == 97123.45;
+    return failures;
+}
+
+inline int run() {
+    static constexpr std::size_t iterations = 200000;
+
+    std::cout << "serialize: private/buy frame\n";
+
+    int mismatches = check_wire_format();
+    if(mismatches) {
+        std::cout << "  " << mismatches << " frames differ from request.dump()\n";
+        return 1;
+    }
+
+    int failures = check_decimals()
+        + check_tokens<trade_handler::order_type>({"", "limit", "stop_limit", "take_limit", "market", "stop_market",
+            "take_market", "market_limit", "trailing_stop"})
+        + check_tokens<trade_handler::open_orders_type>({"", "all", "limit", "trigger_all", "stop_all", "stop_limit",
+            "stop_market", "take_all", "take_limit", "take_market", "trailing_all", "trailing_stop"})
+        + check_tokens<trade_handler::currency_code>({"", "BTC", "ETH", "USDC", "USDT", "EURR", "any"});
+    if(failures) {
+        std::cout << "  " << failures << " decimals or tokens do not round trip\n";
+        return 1;
+    }
+
+    trade_handler::order_params order = make_order("10", "", "97123.5", "strategy_a");
+    deribit_order_encoder encoder;
+    request_id_type id = 1;
+
+    double json_ns = measure_ns_per_op([&] {
+        std::string frame = dump_order("private/buy", id++, order);
+        do_not_optimize(frame);
+    }, iterations);
+
+    double encoder_ns = measure_ns_per_op([&] {
+        std::string_view frame = encoder.encode_order("private/buy", id++, order);
+        do_not_optimize(frame);
+    }, iterations);
+
+    deribit_order_template order_template;
+    order_template.compile("private/buy", order);
+    fixed_decimal price = order.price;
+
+    double template_ns = measure_ns_per_op([&] {
+        std::string_view frame = order_template.frame(id++, order.amount, price, order.label);
+        price = fixed_decimal::from_units(price.units() + fixed_decimal::scale / 2);
+        do_not_optimize(frame);
+    }, iterations);
+
+    print_bench_result("json request.dump()", json_ns);
+    print_bench_result("deribit_order_encoder", encoder_ns);
+    print_bench_result("deribit_order_template", template_ns);
+
+    // the REPL side: a token as typed, against the arrays deribit::validate_order searched
+    static constexpr std::array<const char*, 8> type_names = {"limit", "stop_limit", "take_limit", "market", "stop_market",
+        "take_market", "market_limit", "trailing_stop"};
+    static constexpr std::string_view inputs[] = {"limit", "trailing_stop", "market", "take_market"};
+    std::size_t input = 0;
+
+    double find_ns = measure_ns_per_op([&] {
+        std::string_view text = inputs[input++ & 3];
+        bool found = std::find(type_names.begin(), type_names.end(), text) != type_names.end();
+        do_not_optimize(found);
+    }, iterations);
+
+    double hash_ns = measure_ns_per_op([&] {
+        trade_handler::order_type type;
+        bool found = parse_token(inputs[input++ & 3], type);
+        do_not_optimize(found);
+    }, iterations);
+
+    print_bench_result("order type, std::find over the names", find_ns);
+    print_bench_result("order type, perfect hash", hash_ns);
+
+    return 0;
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include <lib/latency_histogram.h>
+#include <lib/tsc_clock.h>
+#include <bench/bench_util.h>
+
+namespace wakeup_bench {
+
+// time from posting a handler to an io_service until it runs on the network thread, which is idle
+// in between, as it is between inbound messages
+inline latency_histogram::summary measure(bool busy_poll) {
+    static constexpr std::size_t samples = 2000;
+    static constexpr auto idle_time = std::chrono::microseconds(50);
+
+    boost::asio::io_service io_service;
+    auto work = std::make_unique<boost::asio::io_service::work>(io_service);
+
+    std::thread network_thread([&] {
+        if(!busy_poll) {
+            io_service.run();
+            return;
+        }
+
+        while(!io_service.stopped())
+            io_service.poll();
+    });
+
+    latency_histogram wakeup;
+    std::atomic<bool> handled {false};
+
+    for(std::size_t i = 0; i < samples; i++) {
+        std::this_thread::sleep_for(idle_time);
+
+        handled.store(false, std::memory_order_relaxed);
+        tsc_clock::time_point posted = tsc_clock::now();
+
+        io_service.post([&] {
+            wakeup.record((tsc_clock::now() - posted).count());
+            handled.store(true, std::memory_order_release);
+        });
+
+        while(!handled.load(std::memory_order_acquire))
+            ;
+    }
+
+    work.reset();
+    network_thread.join();
+
+    return wakeup.summarize();
+}
+
+inline void print_summary(const char* label, const latency_histogram::summary& s) {
+    std::cout << "  " << std::left << std::setw(24) << label << std::right
+        << "p50 " << std::setw(7) << s.p50 << " ns  p99 " << std::setw(7) << s.p99 << " ns  max " << std::setw(8) << s.max << " ns\n";
+}
+
+inline int run() {
+    std::cout << "wakeup: handler posted to an idle network thread\n";
+
+    latency_histogram::summary blocking = measure(false);
+    print_summary("blocking (epoll)", blocking);
+
+    // the spinning thread would share the only core with the thread posting to it
+    if(std::thread::hardware_concurrency() < 2) {
+        std::cout << "  busy poll skipped, it needs a core of its own\n";
+        return blocking.count == 0;
+    }
+
+    latency_histogram::summary busy_poll = measure(true);
+    print_summary("busy poll", busy_poll);
+
+    if(blocking.count == 0 || busy_poll.count == 0) {
+        std::cout << "  no wakeups recorded\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+}
@@ -2,46 +2,659 @@
 
 #include <websocket/websocket.h>
 #include <api/trade_handler.h>
+#include <api/trade_handler_traits.h>
+#include <api/session_supervisor.h>
+#include <api/instrument_cache.h>
+#include <api/order_manager.h>
+#include <lib/utilities.h>
 
 #include <string>
+#include <string_view>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
 constexpr int default_trade_con_id = -1;
+constexpr auto CLIENT_CLOCK_PROBE_INTERVAL = std::chrono::seconds(1);
 
-class client_trader {
+// The client of one exchange adapter. With a final adapter type (eg. basic_client_trader<deribit>) the
+// order path is bound at compile time and can be inlined, and using an operation the adapter does not
+// implement fails to compile (see trade_handler_traits).
+// client_trader, for trade_handler, dispatches every operation at runtime, for the REPL.
+template<typename Handler>
+class basic_client_trader {
 public:
-    client_trader(trade_handler* trade_handler_, trade_handler::api_key key);
+    typedef trade_handler_traits<Handler> traits;
+
+    // one network thread for the order entry session and one for the market data session
+    static websocket_endpoint::options default_endpoint_options();
+
+    // once authenticated the sessions are supervised: reconnected when they fail, with a standby for order entry,
+    // and the trading rules of every instrument are loaded
+    basic_client_trader(Handler* trade_handler_, trade_handler::api_key key,
+        websocket_endpoint::options endpoint_options = default_endpoint_options(),
+        session_supervisor::options supervisor_options = {});
+
+    // the supervisor and the clock probe send through the endpoint, they are stopped before it is destroyed
+    ~basic_client_trader();
+
+    // record every message sent and received to <base_path>.<index>.audit, before connecting
+    bool open_audit_journal(const std::string& base_path);
 
     con_id_type connect_trade_api();
-    void trade_api_auth();
-    void test_trade_api();
+    bool trade_api_auth();
+    rpc_future test_trade_api();
+
+    rpc_future buy(const trade_handler::order_params& params);
+    rpc_future sell(const trade_handler::order_params& params);
+    rpc_future edit(const trade_handler::order_params& params);
+    rpc_future cancel(const trade_handler::order_params& params);
+    rpc_future get_open_orders(const trade_handler::open_orders_params& params);
+    rpc_future get_order_book(const trade_handler::order_book_params& params);
+    rpc_future get_positions(const trade_handler::positions_params& params);
+
+    // sent in one write, one future per order
+    std::vector<rpc_future> buy_batch(const std::vector<trade_handler::order_params>& orders);
+    std::vector<rpc_future> sell_batch(const std::vector<trade_handler::order_params>& orders);
+    std::vector<rpc_future> cancel_batch(const std::vector<trade_handler::order_params>& orders);
+
+    rpc_future cancel_all_by_instrument(const trade_handler::cancel_all_params& params);
+    rpc_future cancel_by_label(const trade_handler::cancel_label_params& params);
+
+    // orders validated and serialized once, for adapters with order templates
+    template<typename Template>
+    bool make_buy_template(const trade_handler::order_params& params, Template& order_template);
+    template<typename Template>
+    bool make_sell_template(const trade_handler::order_params& params, Template& order_template);
+    template<typename Template>
+    rpc_future send_order(Template& order_template, fixed_decimal size, fixed_decimal price = {}, std::string_view label = {});
 
-    void buy(trade_handler::order_params params);
-    void sell(trade_handler::order_params params);
-    void edit(trade_handler::order_params params);
-    void cancel(trade_handler::order_params params);
-    void get_open_orders(trade_handler::open_orders_params params);
-    void get_order_book(trade_handler::order_book_params params);
-    void get_positions(trade_handler::positions_params params);
+    rpc_future subscribe(const trade_handler::subscriptions_params& params);
+    rpc_future unsubscribe_all();
 
-    void subscribe(trade_handler::subscriptions_params params);
-    void unsubscribe_all();
+    // reload the trading rules of the instruments of a currency, replacing the rules of those already loaded
+    rpc_future load_instruments(trade_handler::currency_code currency);
 
-    void logout(trade_handler::logout_params params);
+    void logout(const trade_handler::logout_params& params);
+
+    bool start_recording(const std::string& path);
+    void stop_recording();
+    replay_stats replay(const std::string& path, double speed);
 
     void print_trade_messages();
+    void print_local_order_book(const std::string& instrument, std::size_t depth);
+    void print_network_stats();
+    void print_session_stats();
+    void print_exchange_clock();
+    void print_instrument(const std::string& instrument);
+    // open orders of an instrument, of every instrument when empty
+    void print_orders(const std::string& instrument);
+    // an order by order id, or the orders carrying a label
+    void print_order(const std::string& order);
 private:
     void trade_handler_init();
 
 private:
     websocket_endpoint m_endpoint;
+    session_supervisor::options m_supervisor_options;
+    std::unique_ptr<session_supervisor> m_supervisor;
 
     con_id_type m_trade_api_con_id = default_trade_con_id;
     trade_handler::api_key m_key;
 
     bool m_trade_api_connected = false;
     bool m_trade_api_auth = false;
-    trade_handler* m_trade_handler;
-};
\ No newline at end of file
+    Handler* m_trade_handler;
+};
+
+typedef basic_client_trader<trade_handler> client_trader;
+
+// instantiated once, in client_trader.cpp
+extern template class basic_client_trader<trade_handler>;
+
+template<typename Handler>
+websocket_endpoint::options basic_client_trader<Handler>::default_endpoint_options() {
+    websocket_endpoint::options opts;
+    opts.worker_cpus.assign(2, NO_CPU);
+    return opts;
+}
+
+template<typename Handler>
+basic_client_trader<Handler>::basic_client_trader(Handler* trade_handler_, trade_handler::api_key key, websocket_endpoint::options endpoint_options,
+    session_supervisor::options supervisor_options)
+    : m_endpoint{std::move(endpoint_options)}
+    , m_supervisor_options{supervisor_options} {
+    m_key = key;
+    m_trade_handler = trade_handler_;
+
+    trade_handler_init();
+}
+
+template<typename Handler>
+basic_client_trader<Handler>::~basic_client_trader() {
+    m_supervisor.reset();
+    m_trade_handler->stop_clock_probe();
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::test_trade_api() {
+    if(!m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Not connected to trade API");
+        return {};
+    }
+
+    return m_trade_handler->test();
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::buy(const trade_handler::order_params& params) {
+    static_assert(traits::buy, "the trade handler does not implement buy");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+    
+    return m_trade_handler->buy(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::sell(const trade_handler::order_params& params) {
+    static_assert(traits::sell, "the trade handler does not implement sell");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->sell(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::edit(const trade_handler::order_params& params) {
+    static_assert(traits::edit, "the trade handler does not implement edit");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+    
+    return m_trade_handler->edit(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::cancel(const trade_handler::order_params& params) {
+    static_assert(traits::cancel, "the trade handler does not implement cancel");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+    
+    return m_trade_handler->cancel(params);
+}
+
+template<typename Handler>
+std::vector<rpc_future> basic_client_trader<Handler>::buy_batch(const std::vector<trade_handler::order_params>& orders) {
+    static_assert(traits::buy_batch, "the trade handler does not implement buy_batch");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return std::vector<rpc_future>(orders.size());
+    }
+
+    return m_trade_handler->buy_batch(orders.data(), orders.size());
+}
+
+template<typename Handler>
+std::vector<rpc_future> basic_client_trader<Handler>::sell_batch(const std::vector<trade_handler::order_params>& orders) {
+    static_assert(traits::sell_batch, "the trade handler does not implement sell_batch");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return std::vector<rpc_future>(orders.size());
+    }
+
+    return m_trade_handler->sell_batch(orders.data(), orders.size());
+}
+
+template<typename Handler>
+std::vector<rpc_future> basic_client_trader<Handler>::cancel_batch(const std::vector<trade_handler::order_params>& orders) {
+    static_assert(traits::cancel_batch, "the trade handler does not implement cancel_batch");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return std::vector<rpc_future>(orders.size());
+    }
+
+    return m_trade_handler->cancel_batch(orders.data(), orders.size());
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::cancel_all_by_instrument(const trade_handler::cancel_all_params& params) {
+    static_assert(traits::cancel_all_by_instrument, "the trade handler does not implement cancel_all_by_instrument");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->cancel_all_by_instrument(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::cancel_by_label(const trade_handler::cancel_label_params& params) {
+    static_assert(traits::cancel_by_label, "the trade handler does not implement cancel_by_label");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->cancel_by_label(params);
+}
+
+template<typename Handler>
+template<typename Template>
+bool basic_client_trader<Handler>::make_buy_template(const trade_handler::order_params& params, Template& order_template) {
+    static_assert(traits::order_templates, "the trade handler has no order templates");
+
+    return m_trade_handler->make_buy_template(params, order_template);
+}
+
+template<typename Handler>
+template<typename Template>
+bool basic_client_trader<Handler>::make_sell_template(const trade_handler::order_params& params, Template& order_template) {
+    static_assert(traits::order_templates, "the trade handler has no order templates");
+
+    return m_trade_handler->make_sell_template(params, order_template);
+}
+
+template<typename Handler>
+template<typename Template>
+rpc_future basic_client_trader<Handler>::send_order(Template& order_template, fixed_decimal size, fixed_decimal price, std::string_view label) {
+    static_assert(traits::order_templates, "the trade handler has no order templates");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->send_order(order_template, size, price, label);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::get_open_orders(const trade_handler::open_orders_params& params) {
+    static_assert(traits::get_open_orders, "the trade handler does not implement get_open_orders");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+    
+    return m_trade_handler->get_open_orders(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::get_order_book(const trade_handler::order_book_params& params) {
+    static_assert(traits::get_order_book, "the trade handler does not implement get_order_book");
+
+    return m_trade_handler->get_order_book(params);
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_trade_messages() {
+    if(!m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Not connected to trade API");
+        return;
+    }
+
+    const std::pair<const char*, con_id_type> sessions[] = {
+        {"Order entry session", m_trade_handler->order_con_id()},
+        {"Market data session", m_trade_handler->market_data_con_id()}
+    };
+
+    for(const auto& [name, con_id] : sessions) {
+        std::ostringstream out;
+        out << "> " << name << "\n";
+
+        // the audit journal holds the complete history, the in-memory one only the latest messages
+        if(m_endpoint.has_audit_journal()) {
+            if(m_endpoint.print_audit_trail(con_id, out))
+                APP_PRINT(out.str());
+            continue;
+        }
+
+        connection_metadata::ptr metadata_ptr = m_endpoint.get_metadata(con_id);
+
+        if(!metadata_ptr) {
+            APP_LOG(log_flags::client_trader, "Error fetching metadata");
+            continue;
+        }
+
+        out << *metadata_ptr;
+        APP_PRINT(out.str());
+    }
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_local_order_book(const std::string& instrument, std::size_t depth) {
+    static constexpr int column_width = 16;
+
+    const order_book_manager* books = m_trade_handler->get_order_books();
+    if(!books) {
+        APP_LOG(log_flags::client_trader, "Local order books not supported by trade API");
+        return;
+    }
+
+    std::vector<price_level> bids, asks;
+    if(!books->depth(instrument, depth, bids, asks)) {
+        APP_LOG(log_flags::client_trader, "No local order book for " << instrument << ", subscribe to book." << instrument << ".100ms");
+        return;
+    }
+
+    std::ostringstream out;
+    out << std::left << std::setw(column_width) << "bid amount" << std::setw(column_width) << "bid"
+        << std::setw(column_width) << "ask" << std::setw(column_width) << "ask amount" << "\n";
+
+    for(std::size_t i = 0; i < std::max(bids.size(), asks.size()); i++) {
+        if(i < bids.size())
+            out << std::setw(column_width) << bids[i].amount << std::setw(column_width) << bids[i].price;
+        else
+            out << std::setw(2 * column_width) << "";
+
+        if(i < asks.size())
+            out << std::setw(column_width) << asks[i].price << std::setw(column_width) << asks[i].amount;
+        out << "\n";
+    }
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_network_stats() {
+    if(m_endpoint.run_mode() != network_run_mode::busy_poll) {
+        APP_PRINT("Network threads block in epoll, start with --busy-poll for spin statistics");
+        return;
+    }
+
+    std::ostringstream out;
+    for(std::size_t i = 0; i < m_endpoint.worker_count(); i++) {
+        websocket_endpoint::worker_stats stats = m_endpoint.get_worker_stats(i);
+        double idle = stats.polls ? 100.0 * stats.idle_polls / stats.polls : 0;
+
+        out << "network thread " << i << " (cpu " << (stats.cpu == NO_CPU ? std::string{"any"} : std::to_string(stats.cpu)) << "): "
+            << stats.polls << " polls, " << stats.idle_polls << " found no work (" << std::fixed << std::setprecision(4) << idle << "%), "
+            << stats.handlers << " handlers run\n";
+    }
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_session_stats() {
+    if(!m_supervisor) {
+        APP_LOG(log_flags::client_trader, "Sessions are supervised once authenticated");
+        return;
+    }
+
+    session_supervisor::stats stats = m_supervisor->get_stats();
+
+    std::ostringstream out;
+    out << "order entry session: " << m_trade_handler->order_con_id()
+        << ", market data session: " << m_trade_handler->market_data_con_id()
+        << ", standby: " << (stats.standby == WS_CON_ERR_CODE ? std::string{"none"} : std::to_string(stats.standby)) << "\n"
+        << stats.failovers << " failovers, " << stats.reconnects << " reconnects, "
+        << stats.failed_attempts << " failed connection attempts\n";
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_exchange_clock() {
+    const exchange_clock* clock = m_trade_handler->get_exchange_clock();
+    if(!clock) {
+        APP_LOG(log_flags::client_trader, "Exchange clock not supported by trade API");
+        return;
+    }
+
+    exchange_clock::estimate estimate = clock->get();
+    if(!estimate.valid()) {
+        APP_PRINT("No exchange clock samples yet, authenticate or run deribit_test");
+        return;
+    }
+
+    std::ostringstream out;
+    out << estimate.samples << " samples, round trip " << estimate.rtt_ns / 1000 << " us (best "
+        << estimate.min_rtt_ns / 1000 << " us), exchange clock " << (estimate.skew_ns >= 0 ? "ahead of" : "behind")
+        << " the system clock by " << std::abs(estimate.skew_ns) / 1000 << " us\n"
+        << "exchange time: " << clock->exchange_now() << " ns since the epoch\n";
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_instrument(const std::string& instrument) {
+    const instrument_cache* instruments = m_trade_handler->get_instruments();
+    if(!instruments) {
+        APP_LOG(log_flags::client_trader, "Instrument cache not supported by trade API");
+        return;
+    }
+
+    const instrument_info* info = instruments->get(instrument);
+    if(!info) {
+        APP_PRINT(instrument << " not in the instrument cache (" << instruments->size() << " instruments loaded)");
+        return;
+    }
+
+    std::ostringstream out;
+    out << instrument << " (id " << instruments->find(instrument) << "): " << info->kind
+        << ", tick size " << info->tick_size << ", contract size " << info->contract_size
+        << ", min trade amount " << info->min_trade_amount << "\n";
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_orders(const std::string& instrument) {
+    const order_manager* orders = m_trade_handler->get_orders();
+    if(!orders) {
+        APP_LOG(log_flags::client_trader, "Order tracking not supported by trade API");
+        return;
+    }
+
+    std::vector<tracked_order> open;
+    if(instrument.empty())
+        orders->open_orders(open);
+    else
+        orders->open_orders(instrument, open);
+
+    order_manager::stats stats = orders->get_stats();
+
+    std::ostringstream out;
+    out << open.size() << " open orders (" << stats.tracked << " tracked, " << stats.pending << " pending)\n";
+    for(const tracked_order& order : open)
+        out << order << "\n";
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::print_order(const std::string& order) {
+    const order_manager* orders = m_trade_handler->get_orders();
+    if(!orders) {
+        APP_LOG(log_flags::client_trader, "Order tracking not supported by trade API");
+        return;
+    }
+
+    std::vector<tracked_order> found(1);
+    if(!orders->find(order, found.front()))
+        orders->find_by_label(order, found);
+
+    if(found.empty()) {
+        APP_PRINT("No order tracked with id or label " << order);
+        return;
+    }
+
+    std::ostringstream out;
+    for(const tracked_order& tracked : found)
+        out << tracked << "\n";
+
+    APP_PRINT(out.str());
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::trade_handler_init() {
+    m_trade_handler->init(&m_endpoint, m_key);
+}
+
+template<typename Handler>
+bool basic_client_trader<Handler>::open_audit_journal(const std::string& base_path) {
+    return m_endpoint.open_audit_journal(base_path);
+}
+
+template<typename Handler>
+con_id_type basic_client_trader<Handler>::connect_trade_api() {
+    m_trade_api_con_id = m_trade_handler->connect();
+    
+    if(m_trade_api_con_id != WS_CON_ERR_CODE)
+        m_trade_api_connected = true;
+    else
+        APP_LOG(log_flags::client_trader, "Could not connect to trade API");
+
+    return m_trade_api_con_id;
+}
+
+template<typename Handler>
+bool basic_client_trader<Handler>::trade_api_auth() {
+    if(!m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Not connected to trade API");
+        return false;
+    }
+
+    auto ec = m_trade_handler->auth();
+    if(!ec)
+        m_trade_api_auth = true;
+    else
+        APP_LOG(log_flags::client_trader, "Authentication failed");
+
+    // from now on failed sessions are replaced without another connect and auth
+    if(m_trade_api_auth && !m_supervisor) {
+        m_supervisor = std::make_unique<session_supervisor>(*m_trade_handler, m_supervisor_options);
+        m_supervisor->start();
+    }
+
+    if(m_trade_api_auth)
+        m_trade_handler->start_clock_probe(CLIENT_CLOCK_PROBE_INTERVAL);
+
+    // orders are checked against the rules once the response arrives, on the network thread
+    if(m_trade_api_auth && traits::instruments)
+        m_trade_handler->load_instruments(trade_handler::currency_code::any);
+
+    // orders are tracked from the open ones on the exchange, then from the notifications
+    if(m_trade_api_auth && traits::order_tracking)
+        m_trade_handler->track_orders();
+
+    return m_trade_api_auth;
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::get_positions(const trade_handler::positions_params& params) {
+    static_assert(traits::get_positions, "the trade handler does not implement get_positions");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->get_positions(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::subscribe(const trade_handler::subscriptions_params& params) {
+    static_assert(traits::subscribe, "the trade handler does not implement subscribe");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->subscribe(params);
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::unsubscribe_all() {
+    static_assert(traits::unsubscribe_all, "the trade handler does not implement unsubscribe_all");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return {};
+    }
+
+    return m_trade_handler->unsubscribe_all();
+}
+
+template<typename Handler>
+rpc_future basic_client_trader<Handler>::load_instruments(trade_handler::currency_code currency) {
+    static_assert(traits::instruments, "the trade handler does not implement load_instruments");
+
+    // a public method, the session only needs to be connected
+    if(!m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Not connected to trade API");
+        return {};
+    }
+
+    return m_trade_handler->load_instruments(currency);
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::logout(const trade_handler::logout_params& params) {
+    static_assert(traits::logout, "the trade handler does not implement logout");
+
+    if(!m_trade_api_auth) {
+        APP_LOG(log_flags::client_trader, "Not authenticated to trade API");
+        return;
+    }
+
+    // a closed session must not be reconnected
+    m_supervisor.reset();
+    m_trade_handler->stop_clock_probe();
+
+    m_trade_handler->logout(params);
+    m_trade_handler->disconnect("client logout");
+
+    m_trade_api_auth = false;
+    m_trade_api_connected = false;
+    m_trade_api_con_id = default_trade_con_id;
+}
+
+template<typename Handler>
+bool basic_client_trader<Handler>::start_recording(const std::string& path) {
+    if(!m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Not connected to trade API");
+        return false;
+    }
+
+    return m_trade_handler->start_recording(path);
+}
+
+template<typename Handler>
+void basic_client_trader<Handler>::stop_recording() {
+    if(!m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Not connected to trade API");
+        return;
+    }
+
+    m_trade_handler->stop_recording();
+}
+
+template<typename Handler>
+replay_stats basic_client_trader<Handler>::replay(const std::string& path, double speed) {
+    // replayed messages go through the same handler state as the network thread
+    if(m_trade_api_connected) {
+        APP_LOG(log_flags::client_trader, "Can not replay while connected to trade API, logout first");
+        return {};
+    }
+
+    return m_trade_handler->replay(path, speed);
+}
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <websocket/websocket.h>
 #include <api/trade_handler.h>
@@ -15,8 +16,10 @@ using json = nlohmann::json;
 #include <lib/utilities.h>
 #include <lib/benchmark.h>
 
-std::chrono::time_point<std::chrono::high_resolution_clock> g_timer_start;
-benchmark g_benchmark {"g_benchmark"};
+#define CLIENT_AUDIT_PATH "trade_audit"
+
+tsc_clock::time_point g_timer_start;
+thread_local benchmark g_benchmark {"g_benchmark"};
 
 void load_keys(std::string filename, trade_handler::api_key& key) {
     std::ifstream ifs (filename);
@@ -26,15 +29,39 @@ void load_keys(std::string filename, trade_handler::api_key& key) {
     key.secret = data["client_secret"];
 }
 
+// an empty line leaves the variable as it was, false if the line is not a valid value
 template<typename T>
-void read_var(T& var) {
+bool read_var(T& var) {
     std::string s;
     std::getline(std::cin, s);
 
     std::stringstream ss {s};
-    ss >> var;
+    bool valid = static_cast<bool>(ss >> var) || (ss.eof() && s.find_first_not_of(" \t") == std::string::npos);
 
     std::cin.clear();
+    if(!valid)
+        std::cout << "Invalid value: " << s << std::endl;
+    return valid;
+}
+
+// reads the optional fields of a command, false if one of them is not a valid value
+template<typename... Fields>
+bool read_fields(std::istream& is, Fields&... fields) {
+    bool valid = true;
+    auto read = [&](auto& field) {
+        std::string token;
+        if(!valid || !(is >> token))
+            return;
+
+        std::stringstream ss {token};
+        if(!(ss >> field)) {
+            std::cout << "Invalid value: " << token << std::endl;
+            valid = false;
+        }
+    };
+
+    (read(fields), ...);
+    return valid;
 }
 
 void show_help_text() {
@@ -61,6 +88,23 @@ void show_help_text() {
         << std::setw(cmd_width) << "deribit_order_book [instrument_name] [depth]"
         << "Retrieves the order book, along with other market values for a given instrument\n"
         
+        << std::setw(cmd_width) << "deribit_local_book [instrument_name] [depth]"
+        << "Show the order book maintained locally from a book.{instrument_name}.* subscription\n"
+
+        << std::setw(cmd_width) << "deribit_orders [instrument_name]"
+        << "Show the open orders tracked locally, of every instrument by default\n"
+
+        << std::setw(cmd_width) << "deribit_order <order_id|label>"
+        << "Show the state of an order tracked locally, or of the orders carrying a label\n"
+
+        << std::setw(cmd_width) << "deribit_instruments [currency]"
+        << "Reload the trading rules of the instruments of a currency, replacing those loaded on auth\n"
+        << std::setw(cmd_width) << " "
+        << "\tcurrency: BTC ETH USDC USDT EURR any (default)\n"
+
+        << std::setw(cmd_width) << "deribit_instrument <instrument_name>"
+        << "Show the tick size, contract size and min trade amount orders are checked against\n"
+
         << std::setw(cmd_width) << "deribit_positions [currency] [kind]"
         << "Retrieve user positions\n"
         << std::setw(cmd_width) << " "
@@ -77,8 +121,16 @@ void show_help_text() {
         << std::setw(cmd_width) << "deribit_edit"
         << "Change price, amount and/or other properties of an order in interactive command-line mode\n"
         
-        << std::setw(cmd_width) << "deribit_cancel [order_id]"
-        << "Cancel an order, specified by order id\n"
+        << std::setw(cmd_width) << "deribit_cancel [order_id...]"
+        << "Cancel one or more orders, specified by order id, several are sent in one write\n"
+
+        << std::setw(cmd_width) << "deribit_cancel_all [instrument_name] [type]"
+        << "Cancel all orders of an instrument\n"
+        << std::setw(cmd_width) << " "
+        << "\ttype: all limit trigger_all stop take trailing_stop\n"
+
+        << std::setw(cmd_width) << "deribit_cancel_label [label] [currency]"
+        << "Cancel all orders carrying a label\n"
 
         << std::setw(cmd_width) << "deribit_open_orders [kind] [type]"
         << "Retrieves list of user's open orders across many currencies\n"
@@ -98,63 +150,154 @@ void show_help_text() {
         << std::setw(cmd_width) << "deribit_logout [<bool> invalidate_token]"
         << "Gracefully close websocket connection\n"
 
+        << std::setw(cmd_width) << "deribit_record <filename>"
+        << "Record every message received on the connection into a journal\n"
+
+        << std::setw(cmd_width) << "deribit_record_stop"
+        << "Stop recording and close the journal\n"
+
+        << std::setw(cmd_width) << "deribit_replay <filename> [speed]"
+        << "Replay a journal through the message handling while disconnected\n"
+        << std::setw(cmd_width) << " "
+        << "\tspeed: 1 recorded pace (default), N times faster, 0 as fast as possible\n"
+
+        << std::setw(cmd_width) << "benchmark_stats [label]"
+        << "Show latency percentiles (ns) recorded for every benchmark label, or for one label\n"
+
+        << std::setw(cmd_width) << "benchmark_csv [filename]"
+        << "Export latency percentiles of every benchmark label as CSV (default: benchmark.csv)\n"
+
+        << std::setw(cmd_width) << "benchmark_reset"
+        << "Clear all recorded latencies\n"
+
+        << std::setw(cmd_width) << "network_stats"
+        << "Show spin statistics of the network threads (with --busy-poll)\n"
+
+        << std::setw(cmd_width) << "session_stats"
+        << "Show the active and standby sessions, failovers and reconnects\n"
+
+        << std::setw(cmd_width) << "clock_selftest"
+        << "Check the calibrated TSC clock against the system steady clock\n"
+
+        << std::setw(cmd_width) << "exchange_clock"
+        << "Show the round trip to the exchange and the offset of its clock, sampled every second\n"
+
         << std::setw(cmd_width) << "quit"
         << "Exit the program\n";
 
     std::cout.flags(original_flags); // restore original flags
 }
 
-void order_interface(trade_handler::order_params& params, std::string& order_type) {
+// false if a field is not valid, the order is then not sent
+bool order_interface(trade_handler::order_params& params, std::string& order_type) {
     std::cout << "Enter " << order_type << " order details\n";
 
-    params.amount = params.contracts = params.price = params.trigger_price = -1;
-
     if(order_type != "edit") {
         std::cout << "Instrument: ";
-        read_var(params.instrument);
+        if(!read_var(params.instrument))
+            return false;
     } else {
         std::cout << "Order ID: ";
-        read_var(params.order_id);
+        if(!read_var(params.order_id))
+            return false;
     }
 
     std::cout << "Amount: ";
-    read_var(params.amount);
+    if(!read_var(params.amount))
+        return false;
 
     std::cout << "Contracts: ";
-    read_var(params.contracts);
+    if(!read_var(params.contracts))
+        return false;
 
     std::cout << "Price: ";
-    read_var(params.price);
+    if(!read_var(params.price))
+        return false;
 
     if(order_type != "edit") {
         std::cout << "Type: ";
-        read_var(params.type);
+        if(!read_var(params.type))
+            return false;
 
         std::cout << "Label: ";
-        read_var(params.label);
+        if(!read_var(params.label))
+            return false;
 
         std::cout << "Time in force: ";
-        read_var(params.time_in_force);
+        if(!read_var(params.time_in_force))
+            return false;
 
         std::cout << "Trigger: ";
-        read_var(params.trigger);
+        if(!read_var(params.trigger))
+            return false;
     }
 
     std::cout << "Trigger Price: ";
-    read_var(params.trigger_price);
+    return read_var(params.trigger_price);
 }
 
-int main() {
+// usage: client_trader [url] [audit_path] [--cpus <order_cpu>,<market_data_cpu>] [--busy-poll] [--realtime <priority>]
+//                      [--busy-poll-us <us>] [--rcvbuf <bytes>] [--sndbuf <bytes>] [--no-tls-resume] [--no-standby]
+// url of the Deribit API websocket, default: DERIBIT_TESTNET_URL
+// audit_path: base name of the audit journal segments, default: CLIENT_AUDIT_PATH
+// --cpus: cpus the network threads of the order entry and market data sessions are pinned to, -1 for none
+// --busy-poll: network threads spin on the sockets instead of sleeping in epoll, each keeps a core busy
+// --realtime: run the network threads under SCHED_FIFO with this priority
+// --busy-poll-us: SO_BUSY_POLL time set on the sockets
+// --rcvbuf, --sndbuf: SO_RCVBUF / SO_SNDBUF of the sockets
+// --no-tls-resume: always do a full TLS handshake on reconnects
+// --no-standby: no authenticated standby connection for the order entry session
+int main(int argc, char* argv[]) {
     // start global timer
-    g_timer_start = std::chrono::high_resolution_clock::now();
+    tsc_clock::calibrate();
+    g_timer_start = tsc_clock::now();
+
+    websocket_endpoint::options endpoint_options = client_trader::default_endpoint_options();
+    session_supervisor::options supervisor_options;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--cpus" && i + 1 < argc) {
+            if (!parse_cpu_list(argv[++i], endpoint_options.worker_cpus)) {
+                std::cout << "Invalid cpu list: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--busy-poll") {
+            endpoint_options.run_mode = network_run_mode::busy_poll;
+        } else if (arg == "--realtime" && i + 1 < argc) {
+            endpoint_options.realtime_priority = std::atoi(argv[++i]);
+        } else if (arg == "--busy-poll-us" && i + 1 < argc) {
+            endpoint_options.busy_poll_us = std::atoi(argv[++i]);
+        } else if (arg == "--rcvbuf" && i + 1 < argc) {
+            endpoint_options.receive_buffer = std::atoi(argv[++i]);
+        } else if (arg == "--sndbuf" && i + 1 < argc) {
+            endpoint_options.send_buffer = std::atoi(argv[++i]);
+        } else if (arg == "--no-tls-resume") {
+            endpoint_options.tls_session_resumption = false;
+        } else if (arg == "--no-standby") {
+            supervisor_options.standby = false;
+        } else {
+            args.push_back(arg);
+        }
+    }
 
     trade_handler::api_key key;
     load_keys("api_key.json", key);
 
-    std::unique_ptr<deribit> deribit_uptr = std::make_unique<deribit>();
+    std::string url = (args.size() > 0) ? args[0] : DERIBIT_TESTNET_URL;
+
+    // the handler outlives the trader: the trader stops its threads, then its endpoint joins the network
+    // threads, which call into the handler until then
+    std::unique_ptr<deribit> deribit_uptr = std::make_unique<deribit>(url);
     trade_handler* deribit_handler = deribit_uptr.get();
 
-    client_trader trader {deribit_handler, key};
+    client_trader trader {deribit_handler, key, endpoint_options, supervisor_options};
+
+    std::string audit_path = (args.size() > 1) ? args[1] : CLIENT_AUDIT_PATH;
+    if (!trader.open_audit_journal(audit_path))
+        std::cout << "Could not open the audit journal, messages are only kept in memory" << std::endl;
 
     bool done = false;
     std::string input;
@@ -187,7 +330,9 @@ int main() {
             trade_handler::positions_params params;
 
             std::stringstream ss{input};
-            ss >> cmd >> params.currency >> params.kind;
+            ss >> cmd;
+            if (!read_fields(ss, params.currency, params.kind))
+                continue;
 
             trader.get_positions(params);
 
@@ -204,7 +349,10 @@ int main() {
             else if(input.substr(0,12) == "deribit_edit")
                 order_type = "edit";
 
-            order_interface(params, order_type);
+            if (!order_interface(params, order_type)) {
+                std::cout << "Order not sent" << std::endl;
+                continue;
+            }
 
             g_benchmark.reset("e2e_" + order_type + "_order_" + "benchmark");
             g_benchmark.start();
@@ -216,23 +364,71 @@ int main() {
             else
                 trader.edit(params);
 
+        } else if (input.substr(0,18) == "deribit_cancel_all") {
+            std::string cmd;
+            trade_handler::cancel_all_params params;
+
+            std::stringstream ss{input};
+            ss >> cmd >> params.instrument >> params.type;
+
+            trader.cancel_all_by_instrument(params);
+
+        } else if (input.substr(0,20) == "deribit_cancel_label") {
+            std::string cmd;
+            trade_handler::cancel_label_params params;
+
+            std::stringstream ss{input};
+            ss >> cmd >> params.label;
+            if (!read_fields(ss, params.currency))
+                continue;
+
+            trader.cancel_by_label(params);
+
         } else if (input.substr(0,14) == "deribit_cancel") {
             std::string cmd;
+            std::vector<trade_handler::order_params> orders;
             trade_handler::order_params params;
 
             std::stringstream ss{input};
-            ss >> cmd >> params.order_id;
+            ss >> cmd;
+            while (ss >> params.order_id)
+                orders.push_back(params);
 
-            trader.cancel(params);
+            if (orders.size() > 1)
+                trader.cancel_batch(orders);
+            else
+                trader.cancel(orders.empty() ? params : orders.front());
 
         } else if (input.substr(0,19) == "deribit_open_orders") {
             std::string cmd;
             trade_handler::open_orders_params params;
 
             std::stringstream ss{input};
-            ss >> cmd >> params.kind >> params.type;
+            ss >> cmd;
+            if (!read_fields(ss, params.kind, params.type))
+                continue;
 
             trader.get_open_orders(params);
+        } else if (input.substr(0,19) == "deribit_instruments") {
+            std::string cmd;
+            trade_handler::currency_code currency = trade_handler::currency_code::any;
+
+            std::stringstream ss{input};
+            ss >> cmd;
+            if (!read_fields(ss, currency))
+                continue;
+
+            trader.load_instruments(currency);
+
+        } else if (input.substr(0,18) == "deribit_instrument") {
+            std::string cmd;
+            std::string instrument;
+
+            std::stringstream ss{input};
+            ss >> cmd >> instrument;
+
+            trader.print_instrument(instrument);
+
         } else if (input.substr(0,18) == "deribit_order_book") {
             std::string cmd;
             trade_handler::order_book_params params;
@@ -243,6 +439,34 @@ int main() {
 
             trader.get_order_book(params);
 
+        } else if (input.substr(0,14) == "deribit_orders") {
+            std::string cmd;
+            std::string instrument;
+
+            std::stringstream ss{input};
+            ss >> cmd >> instrument;
+
+            trader.print_orders(instrument);
+
+        } else if (input.substr(0,13) == "deribit_order") {
+            std::string cmd;
+            std::string order;
+
+            std::stringstream ss{input};
+            ss >> cmd >> order;
+
+            trader.print_order(order);
+
+        } else if (input.substr(0,18) == "deribit_local_book") {
+            std::string cmd;
+            std::string instrument;
+            std::size_t depth = 10;
+
+            std::stringstream ss{input};
+            ss >> cmd >> instrument >> depth;
+
+            trader.print_local_order_book(instrument, depth);
+
         } else if (input.substr(0,11) == "deribit_sub") {
             std::string cmd;
             std::string channels_str;
@@ -279,6 +503,84 @@ int main() {
 
             trader.logout(params);
 
+        } else if (input.substr(0,19) == "deribit_record_stop") {
+            trader.stop_recording();
+
+        } else if (input.substr(0,14) == "deribit_record") {
+            std::string cmd;
+            std::string filename;
+
+            std::stringstream ss{input};
+            if (!(ss >> cmd >> filename)) {
+                std::cout << "Usage: deribit_record <filename>" << std::endl;
+                continue;
+            }
+
+            trader.start_recording(filename);
+
+        } else if (input.substr(0,14) == "deribit_replay") {
+            std::string cmd;
+            std::string filename;
+            double speed = 1;
+
+            std::stringstream ss{input};
+            if (!(ss >> cmd >> filename)) {
+                std::cout << "Usage: deribit_replay <filename> [speed]" << std::endl;
+                continue;
+            }
+            ss >> speed;
+
+            replay_stats stats = trader.replay(filename, speed);
+            std::cout << "Replayed " << stats.messages << " messages (" << stats.bytes << " bytes) in "
+                << std::chrono::duration_cast<std::chrono::microseconds>(stats.elapsed).count() << " us, "
+                << static_cast<std::uint64_t>(stats.messages_per_second()) << " msg/s" << std::endl;
+
+        } else if (input.substr(0,15) == "benchmark_stats") {
+            std::string cmd;
+            std::string label;
+
+            std::stringstream ss{input};
+            ss >> cmd >> label;
+
+            latency_registry::instance().print(std::cout, label);
+
+        } else if (input.substr(0,13) == "benchmark_csv") {
+            std::string cmd;
+            std::string filename = "benchmark.csv";
+
+            std::stringstream ss{input};
+            ss >> cmd >> filename;
+
+            std::ofstream ofs {filename};
+            if (!ofs) {
+                std::cout << "Could not open " << filename << std::endl;
+                continue;
+            }
+
+            latency_registry::instance().write_csv(ofs);
+            std::cout << "Wrote " << filename << std::endl;
+
+        } else if (input.substr(0,15) == "benchmark_reset") {
+            latency_registry::instance().reset();
+
+        } else if (input.substr(0,13) == "network_stats") {
+            trader.print_network_stats();
+
+        } else if (input.substr(0,13) == "session_stats") {
+            trader.print_session_stats();
+
+        } else if (input.substr(0,14) == "exchange_clock") {
+            trader.print_exchange_clock();
+
+        } else if (input.substr(0,14) == "clock_selftest") {
+            tsc_clock::calibration_report report = tsc_clock::self_test();
+
+            if (report.tsc)
+                std::cout << "TSC clock: " << report.ghz << " GHz, drift " << report.drift_ppm
+                    << " ppm, offset " << report.offset_ns << " ns" << std::endl;
+            else
+                std::cout << "No invariant TSC, timing uses steady_clock" << std::endl;
+
         } else {
             std::cout << "Unrecognized Command" << std::endl;
         }
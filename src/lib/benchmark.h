@@ -3,20 +3,28 @@
 #include <chrono>
 
 #include <lib/utilities.h>
+#include <lib/latency_histogram.h>
+#include <lib/tsc_clock.h>
 
+// Times start() / end() pairs and records each one, in nanoseconds, into the latency
+// histogram of its label (see latency_registry). Benchmarks sharing a label share the histogram.
 class benchmark {
 public:
-    benchmark(std::string lab): label{lab} {}
-    
+    benchmark(std::string lab): label{lab}, histogram{latency_registry::instance().histogram(label)} {}
+
     void reset(std::string lab = "") {
         started = false;
-        label = lab;
+
+        if(lab != label) {
+            label = lab;
+            histogram = label.empty() ? nullptr : latency_registry::instance().histogram(label);
+        }
     }
 
     void start() {
-        APP_LOG(log_flags::benchmark, "Started benchmark: " << label);
+        APP_LOG(log_flags::benchmark, "Started benchmark: "_lit << label);
         started = true;
-        start_time = std::chrono::high_resolution_clock::now();
+        start_time = tsc_clock::now();
     }
 
     void end() {
@@ -25,17 +33,21 @@ public:
             return;
         }
 
-        end_time = std::chrono::high_resolution_clock::now();
+        end_time = tsc_clock::now_ordered();
+
+        auto elapsed_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+        if(histogram)
+            histogram->record(static_cast<std::uint64_t>(elapsed_time));
 
-        auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-        APP_LOG(log_flags::benchmark, "Benchmark: " << label << ", took " << elapsed_time << " us");
+        APP_LOG(log_flags::benchmark, "Benchmark: "_lit << label << ", took "_lit << elapsed_time << " ns"_lit);
 
         started = false;
     }
 private:
     std::string label;
+    latency_histogram* histogram;
 
     bool started = false;
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
-    std::chrono::time_point<std::chrono::high_resolution_clock> end_time;
-};
\ No newline at end of file
+    tsc_clock::time_point start_time;
+    tsc_clock::time_point end_time;
+};
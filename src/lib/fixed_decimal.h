@@ -0,0 +1,130 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Decimal number with 8 digits after the point, stored as an integer count of 1e-8 units, for prices
+// and amounts: 97123.45 is exactly 97123.45 (as a float it is 97123.453125).
+// A default constructed value is unset, and is left out of a request.
+// The range is about +-9.2e10, which covers prices and amounts in any currency.
+class fixed_decimal {
+public:
+    static constexpr int places = 8;
+    static constexpr std::int64_t scale = 100000000;
+
+    constexpr fixed_decimal() = default;
+
+    static constexpr fixed_decimal from_units(std::int64_t units) { return fixed_decimal{units}; }
+    static constexpr fixed_decimal from_integer(std::int64_t value) { return fixed_decimal{value * scale}; }
+
+    // rounded to the nearest unit, unset if the value is not finite or out of range
+    static fixed_decimal from_double(double value) {
+        double units = std::round(value * scale);
+        if(!std::isfinite(units) || std::abs(units) >= 9.2e18)
+            return {};
+        return fixed_decimal{static_cast<std::int64_t>(units)};
+    }
+
+    // exact decimal text, eg. "97123.5", "-0.0001"; false for anything else or more than 8 places
+    static bool parse(std::string_view text, fixed_decimal& value) {
+        bool negative = !text.empty() && text.front() == '-';
+        if(negative)
+            text.remove_prefix(1);
+
+        std::size_t point = text.find('.');
+        std::string_view whole = text.substr(0, point);
+        std::string_view fraction = point == std::string_view::npos ? std::string_view{} : text.substr(point + 1);
+
+        if((whole.empty() && fraction.empty()) || fraction.size() > places || (point != std::string_view::npos && fraction.empty()))
+            return false;
+
+        std::int64_t units = 0;
+        for(char c : whole) {
+            if(c < '0' || c > '9' || units > (max_units - (c - '0')) / 10)
+                return false;
+            units = units * 10 + (c - '0');
+        }
+
+        std::int64_t fraction_units = 0;
+        std::int64_t unit = scale;
+        for(char c : fraction) {
+            if(c < '0' || c > '9')
+                return false;
+            unit /= 10;
+            fraction_units += (c - '0') * unit;
+        }
+
+        if(units > (max_units - fraction_units) / scale)
+            return false;
+
+        units = units * scale + fraction_units;
+        value = fixed_decimal{negative ? -units : units};
+        return true;
+    }
+
+    constexpr bool has_value() const { return m_units != unset_units; }
+    constexpr std::int64_t units() const { return m_units; }
+    constexpr double to_double() const { return static_cast<double>(m_units) / scale; }
+
+    // plain decimal notation without trailing zeros, eg. "97123.5", "10", "0.00000001"; the value must be set
+    // at most 21 characters are written
+    char* to_chars(char* first, char* last) const {
+        std::uint64_t magnitude = m_units < 0 ? 0 - static_cast<std::uint64_t>(m_units) : m_units;
+        if(m_units < 0)
+            *first++ = '-';
+
+        first = std::to_chars(first, last, magnitude / scale).ptr;
+
+        std::uint64_t fraction = magnitude % scale;
+        if(fraction == 0)
+            return first;
+
+        char digits[places];
+        int length = places;
+        for(int i = places - 1; i >= 0; i--) {
+            digits[i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        while(digits[length - 1] == '0')
+            length--;
+
+        *first++ = '.';
+        for(int i = 0; i < length; i++)
+            *first++ = digits[i];
+        return first;
+    }
+
+    friend constexpr bool operator==(fixed_decimal a, fixed_decimal b) { return a.m_units == b.m_units; }
+    friend constexpr bool operator!=(fixed_decimal a, fixed_decimal b) { return a.m_units != b.m_units; }
+    friend constexpr bool operator<(fixed_decimal a, fixed_decimal b) { return a.m_units < b.m_units; }
+
+    friend std::ostream& operator<<(std::ostream& os, fixed_decimal value) {
+        if(!value.has_value())
+            return os << "unset";
+
+        char text[32];
+        return os << std::string_view{text, static_cast<std::size_t>(value.to_chars(text, text + sizeof(text)) - text)};
+    }
+
+    // reads one whitespace-delimited decimal, an invalid one sets failbit and leaves the value as it was
+    friend std::istream& operator>>(std::istream& is, fixed_decimal& value) {
+        std::string text;
+        if(is >> text && !parse(text, value))
+            is.setstate(std::ios_base::failbit);
+        return is;
+    }
+
+private:
+    static constexpr std::int64_t unset_units = std::numeric_limits<std::int64_t>::min();
+    static constexpr std::int64_t max_units = std::numeric_limits<std::int64_t>::max();
+
+    constexpr explicit fixed_decimal(std::int64_t units): m_units(units) {}
+
+    std::int64_t m_units = unset_units;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cctype>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string_view>
+
+// Fixed-capacity string stored inline (no heap allocation), for short identifiers such as
+// instrument names, labels and order ids.
+// Converts implicitly to std::string_view. A value longer than the capacity is rejected:
+// assign() returns false and leaves the string empty, operator>> sets failbit.
+template<std::size_t Capacity>
+class inline_string {
+public:
+    inline_string() = default;
+    explicit inline_string(std::string_view s) { assign(s); }
+    explicit inline_string(const char* s) { assign(s); }
+
+    inline_string& operator=(std::string_view s) {
+        assign(s);
+        return *this;
+    }
+
+    inline_string& operator=(const char* s) {
+        assign(s);
+        return *this;
+    }
+
+    bool assign(std::string_view s) {
+        if(s.size() > Capacity) {
+            clear();
+            return false;
+        }
+
+        std::memcpy(m_data, s.data(), s.size());
+        m_size = s.size();
+        m_data[m_size] = '\0';
+        return true;
+    }
+
+    void clear() {
+        m_size = 0;
+        m_data[0] = '\0';
+    }
+
+    const char* data() const { return m_data; }
+    const char* c_str() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::size_t length() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    operator std::string_view() const { return std::string_view{m_data, m_size}; }
+
+    friend bool operator==(const inline_string& a, const inline_string& b) { return std::string_view{a} == std::string_view{b}; }
+    friend bool operator!=(const inline_string& a, const inline_string& b) { return !(a == b); }
+    friend bool operator==(const inline_string& a, std::string_view b) { return std::string_view{a} == b; }
+    friend bool operator==(std::string_view a, const inline_string& b) { return a == std::string_view{b}; }
+    friend bool operator!=(const inline_string& a, std::string_view b) { return std::string_view{a} != b; }
+    friend bool operator!=(std::string_view a, const inline_string& b) { return a != std::string_view{b}; }
+
+    friend std::ostream& operator<<(std::ostream& os, const inline_string& s) {
+        return os << std::string_view{s};
+    }
+
+    // reads one whitespace-delimited token, like operator>> for std::string
+    friend std::istream& operator>>(std::istream& is, inline_string& s) {
+        std::istream::sentry sentry {is};
+        if(!sentry)
+            return is;
+
+        s.clear();
+        std::streambuf* buf = is.rdbuf();
+
+        for(int c = buf->sgetc(); ; c = buf->snextc()) {
+            if(c == std::char_traits<char>::eof()) {
+                is.setstate(std::ios_base::eofbit);
+                break;
+            }
+
+            if(std::isspace(c))
+                break;
+
+            if(s.m_size == Capacity) {
+                s.clear();
+                is.setstate(std::ios_base::failbit);
+                return is;
+            }
+
+            s.m_data[s.m_size++] = static_cast<char>(c);
+        }
+
+        s.m_data[s.m_size] = '\0';
+        if(s.empty())
+            is.setstate(std::ios_base::failbit);
+
+        return is;
+    }
+
+private:
+    char m_data[Capacity + 1] = {};
+    std::size_t m_size = 0;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+// Forward-only JSON reader which walks a message in place without building a DOM.
+// Values are pulled on demand: callers iterate object keys / array elements and either
+// read a value into a typed field or skip it.
+// Strings are returned as views into the input and are not unescaped, which is sufficient
+// for keys, channel names and instrument names.
+// Any syntax error puts the scanner in a failed state, after which all reads return false.
+class json_scanner {
+public:
+    explicit json_scanner(std::string_view input): m_pos{input.data()}, m_end{input.data() + input.size()} {}
+
+    bool failed() const { return m_failed; }
+    const char* position() const { return m_pos; }
+
+    // objects: enter_object() then loop on next_key() until it returns false
+    bool enter_object() { return consume('{'); }
+
+    bool next_key(std::string_view& key) {
+        if(!next_member('}'))
+            return false;
+
+        return read_string(key) && consume(':');
+    }
+
+    // arrays: enter_array() then loop on next_element() until it returns false
+    bool enter_array() { return consume('['); }
+    bool next_element() { return next_member(']'); }
+
+    bool read_string(std::string_view& value) {
+        if(!consume('"'))
+            return false;
+
+        const char* start = m_pos;
+        while(m_pos < m_end && *m_pos != '"') {
+            if(*m_pos == '\\')
+                m_pos++; // escaped character is kept as-is
+            m_pos++;
+        }
+
+        if(m_pos >= m_end)
+            return fail();
+
+        value = std::string_view{start, static_cast<std::size_t>(m_pos - start)};
+        m_pos++;
+        return true;
+    }
+
+    bool read_double(double& value) { return read_number(value); }
+    bool read_int(std::int64_t& value) { return read_number(value); }
+    bool read_uint(std::uint64_t& value) { return read_number(value); }
+
+    bool read_bool(bool& value) {
+        skip_whitespace();
+        if(match("true")) { value = true; return true; }
+        if(match("false")) { value = false; return true; }
+        return fail();
+    }
+
+    // returns true and consumes the literal if the next value is null
+    bool read_null() {
+        skip_whitespace();
+        return match("null");
+    }
+
+    // first character of the next value, 0 at the end of input
+    char peek() {
+        skip_whitespace();
+        return m_pos < m_end ? *m_pos : 0;
+    }
+
+    // skip over the next value (of any type), returning its raw text
+    bool skip_value(std::string_view* raw = nullptr) {
+        skip_whitespace();
+        const char* start = m_pos;
+
+        if(m_pos >= m_end)
+            return fail();
+
+        switch(*m_pos) {
+            case '"': {
+                std::string_view ignored;
+                if(!read_string(ignored))
+                    return false;
+                break;
+            }
+            case '{':
+            case '[':
+                if(!skip_nested())
+                    return false;
+                break;
+            default:
+                // number or literal
+                while(m_pos < m_end && !is_delimiter(*m_pos))
+                    m_pos++;
+                if(m_pos == start)
+                    return fail();
+        }
+
+        if(raw)
+            *raw = std::string_view{start, static_cast<std::size_t>(m_pos - start)};
+        return true;
+    }
+
+private:
+    template<typename T>
+    bool read_number(T& value) {
+        skip_whitespace();
+        auto [ptr, ec] = std::from_chars(m_pos, m_end, value);
+        if(ec != std::errc())
+            return fail();
+
+        m_pos = ptr;
+        return true;
+    }
+
+    // handles the ',' between members and detects the closing bracket
+    bool next_member(char close) {
+        skip_whitespace();
+        if(m_failed || m_pos >= m_end)
+            return fail();
+
+        if(*m_pos == close) {
+            m_pos++;
+            m_first = false;
+            return false;
+        }
+
+        if(m_first) {
+            m_first = false;
+            return true;
+        }
+
+        return consume(',');
+    }
+
+    // skip a complete object or array, strings are skipped so brackets inside them are ignored
+    bool skip_nested() {
+        int depth = 0;
+
+        while(m_pos < m_end) {
+            char c = *m_pos;
+
+            if(c == '"') {
+                std::string_view ignored;
+                if(!read_string(ignored))
+                    return false;
+                continue;
+            }
+
+            m_pos++;
+            if(c == '{' || c == '[') {
+                depth++;
+            } else if(c == '}' || c == ']') {
+                if(--depth == 0)
+                    return true;
+            }
+        }
+
+        return fail();
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if(m_failed || m_pos >= m_end || *m_pos != c)
+            return fail();
+
+        m_pos++;
+        // the first member of an object / array is not preceded by a ','
+        m_first = (c == '{' || c == '[');
+        return true;
+    }
+
+    bool match(std::string_view literal) {
+        if(static_cast<std::size_t>(m_end - m_pos) < literal.size() || std::string_view{m_pos, literal.size()} != literal)
+            return false;
+
+        m_pos += literal.size();
+        return true;
+    }
+
+    void skip_whitespace() {
+        while(m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t'))
+            m_pos++;
+    }
+
+    static bool is_delimiter(char c) {
+        return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    bool fail() {
+        m_failed = true;
+        return false;
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+    bool m_first = false;
+    bool m_failed = false;
+};
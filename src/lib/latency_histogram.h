@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr std::size_t LATENCY_MAX_LABELS = 64;
+
+// Log-linear (HDR style) histogram of latencies in nanoseconds.
+// Values below 2^SUB_BUCKET_BITS are counted exactly, above that each power of two is split into
+// SUB_BUCKET_HALF linear buckets, so any recorded value is reported within 1 / SUB_BUCKET_HALF (0.8%).
+// Values above MAX_VALUE are counted in the last bucket.
+// record() is lock-free and may be called from any thread, readers see a (relaxed) snapshot.
+class latency_histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 8;
+    static constexpr std::uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_BITS;
+    static constexpr std::uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr int MAX_VALUE_BITS = 40; // ~18 minutes
+    static constexpr std::uint64_t MAX_VALUE = (1ull << MAX_VALUE_BITS) - 1;
+    static constexpr std::size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+
+    struct summary {
+        std::uint64_t count = 0;
+        std::uint64_t min = 0;
+        std::uint64_t max = 0;
+        double mean = 0;
+        std::uint64_t p50 = 0;
+        std::uint64_t p90 = 0;
+        std::uint64_t p99 = 0;
+        std::uint64_t p999 = 0;
+    };
+
+    void record(std::uint64_t ns) {
+        ns = std::min(ns, MAX_VALUE);
+
+        m_counts[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(ns, std::memory_order_relaxed);
+
+        std::uint64_t min = m_min.load(std::memory_order_relaxed);
+        while(ns < min && !m_min.compare_exchange_weak(min, ns, std::memory_order_relaxed));
+
+        std::uint64_t max = m_max.load(std::memory_order_relaxed);
+        while(ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+    }
+
+    void reset() {
+        for(auto& count : m_counts)
+            count.store(0, std::memory_order_relaxed);
+
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_min.store(UINT64_MAX, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+
+    summary summarize() const {
+        summary s;
+
+        // percentiles are computed from one pass over a copy of the buckets
+        std::vector<std::uint64_t> counts(BUCKET_COUNT);
+        for(std::size_t i = 0; i < BUCKET_COUNT; i++) {
+            counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            s.count += counts[i];
+        }
+
+        if(s.count == 0)
+            return s;
+
+        s.min = m_min.load(std::memory_order_relaxed);
+        s.max = m_max.load(std::memory_order_relaxed);
+        s.mean = static_cast<double>(m_sum.load(std::memory_order_relaxed)) / s.count;
+
+        const double percentiles[] = {50, 90, 99, 99.9};
+        std::uint64_t* values[] = {&s.p50, &s.p90, &s.p99, &s.p999};
+
+        std::uint64_t seen = 0;
+        std::size_t next = 0;
+
+        for(std::size_t i = 0; i < BUCKET_COUNT && next < 4; i++) {
+            seen += counts[i];
+
+            while(next < 4 && seen >= rank(percentiles[next], s.count)) {
+                // report the highest value equivalent to the bucket, bounded by the recorded extremes
+                *values[next] = std::clamp(highest_equivalent(i), s.min, s.max);
+                next++;
+            }
+        }
+
+        return s;
+    }
+
+private:
+    static std::size_t index_of(std::uint64_t ns) {
+        if(ns < SUB_BUCKET_COUNT)
+            return static_cast<std::size_t>(ns);
+
+        int msb = 63 - __builtin_clzll(ns);
+        int shift = msb - SUB_BUCKET_BITS + 1;
+        return static_cast<std::size_t>(shift * SUB_BUCKET_HALF + (ns >> shift));
+    }
+
+    static std::uint64_t highest_equivalent(std::size_t index) {
+        if(index < SUB_BUCKET_COUNT)
+            return index;
+
+        std::uint64_t shift = index / SUB_BUCKET_HALF - 1;
+        std::uint64_t sub_bucket = index - shift * SUB_BUCKET_HALF;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    // number of samples at or below the given percentile
+    static std::uint64_t rank(double percentile, std::uint64_t count) {
+        return std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(percentile / 100 * count)));
+    }
+
+private:
+    std::atomic<std::uint64_t> m_counts[BUCKET_COUNT] {};
+    std::atomic<std::uint64_t> m_count {0};
+    std::atomic<std::uint64_t> m_sum {0};
+    std::atomic<std::uint64_t> m_min {UINT64_MAX};
+    std::atomic<std::uint64_t> m_max {0};
+};
+
+// Named latency histograms, shared by every benchmark with the same label.
+// Histograms are created on first use and never removed, so a pointer returned by histogram()
+// can be kept and recorded into without any further lookup.
+class latency_registry {
+public:
+    static latency_registry& instance() {
+        static latency_registry registry;
+        return registry;
+    }
+
+    // histogram for a label, created if needed; nullptr if LATENCY_MAX_LABELS is reached
+    latency_histogram* histogram(std::string_view label) {
+        if(latency_histogram* hist = find(label))
+            return hist;
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        // may have been created by another thread since the lookup
+        if(latency_histogram* hist = find(label))
+            return hist;
+
+        std::size_t count = m_count.load(std::memory_order_relaxed);
+        if(count == LATENCY_MAX_LABELS)
+            return nullptr;
+
+        m_entries[count] = std::make_unique<entry>();
+        m_entries[count]->label.assign(label.data(), label.size());
+        m_count.store(count + 1, std::memory_order_release);
+
+        return &m_entries[count]->hist;
+    }
+
+    latency_histogram* find(std::string_view label) {
+        std::size_t count = m_count.load(std::memory_order_acquire);
+        for(std::size_t i = 0; i < count; i++)
+            if(m_entries[i]->label == label)
+                return &m_entries[i]->hist;
+
+        return nullptr;
+    }
+
+    void reset() {
+        std::size_t count = m_count.load(std::memory_order_acquire);
+        for(std::size_t i = 0; i < count; i++)
+            m_entries[i]->hist.reset();
+    }
+
+    // table of every label with samples, or of a single label if given
+    void print(std::ostream& os, std::string_view label = {}) const {
+        static constexpr int label_width = 32;
+        static constexpr int value_width = 11;
+
+        std::ios_base::fmtflags original_flags = os.flags();
+
+        os << std::left << std::setw(label_width) << "label" << std::right;
+        for(const char* column : {"count", "min", "mean", "p50", "p90", "p99", "p99.9", "max"})
+            os << std::setw(value_width) << column;
+        os << "   (ns)\n";
+
+        for_each(label, [&](const std::string& name, const latency_histogram::summary& s) {
+            os << std::left << std::setw(label_width) << name << std::right
+                << std::setw(value_width) << s.count
+                << std::setw(value_width) << s.min
+                << std::setw(value_width) << static_cast<std::uint64_t>(s.mean)
+                << std::setw(value_width) << s.p50
+                << std::setw(value_width) << s.p90
+                << std::setw(value_width) << s.p99
+                << std::setw(value_width) << s.p999
+                << std::setw(value_width) << s.max << "\n";
+        });
+
+        os.flags(original_flags);
+    }
+
+    // one row per label, values in nanoseconds
+    void write_csv(std::ostream& os) const {
+        os << "label,count,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,p99.9_ns,max_ns\n";
+
+        for_each({}, [&](const std::string& name, const latency_histogram::summary& s) {
+            os << name << "," << s.count << "," << s.min << "," << std::fixed << std::setprecision(1) << s.mean << ","
+                << s.p50 << "," << s.p90 << "," << s.p99 << "," << s.p999 << "," << s.max << "\n";
+        });
+    }
+
+private:
+    struct entry {
+        std::string label;
+        latency_histogram hist;
+    };
+
+    template<typename F>
+    void for_each(std::string_view label, F&& fn) const {
+        std::size_t count = m_count.load(std::memory_order_acquire);
+        for(std::size_t i = 0; i < count; i++) {
+            const entry& e = *m_entries[i];
+            if(!label.empty() && e.label != label)
+                continue;
+
+            latency_histogram::summary s = e.hist.summarize();
+            if(s.count != 0)
+                fn(e.label, s);
+        }
+    }
+
+private:
+    std::unique_ptr<entry> m_entries[LATENCY_MAX_LABELS];
+    std::atomic<std::size_t> m_count {0};
+    std::mutex m_mutex; // serializes creation
+};
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <lib/tsc_clock.h>
+
+extern tsc_clock::time_point g_timer_start;
+
+// log categeries
+enum class log_flags {
+    none          = 0,
+    ws            = 1,
+    client_trader = 2,
+    trade_handler = 4,
+    benchmark     = 8,
+    mock_server   = 16
+};
+
+inline constexpr log_flags operator|(log_flags a, log_flags b) {
+    return static_cast<log_flags>(static_cast<int>(a) | static_cast<int>(b));
+}
+
+inline constexpr log_flags operator&(log_flags a, log_flags b) {
+    return static_cast<log_flags>(static_cast<int>(a) & static_cast<int>(b));
+}
+
+constexpr std::size_t LOG_RECORD_SIZE = 256;      // bytes per record, including the header
+constexpr std::size_t LOG_QUEUE_CAPACITY = 4096;  // records per thread
+constexpr auto LOG_FLUSH_INTERVAL = std::chrono::milliseconds(1);
+
+// A string literal, which lives for the whole program: "Connected to "_lit
+struct log_literal {
+    const char* text;
+};
+
+constexpr log_literal operator""_lit(const char* text, std::size_t) { return {text}; }
+
+// A log statement captured as raw arguments, formatted later by the logger thread.
+// Arguments are stored as a type tag followed by the value; literals marked with _lit are
+// stored as pointers, other strings (char arrays included) are copied inline and truncated
+// to the space left in the record.
+struct log_record {
+    enum arg_type : std::uint8_t {
+        literal, string, int64, uint64, float64, boolean, character, truncated
+    };
+
+    tsc_clock::time_point timestamp;
+    log_flags flag;
+    std::uint16_t size; // bytes of args in use
+    char args[LOG_RECORD_SIZE - sizeof(timestamp) - sizeof(flag) - sizeof(size)];
+};
+
+// Single-producer single-consumer ring of log records owned by one logging thread.
+class log_queue {
+public:
+    // slot to write the next record into, nullptr if the queue is full
+    log_record* reserve() {
+        std::uint64_t head = m_head.load(std::memory_order_relaxed);
+        if(head - m_tail.load(std::memory_order_acquire) == LOG_QUEUE_CAPACITY) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &m_records[head % LOG_QUEUE_CAPACITY];
+    }
+
+    void commit() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // consumer side
+    const log_record* front() const {
+        std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail == m_head.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &m_records[tail % LOG_QUEUE_CAPACITY];
+    }
+
+    void pop() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    std::uint64_t dropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+private:
+    alignas(64) std::atomic<std::uint64_t> m_head {0};
+    alignas(64) std::atomic<std::uint64_t> m_tail {0};
+    alignas(64) std::atomic<std::uint64_t> m_dropped {0};
+    log_record m_records[LOG_QUEUE_CAPACITY];
+};
+
+// Background thread which drains the per-thread queues, formats the records and writes them to std::clog.
+class async_logger {
+public:
+    static async_logger& instance() {
+        static async_logger logger;
+        return logger;
+    }
+
+    // queue of the calling thread, created and registered on first use
+    log_queue& thread_queue() {
+        thread_local std::shared_ptr<log_queue> queue = register_queue();
+        return *queue;
+    }
+
+    // block until every record logged so far has been written
+    void flush() {
+        std::unique_lock<std::mutex> lock {m_mutex};
+        std::uint64_t target = ++m_flush_requested;
+        m_wakeup.notify_one();
+        m_flushed.wait(lock, [&] { return m_flush_completed >= target || m_stop; });
+    }
+
+    ~async_logger() {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_stop = true;
+        }
+
+        m_wakeup.notify_one();
+        m_thread.join();
+    }
+
+private:
+    async_logger(): m_thread{&async_logger::run, this} {}
+
+    std::shared_ptr<log_queue> register_queue() {
+        auto queue = std::make_shared<log_queue>();
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+        m_queues.push_back(queue);
+        return queue;
+    }
+
+    void run() {
+        std::string out;
+        std::vector<std::shared_ptr<log_queue>> queues;
+
+        while(true) {
+            bool stop;
+            std::uint64_t flush_requested;
+
+            {
+                std::unique_lock<std::mutex> lock {m_mutex};
+                m_wakeup.wait_for(lock, LOG_FLUSH_INTERVAL, [&] { return m_stop || m_flush_requested > m_flush_completed; });
+
+                stop = m_stop;
+                flush_requested = m_flush_requested;
+                queues = m_queues;
+            }
+
+            for(auto& queue : queues) {
+                while(const log_record* record = queue->front()) {
+                    format(*record, out);
+                    queue->pop();
+                }
+
+                if(std::uint64_t dropped = queue->dropped())
+                    out += "[logger] dropped " + std::to_string(dropped) + " records, queue full\n";
+            }
+
+            if(!out.empty()) {
+                std::clog.write(out.data(), out.size());
+                std::clog.flush();
+                out.clear();
+            }
+
+            queues.clear();
+
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                m_flush_completed = flush_requested;
+
+                // queues of threads which have exited are released once drained
+                m_queues.erase(std::remove_if(m_queues.begin(), m_queues.end(),
+                    [](const std::shared_ptr<log_queue>& q) { return q.use_count() == 1 && !q->front(); }), m_queues.end());
+            }
+            m_flushed.notify_all();
+
+            if(stop)
+                return;
+        }
+    }
+
+    // Format
+    // [<time>] <log type>: <msg>
+    static void format(const log_record& record, std::string& out) {
+        std::ostringstream line;
+
+        line << "[" << std::right << std::setw(10)
+            << std::chrono::duration_cast<std::chrono::milliseconds>(record.timestamp - g_timer_start).count()
+            << "ms] ";
+
+        if(record.flag == log_flags::ws) line << "websocket: ";
+        else if(record.flag == log_flags::client_trader) line << "client: ";
+        else if(record.flag == log_flags::trade_handler) line << "trade_handler: ";
+        else if(record.flag == log_flags::mock_server) line << "mock: ";
+
+        const char* pos = record.args;
+        const char* end = record.args + record.size;
+
+        while(pos < end) {
+            auto type = static_cast<log_record::arg_type>(*pos++);
+
+            switch(type) {
+                case log_record::literal: { const char* s; pos = read(pos, s); line << s; break; }
+                case log_record::int64: { std::int64_t v; pos = read(pos, v); line << v; break; }
+                case log_record::uint64: { std::uint64_t v; pos = read(pos, v); line << v; break; }
+                case log_record::float64: { double v; pos = read(pos, v); line << v; break; }
+                case log_record::boolean: { bool v; pos = read(pos, v); line << v; break; }
+                case log_record::character: { char v; pos = read(pos, v); line << v; break; }
+                case log_record::string: {
+                    std::uint16_t length;
+                    pos = read(pos, length);
+                    line.write(pos, length);
+                    pos += length;
+                    break;
+                }
+                case log_record::truncated:
+                    line << "...";
+                    pos = end;
+                    break;
+            }
+        }
+
+        line << '\n';
+        out += line.str();
+    }
+
+    template<typename T>
+    static const char* read(const char* pos, T& value) {
+        std::memcpy(&value, pos, sizeof(T));
+        return pos + sizeof(T);
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_flushed;
+    std::vector<std::shared_ptr<log_queue>> m_queues;
+    std::uint64_t m_flush_requested = 0;
+    std::uint64_t m_flush_completed = 0;
+    bool m_stop = false;
+
+    std::thread m_thread;
+};
+
+// Builds a record in place in the calling thread's queue, the record is published on destruction.
+// If the queue is full the statement is dropped (and counted) instead of blocking the caller.
+class log_record_builder {
+public:
+    explicit log_record_builder(log_flags flag)
+        : m_queue{async_logger::instance().thread_queue()}
+        , m_record{m_queue.reserve()} {
+        if(!m_record)
+            return;
+
+        m_record->timestamp = tsc_clock::now();
+        m_record->flag = flag;
+        m_record->size = 0;
+    }
+
+    ~log_record_builder() {
+        if(m_record)
+            m_queue.commit();
+    }
+
+    log_record_builder(const log_record_builder&) = delete;
+    log_record_builder& operator=(const log_record_builder&) = delete;
+
+    // only a _lit literal is stored by address, a char array may be a buffer reused before the logger thread formats it
+    log_record_builder& operator<<(log_literal s) { return put(log_record::literal, s.text); }
+
+    template<std::size_t N>
+    log_record_builder& operator<<(const char (&s)[N]) { return put_string({s, strnlen(s, N)}); }
+
+    template<typename T, typename std::enable_if_t<std::is_same_v<T, const char*> || std::is_same_v<T, char*>, int> = 0>
+    log_record_builder& operator<<(T s) { return put_string(s ? std::string_view{s} : std::string_view{"(null)"}); }
+
+    log_record_builder& operator<<(const std::string& s) { return put_string(s); }
+    log_record_builder& operator<<(std::string_view s) { return put_string(s); }
+    log_record_builder& operator<<(bool v) { return put(log_record::boolean, v); }
+    log_record_builder& operator<<(char v) { return put(log_record::character, v); }
+
+    template<typename T, typename std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>, int> = 0>
+    log_record_builder& operator<<(T v) { return put(log_record::int64, static_cast<std::int64_t>(v)); }
+
+    template<typename T, typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>, int> = 0>
+    log_record_builder& operator<<(T v) { return put(log_record::uint64, static_cast<std::uint64_t>(v)); }
+
+    template<typename T, typename std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    log_record_builder& operator<<(T v) { return put(log_record::float64, static_cast<double>(v)); }
+
+    // any other streamable type is formatted on the calling thread
+    template<typename T, typename std::enable_if_t<!std::is_arithmetic_v<T> && !std::is_convertible_v<const T&, std::string_view>, int> = 0>
+    log_record_builder& operator<<(const T& v) {
+        std::ostringstream s;
+        s << v;
+        return put_string(s.str());
+    }
+
+private:
+    template<typename T>
+    log_record_builder& put(log_record::arg_type type, T value) {
+        if(!reserve(1 + sizeof(T)))
+            return *this;
+
+        char* pos = m_record->args + m_record->size;
+        *pos = static_cast<char>(type);
+        std::memcpy(pos + 1, &value, sizeof(T));
+        m_record->size += 1 + sizeof(T);
+
+        return *this;
+    }
+
+    log_record_builder& put_string(std::string_view s) {
+        static constexpr std::size_t header = 1 + sizeof(std::uint16_t);
+
+        if(!reserve(header + 1))
+            return *this;
+
+        std::uint16_t length = static_cast<std::uint16_t>(std::min(s.size(), space() - header));
+
+        char* pos = m_record->args + m_record->size;
+        *pos = static_cast<char>(log_record::string);
+        std::memcpy(pos + 1, &length, sizeof(length));
+        std::memcpy(pos + header, s.data(), length);
+        m_record->size += header + length;
+
+        if(length < s.size())
+            truncate();
+
+        return *this;
+    }
+
+    // the last byte of the args is kept free for the truncation marker
+    std::size_t space() const { return sizeof(m_record->args) - 1 - m_record->size; }
+
+    void truncate() {
+        m_record->args[m_record->size++] = static_cast<char>(log_record::truncated);
+        m_truncated = true;
+    }
+
+    // returns false if the argument does not fit, marking the record as truncated
+    bool reserve(std::size_t bytes) {
+        if(!m_record || m_truncated)
+            return false;
+
+        if(space() >= bytes)
+            return true;
+
+        truncate();
+        return false;
+    }
+
+private:
+    log_queue& m_queue;
+    log_record* m_record;
+    bool m_truncated = false;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+
+// hint to the cpu that we are in a spin-wait loop
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Minimal test-and-test-and-set lock for short critical sections shared with the network thread.
+// Satisfies BasicLockable, so it can be used with std::lock_guard.
+class spin_lock {
+public:
+    void lock() {
+        while(true) {
+            if(!m_locked.exchange(true, std::memory_order_acquire))
+                return;
+
+            while(m_locked.load(std::memory_order_relaxed))
+                cpu_relax();
+        }
+    }
+
+    bool try_lock() { return !m_locked.exchange(true, std::memory_order_acquire); }
+    void unlock() { m_locked.store(false, std::memory_order_release); }
+private:
+    std::atomic<bool> m_locked {false};
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+typedef std::uint32_t symbol_id;
+constexpr symbol_id NO_SYMBOL = ~symbol_id{0};
+
+// Interns names (eg. instrument names) to dense ids 0, 1, 2..., so that per-name state can live in flat
+// arrays indexed by id instead of maps keyed by strings.
+// Names are only added, never removed. Adding takes a mutex, looking up an id or a name is lock-free and
+// can run on any thread, concurrently with additions: a name and its slot in the open addressing index
+// are published with release stores.
+class symbol_table {
+public:
+    static constexpr std::size_t capacity = 16384;
+
+    symbol_table()
+        : m_names(std::make_unique<std::unique_ptr<const std::string>[]>(capacity))
+        , m_index(std::make_unique<std::atomic<symbol_id>[]>(index_size)) {}
+
+    symbol_table(const symbol_table&) = delete;
+    symbol_table& operator=(const symbol_table&) = delete;
+
+    // the id of the name, added if it is new; NO_SYMBOL for an empty name or once the table is full
+    symbol_id intern(std::string_view name) {
+        symbol_id id = find(name);
+        if(id != NO_SYMBOL || name.empty())
+            return id;
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        // another thread may have added it since
+        std::size_t slot = hash(name) & (index_size - 1);
+        for(symbol_id existing; (existing = m_index[slot].load(std::memory_order_acquire)) != 0; slot = (slot + 1) & (index_size - 1)) {
+            if(*m_names[existing - 1] == name)
+                return existing - 1;
+        }
+
+        std::size_t count = m_count.load(std::memory_order_relaxed);
+        if(count == capacity)
+            return NO_SYMBOL;
+
+        m_names[count] = std::make_unique<const std::string>(name);
+        m_count.store(count + 1, std::memory_order_release);
+        m_index[slot].store(static_cast<symbol_id>(count + 1), std::memory_order_release);
+
+        return static_cast<symbol_id>(count);
+    }
+
+    // NO_SYMBOL if the name was never added
+    symbol_id find(std::string_view name) const {
+        std::size_t slot = hash(name) & (index_size - 1);
+
+        for(symbol_id existing; (existing = m_index[slot].load(std::memory_order_acquire)) != 0; slot = (slot + 1) & (index_size - 1)) {
+            if(*m_names[existing - 1] == name)
+                return existing - 1;
+        }
+
+        return NO_SYMBOL;
+    }
+
+    // empty for an id which was not handed out
+    std::string_view name(symbol_id id) const {
+        return id < m_count.load(std::memory_order_acquire) ? std::string_view{*m_names[id]} : std::string_view{};
+    }
+
+    std::size_t size() const { return m_count.load(std::memory_order_acquire); }
+
+private:
+    // twice the capacity keeps the probe sequences short
+    static constexpr std::size_t index_size = 2 * capacity;
+
+    // FNV-1a
+    static std::size_t hash(std::string_view name) {
+        std::uint32_t hash = 2166136261u;
+        for(char c : name)
+            hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619u;
+        return hash;
+    }
+
+    std::mutex m_mutex;
+    std::atomic<std::size_t> m_count {0};
+    std::unique_ptr<std::unique_ptr<const std::string>[]> m_names; // indexed by id
+    std::unique_ptr<std::atomic<symbol_id>[]> m_index; // id + 1 of the name hashed to the slot, 0 for an empty slot
+};
+
+// The instruments of every exchange adapter, so that an instrument id means the same instrument in the
+// instrument cache, the order books and the order state.
+// Instruments are interned when their rules are loaded or on their first notification.
+inline symbol_table& instrument_symbols() {
+    static symbol_table symbols;
+    return symbols;
+}
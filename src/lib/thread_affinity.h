@@ -0,0 +1,60 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <string>
+#include <vector>
+
+constexpr int NO_CPU = -1; // thread not pinned
+
+// pin the calling thread to one cpu, returns false if the cpu does not exist or is not allowed
+inline bool pin_current_thread(int cpu) {
+    if(cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// thread name shown by top -H and gdb, truncated to 15 characters
+inline void set_current_thread_name(const std::string& name) {
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+// comma separated cpu list, eg. "2,3" or "-1,4" (-1 for a thread which is not pinned)
+inline bool parse_cpu_list(const std::string& list, std::vector<int>& cpus) {
+    cpus.clear();
+
+    std::size_t start = 0;
+    while(start <= list.size()) {
+        std::size_t end = list.find(',', start);
+        if(end == std::string::npos)
+            end = list.size();
+
+        try {
+            std::size_t used = 0;
+            int cpu = std::stoi(list.substr(start, end - start), &used);
+            if(used != end - start || cpu < NO_CPU)
+                return false;
+            cpus.push_back(cpu);
+        } catch(...) {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return !cpus.empty();
+}
+
+// run the calling thread under SCHED_FIFO with the given priority (1-99), needs CAP_SYS_NICE
+inline bool set_current_thread_realtime(int priority) {
+    sched_param param {};
+    param.sched_priority = priority;
+
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Text tokens of an enum with the values 0..N-1, value 0 being unset (the empty token).
+// An enum is turned into its token with an array lookup. A token is parsed through a perfect hash
+// found at compile time, so parsing is one hash, one table slot and one comparison.
+// A table for which no perfect hash is found does not compile.
+template<typename Enum, std::size_t N>
+class token_table {
+public:
+    static constexpr std::size_t slot_count = 64; // power of two, sparse enough for a seed to be found quickly
+    static_assert(N <= slot_count / 2, "too many tokens for the table");
+
+    constexpr explicit token_table(const std::array<std::string_view, N>& tokens): m_tokens(tokens) {
+        while(!place_tokens()) {
+            if(++m_seed == max_seed)
+                throw "no perfect hash for the tokens";
+        }
+    }
+
+    constexpr std::string_view token(Enum value) const { return m_tokens[static_cast<std::size_t>(value)]; }
+
+    // the empty string parses as unset, false if the text is not one of the tokens
+    constexpr bool parse(std::string_view text, Enum& value) const {
+        if(text.empty()) {
+            value = Enum{};
+            return true;
+        }
+
+        std::uint8_t index = m_slots[slot(text)];
+        if(index == empty_slot || m_tokens[index] != text)
+            return false;
+
+        value = static_cast<Enum>(index);
+        return true;
+    }
+
+private:
+    static constexpr std::uint32_t max_seed = 1 << 16;
+    static constexpr std::uint8_t empty_slot = 0xff;
+
+    // FNV-1a from a seed instead of the offset basis
+    constexpr std::size_t slot(std::string_view text) const {
+        std::uint32_t hash = m_seed;
+        for(char c : text)
+            hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619u;
+        return (hash ^ (hash >> 16)) & (slot_count - 1);
+    }
+
+    constexpr bool place_tokens() {
+        for(std::uint8_t& index : m_slots)
+            index = empty_slot;
+
+        for(std::size_t i = 1; i < N; i++) {
+            std::uint8_t& index = m_slots[slot(m_tokens[i])];
+            if(index != empty_slot)
+                return false;
+            index = static_cast<std::uint8_t>(i);
+        }
+
+        return true;
+    }
+
+    std::array<std::string_view, N> m_tokens;
+    std::array<std::uint8_t, slot_count> m_slots {};
+    std::uint32_t m_seed = 1;
+};
+
+// specialised for each enum with tokens: static constexpr token_table<Enum, N> table {...};
+template<typename Enum>
+struct enum_tokens;
+
+template<typename Enum>
+constexpr std::string_view to_token(Enum value) { return enum_tokens<Enum>::table.token(value); }
+
+template<typename Enum>
+constexpr bool parse_token(std::string_view text, Enum& value) { return enum_tokens<Enum>::table.parse(text, value); }
+
+template<typename Enum, typename = decltype(enum_tokens<Enum>::table)>
+std::ostream& operator<<(std::ostream& os, Enum value) {
+    return os << to_token(value);
+}
+
+// reads one whitespace-delimited token, an unknown token sets failbit and leaves the value as it was
+template<typename Enum, typename = decltype(enum_tokens<Enum>::table)>
+std::istream& operator>>(std::istream& is, Enum& value) {
+    std::string text;
+    if(is >> text && !parse_token(text, value))
+        is.setstate(std::ios_base::failbit);
+    return is;
+}
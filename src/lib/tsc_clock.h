@@ -0,0 +1,158 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TSC_CLOCK_X86 1
+#endif
+
+constexpr auto TSC_CALIBRATION_INTERVAL = std::chrono::milliseconds(20);
+
+// Clock reading the CPU timestamp counter, converted to nanoseconds with a calibrated multiplier.
+// The TSC is only used if the CPU reports an invariant TSC (constant rate, not stopped in deep
+// C-states, synchronized across cores); otherwise, and until calibrate() is called, now() falls
+// back to std::chrono::steady_clock.
+// Time points share steady_clock's epoch, so they can be compared with steady_clock readings.
+class tsc_clock {
+public:
+    typedef std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<tsc_clock> time_point;
+    static constexpr bool is_steady = true;
+
+    struct calibration_report {
+        bool tsc;               // false if steady_clock is used
+        double ghz;             // calibrated TSC frequency
+        double drift_ppm;       // tsc_clock rate error relative to steady_clock
+        std::int64_t offset_ns; // tsc_clock - steady_clock at the end of the test
+    };
+
+    static time_point now() {
+#ifdef TSC_CLOCK_X86
+        if(s_use_tsc)
+            return to_time_point(__rdtsc());
+#endif
+        return steady_now();
+    }
+
+    // like now(), but not reordered before earlier instructions (rdtscp), for the end of a timed region
+    static time_point now_ordered() {
+#ifdef TSC_CLOCK_X86
+        if(s_use_tsc) {
+            unsigned int aux;
+            return to_time_point(__rdtscp(&aux));
+        }
+#endif
+        return steady_now();
+    }
+
+    static bool uses_tsc() { return s_use_tsc; }
+    static double ghz() { return s_ghz; }
+
+    // Detect an invariant TSC and measure its frequency against steady_clock, blocking for the interval.
+    // Must be called once at startup, before any other thread reads the clock.
+    static void calibrate(std::chrono::milliseconds interval = TSC_CALIBRATION_INTERVAL) {
+        s_use_tsc = false;
+
+#ifdef TSC_CLOCK_X86
+        if(!invariant_tsc())
+            return;
+
+        std::uint64_t tsc_start = 0, tsc_end = 0;
+        std::int64_t ns_start = 0, ns_end = 0;
+
+        sample(tsc_start, ns_start);
+        std::this_thread::sleep_for(interval);
+        sample(tsc_end, ns_end);
+
+        if(tsc_end <= tsc_start || ns_end <= ns_start)
+            return;
+
+        double hz = (tsc_end - tsc_start) * 1e9 / (ns_end - ns_start);
+        s_ghz = hz / 1e9;
+        s_mult = static_cast<std::uint64_t>((1e9 * (1ull << MULT_SHIFT)) / hz);
+        s_base_tsc = tsc_end;
+        s_base_ns = ns_end;
+        s_use_tsc = true;
+#endif
+    }
+
+    // Measure the calibrated clock against steady_clock over an interval (blocking)
+    static calibration_report self_test(std::chrono::milliseconds interval = std::chrono::milliseconds(200)) {
+        calibration_report report {s_use_tsc, s_ghz, 0, 0};
+
+#ifdef TSC_CLOCK_X86
+        if(!s_use_tsc)
+            return report;
+
+        std::uint64_t tsc_start = 0, tsc_end = 0;
+        std::int64_t ns_start = 0, ns_end = 0;
+
+        sample(tsc_start, ns_start);
+        std::this_thread::sleep_for(interval);
+        sample(tsc_end, ns_end);
+
+        std::int64_t tsc_elapsed = (to_time_point(tsc_end) - to_time_point(tsc_start)).count();
+        std::int64_t steady_elapsed = ns_end - ns_start;
+
+        report.drift_ppm = (tsc_elapsed - steady_elapsed) * 1e6 / steady_elapsed;
+        report.offset_ns = to_time_point(tsc_end).time_since_epoch().count() - ns_end;
+#endif
+
+        return report;
+    }
+
+private:
+    static time_point steady_now() {
+        return time_point{std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch())};
+    }
+
+    static time_point to_time_point(std::uint64_t tsc) {
+        // signed, a counter read just before calibration finished may be behind the base
+        __int128 delta = static_cast<__int128>(static_cast<std::int64_t>(tsc - s_base_tsc)) * s_mult;
+        return time_point{duration{s_base_ns + static_cast<std::int64_t>(delta >> MULT_SHIFT)}};
+    }
+
+#ifdef TSC_CLOCK_X86
+    // CPUID.80000007H:EDX[8]
+    static bool invariant_tsc() {
+        unsigned int eax, ebx, ecx, edx;
+        if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+            return false;
+
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return (edx & (1u << 8)) != 0;
+    }
+
+    // pair of readings taken as close together as possible, the TSC is the midpoint around the steady_clock read
+    static void sample(std::uint64_t& tsc, std::int64_t& ns) {
+        std::uint64_t best = UINT64_MAX;
+
+        for(int i = 0; i < 8; i++) {
+            std::uint64_t before = __rdtsc();
+            std::int64_t steady = steady_now().time_since_epoch().count();
+            std::uint64_t after = __rdtsc();
+
+            if(after - before < best) {
+                best = after - before;
+                tsc = before + (after - before) / 2;
+                ns = steady;
+            }
+        }
+    }
+#endif
+
+private:
+    static constexpr int MULT_SHIFT = 32;
+
+    inline static bool s_use_tsc = false;
+    inline static double s_ghz = 0;
+    inline static std::uint64_t s_mult = 0;       // nanoseconds per tick, fixed point with MULT_SHIFT fraction bits
+    inline static std::uint64_t s_base_tsc = 0;
+    inline static std::int64_t s_base_ns = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <lib/symbol_table.h>
+
+// A change to, or a snapshot of, an L2 book as parsed from an exchange feed (see deribit_message_parser).
+// String views point into the received payload and are only valid while the update is applied.
+
+enum class book_action : std::uint8_t {
+    new_level,
+    change,
+    remove
+};
+
+struct book_level {
+    book_action action;
+    double price;
+    double amount;
+};
+
+// book.{instrument}.{interval} and book.{instrument}.{group}.{depth}.{interval}
+struct book_update {
+    std::string_view channel;
+    std::string_view instrument;
+    symbol_id instrument_id = NO_SYMBOL; // see instrument_symbols
+    bool snapshot = false; // grouped books are always sent as snapshots
+    std::int64_t timestamp = 0;
+    std::int64_t change_id = 0;
+    std::int64_t prev_change_id = 0; // 0 if not present
+    std::vector<book_level> bids;
+    std::vector<book_level> asks;
+};
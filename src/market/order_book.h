@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lib/spin_lock.h>
+#include <lib/symbol_table.h>
+#include <lib/utilities.h>
+#include <market/book_update.h>
+
+constexpr std::size_t ORDER_BOOK_RESERVED_LEVELS = 1024;
+
+struct price_level {
+    double price;
+    double amount;
+};
+
+enum class book_side : std::uint8_t {
+    bid,
+    ask
+};
+
+// L2 order book stored as two flat price-sorted arrays.
+// The best level of each side is kept at the back of its array, so updates near the top of the
+// book (the common case) move few elements, and best bid / ask is a single load.
+// Not thread-safe, see order_book_manager.
+class order_book {
+public:
+    order_book() {
+        m_bids.reserve(ORDER_BOOK_RESERVED_LEVELS);
+        m_asks.reserve(ORDER_BOOK_RESERVED_LEVELS);
+    }
+
+    void clear() {
+        m_bids.clear();
+        m_asks.clear();
+    }
+
+    // set the amount at a price level, an amount of 0 removes the level
+    void set_level(book_side side, double price, double amount) {
+        std::vector<price_level>& levels = (side == book_side::bid) ? m_bids : m_asks;
+        auto it = find(side, price);
+
+        if(it != levels.end() && it->price == price) {
+            if(amount == 0)
+                levels.erase(it);
+            else
+                it->amount = amount;
+        } else if(amount != 0) {
+            levels.insert(it, price_level{price, amount});
+        }
+    }
+
+    void apply(book_side side, const book_level& level) {
+        set_level(side, level.price, level.action == book_action::remove ? 0 : level.amount);
+    }
+
+    bool best_bid(price_level& level) const { return best(m_bids, level); }
+    bool best_ask(price_level& level) const { return best(m_asks, level); }
+
+    // copy up to n levels of a side, best first, returns the number of levels copied
+    std::size_t depth(book_side side, price_level* out, std::size_t n) const {
+        const std::vector<price_level>& levels = (side == book_side::bid) ? m_bids : m_asks;
+        n = std::min(n, levels.size());
+        std::reverse_copy(levels.end() - n, levels.end(), out);
+        return n;
+    }
+
+    std::size_t size(book_side side) const { return (side == book_side::bid) ? m_bids.size() : m_asks.size(); }
+private:
+    // position of price in a side, or the position where it should be inserted
+    std::vector<price_level>::iterator find(book_side side, double price) {
+        // bids ascending and asks descending, so that the best price is last
+        if(side == book_side::bid)
+            return std::lower_bound(m_bids.begin(), m_bids.end(), price,
+                [](const price_level& level, double p) { return level.price < p; });
+
+        return std::lower_bound(m_asks.begin(), m_asks.end(), price,
+            [](const price_level& level, double p) { return level.price > p; });
+    }
+
+    static bool best(const std::vector<price_level>& levels, price_level& level) {
+        if(levels.empty())
+            return false;
+
+        level = levels.back();
+        return true;
+    }
+
+private:
+    std::vector<price_level> m_bids;
+    std::vector<price_level> m_asks;
+};
+
+// Order books for every instrument with a book.* subscription, in a flat table indexed by instrument id
+// (see instrument_symbols).
+// Updates are applied on the network thread, queries may come from any thread; each book is
+// guarded by a spin lock held only for the duration of an update or a copy.
+// Changes are checked for change_id / prev_change_id continuity, on a gap the book is marked
+// stale and the resnapshot handler is asked to fetch a fresh snapshot for the channel.
+// A book follows one channel, that of its last snapshot: changes from another book channel of the same
+// instrument (another interval or grouping) are ignored rather than seen as gaps.
+class order_book_manager {
+public:
+    // called on the network thread with the channel of a book which lost continuity
+    typedef std::function<void(std::string_view channel)> resnapshot_handler;
+
+    order_book_manager(): m_books(std::make_unique<std::atomic<book_entry*>[]>(symbol_table::capacity)) {}
+
+    order_book_manager(const order_book_manager&) = delete;
+    order_book_manager& operator=(const order_book_manager&) = delete;
+
+    void set_resnapshot_handler(resnapshot_handler handler) { m_resnapshot = std::move(handler); }
+
+    void apply(const book_update& update) {
+        book_entry* entry = find_or_create(update.instrument_id);
+        bool gap = false;
+        std::int64_t expected = 0; // read under the lock, the book may be resnapshotted once it is released
+
+        {
+            std::lock_guard<spin_lock> lock {entry->lock};
+
+            if(update.snapshot) {
+                entry->book.clear();
+                entry->channel.assign(update.channel.data(), update.channel.size());
+            } else if(update.channel != entry->channel) {
+                return; // the book follows the channel of its last snapshot
+            } else if(!entry->valid) {
+                return; // waiting for a snapshot
+            } else if(update.prev_change_id != entry->change_id) {
+                entry->valid = false;
+                expected = entry->change_id;
+                gap = true;
+            }
+
+            if(!gap) {
+                for(const book_level& level : update.bids)
+                    entry->book.apply(book_side::bid, level);
+                for(const book_level& level : update.asks)
+                    entry->book.apply(book_side::ask, level);
+
+                entry->change_id = update.change_id;
+                entry->timestamp = update.timestamp;
+                entry->valid = true;
+            }
+        }
+
+        if(gap) {
+            APP_LOG(log_flags::trade_handler, "(order book) change_id gap on " << update.channel
+                << ", expected " << expected << " got " << update.prev_change_id << ", resnapshotting");
+
+            if(m_resnapshot)
+                m_resnapshot(update.channel);
+        }
+    }
+
+    // returns false if the instrument has no valid book
+    bool top_of_book(symbol_id instrument, price_level& bid, price_level& ask) const {
+        const book_entry* entry = find(instrument);
+        if(!entry)
+            return false;
+
+        std::lock_guard<spin_lock> lock {entry->lock};
+        if(!entry->valid)
+            return false;
+
+        bid = ask = price_level{0, 0};
+        entry->book.best_bid(bid);
+        entry->book.best_ask(ask);
+        return true;
+    }
+
+    bool top_of_book(std::string_view instrument, price_level& bid, price_level& ask) const {
+        return top_of_book(instrument_symbols().find(instrument), bid, ask);
+    }
+
+    // copy up to n levels per side, best first, returns false if the instrument has no valid book
+    bool depth(symbol_id instrument, std::size_t n, std::vector<price_level>& bids, std::vector<price_level>& asks) const {
+        const book_entry* entry = find(instrument);
+        if(!entry)
+            return false;
+
+        // size the output before taking the lock
+        bids.resize(n);
+        asks.resize(n);
+
+        std::lock_guard<spin_lock> lock {entry->lock};
+        if(!entry->valid)
+            return false;
+
+        bids.resize(entry->book.depth(book_side::bid, bids.data(), n));
+        asks.resize(entry->book.depth(book_side::ask, asks.data(), n));
+        return true;
+    }
+
+    bool depth(std::string_view instrument, std::size_t n, std::vector<price_level>& bids, std::vector<price_level>& asks) const {
+        return depth(instrument_symbols().find(instrument), n, bids, asks);
+    }
+
+private:
+    struct book_entry {
+        std::string channel;
+        order_book book;
+        std::int64_t change_id = 0;
+        std::int64_t timestamp = 0;
+        bool valid = false;
+        mutable spin_lock lock;
+    };
+
+    const book_entry* find(symbol_id instrument) const {
+        if(instrument >= symbol_table::capacity)
+            return nullptr;
+        return m_books[instrument].load(std::memory_order_acquire);
+    }
+
+    // books are only created on the network thread and published with a release store
+    book_entry* find_or_create(symbol_id instrument) {
+        if(instrument >= symbol_table::capacity)
+            return &m_overflow; // the instrument table is full
+
+        if(book_entry* entry = m_books[instrument].load(std::memory_order_relaxed))
+            return entry;
+
+        m_owned.push_back(std::make_unique<book_entry>());
+        m_books[instrument].store(m_owned.back().get(), std::memory_order_release);
+
+        return m_owned.back().get();
+    }
+
+private:
+    std::unique_ptr<std::atomic<book_entry*>[]> m_books; // indexed by instrument id, nullptr without a book
+    std::vector<std::unique_ptr<book_entry>> m_owned;     // only used on the network thread
+    book_entry m_overflow; // sink for books of instruments without an id, never valid for queries
+
+    resnapshot_handler m_resnapshot;
+};
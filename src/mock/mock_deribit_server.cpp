@@ -0,0 +1,449 @@
+#include <mock/mock_deribit_server.h>
+#include <lib/utilities.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+// milliseconds since the unix epoch, as used in deribit timestamps
+static std::int64_t unix_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// book.{instrument}.{interval} or book.{instrument}.{group}.{depth}.{interval}
+static std::string channel_instrument(const std::string& channel) {
+    std::size_t start = channel.find('.') + 1;
+    return channel.substr(start, channel.find('.', start) - start);
+}
+
+mock_deribit_server::mock_deribit_server(options opts)
+    : m_options(std::move(opts))
+    , m_ticks(MOCK_TICK_HISTORY)
+    , m_tick_to_order(latency_registry::instance().histogram("mock_tick_to_order_wire")) {
+    m_server.clear_access_channels(websocketpp::log::alevel::all);
+    m_server.clear_error_channels(websocketpp::log::elevel::all);
+
+    m_server.init_asio();
+    m_server.set_reuse_addr(true);
+    m_tick_timer = std::make_unique<boost::asio::steady_timer>(m_server.get_io_service());
+
+    using websocketpp::lib::placeholders::_1;
+    using websocketpp::lib::placeholders::_2;
+    // one context shared by every connection, the certificate is read once
+    m_tls_context = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tls_server);
+    try {
+        m_tls_context->set_options(boost::asio::ssl::context::default_workarounds |
+                                   boost::asio::ssl::context::no_sslv2 |
+                                   boost::asio::ssl::context::no_sslv3 |
+                                   boost::asio::ssl::context::single_dh_use);
+        m_tls_context->use_certificate_chain_file(m_options.certificate);
+        m_tls_context->use_private_key_file(m_options.certificate, boost::asio::ssl::context::pem);
+    } catch (std::exception& e) {
+        APP_LOG(log_flags::mock_server, "TLS setup failed (" << m_options.certificate << "): " << e.what());
+    }
+
+    m_server.set_tls_init_handler(websocketpp::lib::bind(&mock_deribit_server::on_tls_init, this, _1));
+    m_server.set_open_handler(websocketpp::lib::bind(&mock_deribit_server::on_open, this, _1));
+    m_server.set_close_handler(websocketpp::lib::bind(&mock_deribit_server::on_close, this, _1));
+    m_server.set_message_handler(websocketpp::lib::bind(&mock_deribit_server::on_message, this, _1, _2));
+
+    // book around 100000 with 0.5 price steps
+    for(std::size_t i = 0; i < MOCK_BOOK_LEVELS; i++) {
+        m_bids[99999.5 - 0.5 * i] = 1000 * (i + 1);
+        m_asks[100000.0 + 0.5 * i] = 1000 * (i + 1);
+    }
+}
+
+mock_deribit_server::~mock_deribit_server() {
+    stop();
+}
+
+bool mock_deribit_server::start() {
+    websocketpp::lib::error_code ec;
+
+    m_server.listen(m_options.port, ec);
+    if (ec) {
+        APP_LOG(log_flags::mock_server, "Could not listen on port " << m_options.port << ": " << ec.message());
+        return false;
+    }
+
+    m_server.start_accept(ec);
+    if (ec) {
+        APP_LOG(log_flags::mock_server, "Could not accept connections: " << ec.message());
+        return false;
+    }
+
+    m_running = true;
+    m_thread = std::thread(&mock_server::run, &m_server);
+
+    APP_LOG(log_flags::mock_server, "Listening on port " << m_options.port);
+    return true;
+}
+
+void mock_deribit_server::stop() {
+    if (!m_running)
+        return;
+
+    m_running = false;
+    m_server.stop();
+    m_thread.join();
+}
+
+mock_deribit_server::context_ptr mock_deribit_server::on_tls_init(websocketpp::connection_hdl) {
+    return m_tls_context;
+}
+
+void mock_deribit_server::on_open(websocketpp::connection_hdl hdl) {
+    session_ptr s = std::make_shared<session>();
+    s->hdl = hdl;
+    m_sessions[hdl] = s;
+}
+
+void mock_deribit_server::on_close(websocketpp::connection_hdl hdl) {
+    m_sessions.erase(hdl);
+}
+
+mock_deribit_server::session_ptr mock_deribit_server::find_session(websocketpp::connection_hdl hdl) {
+    auto it = m_sessions.find(hdl);
+    return it == m_sessions.end() ? session_ptr() : it->second;
+}
+
+void mock_deribit_server::on_message(websocketpp::connection_hdl hdl, mock_server::message_ptr msg) {
+    tsc_clock::time_point recv_time = tsc_clock::now();
+
+    json request = json::parse(msg->get_payload(), nullptr, false);
+    if (request.is_discarded()) {
+        reply_error(hdl, nullptr, -32700, "Parse error");
+        return;
+    }
+
+    if (!request.is_object()) {
+        reply_error(hdl, nullptr, -32600, "Invalid Request");
+        return;
+    }
+
+    json id = request.value("id", json());
+    auto method = request.find("method");
+    auto params = request.find("params");
+
+    if (method == request.end() || !method->is_string() || (params != request.end() && !params->is_object())) {
+        reply_error(hdl, id, -32600, "Invalid Request");
+        return;
+    }
+
+    session_ptr s = find_session(hdl);
+    if (!s)
+        return;
+
+    // a malformed param (of the wrong type) fails the request, not the server thread
+    try {
+        handle_request(*s, id, method->get<std::string>(), params != request.end() ? *params : json::object(), recv_time);
+    } catch (const json::exception& e) {
+        reply_error(hdl, id, -32602, std::string("Invalid params: ") + e.what());
+    }
+}
+
+void mock_deribit_server::handle_request(session& s, const json& id, const std::string& method, const json& params,
+    tsc_clock::time_point recv_time) {
+    websocketpp::connection_hdl hdl = s.hdl;
+
+    if (method == "public/auth") {
+        reply(hdl, id, {
+            {"access_token", "mock_access_token"},
+            {"expires_in", 31536000},
+            {"refresh_token", "mock_refresh_token"},
+            {"scope", "connection mainaccount trade:read_write"},
+            {"token_type", "bearer"}
+        });
+
+    } else if (method == "private/buy" || method == "private/sell" || method == "private/edit" || method == "private/cancel") {
+        // orders triggered by a tick carry its change_id in the label
+        std::string label = params.value("label", "");
+        if (label.compare(0, 5, "tick-") == 0) {
+            std::int64_t change_id = std::atoll(label.c_str() + 5);
+            const tick_record& tick = m_ticks[change_id % MOCK_TICK_HISTORY];
+
+            if (tick.change_id == change_id && m_tick_to_order)
+                m_tick_to_order->record((recv_time - tick.sent).count());
+        }
+
+        json result = place_order(method, params);
+        json order = result.contains("order") ? result["order"] : result;
+
+        reply(hdl, id, std::move(result));
+        notify_order(order);
+
+    } else if (method == "private/cancel_all_by_instrument" || method == "private/cancel_by_label") {
+        reply(hdl, id, 0); // orders are not kept, nothing to cancel
+
+    } else if (method == "public/get_order_book") {
+        reply(hdl, id, order_book(params.value("instrument_name", "BTC-PERPETUAL")));
+
+    } else if (method == "private/subscribe" || method == "public/subscribe") {
+        reply(hdl, id, subscribe(s, params));
+
+    } else if (method == "private/unsubscribe" || method == "public/unsubscribe") {
+        reply(hdl, id, unsubscribe(s, params));
+
+    } else if (method == "private/unsubscribe_all" || method == "public/unsubscribe_all") {
+        s.books.clear();
+        s.user_orders.clear();
+        reply(hdl, id, "ok");
+
+    } else if (method == "public/get_instruments") {
+        reply(hdl, id, instruments(params.value("currency", "any")));
+
+    } else if (method == "public/get_time") {
+        reply(hdl, id, unix_time_ms());
+
+    } else if (method == "public/test") {
+        reply(hdl, id, {{"version", "mock"}});
+
+    } else if (method == "public/set_heartbeat") {
+        reply(hdl, id, "ok"); // no test_requests are sent, sessions are never closed for being idle
+
+    } else if (method == "private/get_positions" || method == "private/get_open_orders") {
+        reply(hdl, id, json::array());
+
+    } else {
+        reply_error(hdl, id, -32601, "Method not found");
+    }
+}
+
+json mock_deribit_server::place_order(const std::string& method, const json& params) {
+    json order;
+
+    if (method == "private/buy" || method == "private/sell") {
+        order["order_id"] = "MOCK-" + std::to_string(m_next_order_id++);
+        order["instrument_name"] = params.value("instrument_name", "");
+        order["direction"] = (method == "private/buy") ? "buy" : "sell";
+        order["order_type"] = params.value("type", "limit");
+        order["time_in_force"] = params.value("time_in_force", "good_til_cancelled");
+        order["label"] = params.value("label", "");
+        order["order_state"] = "open";
+    } else {
+        order["order_id"] = params.value("order_id", "");
+        order["order_state"] = (method == "private/cancel") ? "cancelled" : "open";
+    }
+
+    order["amount"] = params.value("amount", params.value("contracts", 0.0));
+    order["price"] = params.value("price", 0.0);
+    order["filled_amount"] = 0;
+    order["creation_timestamp"] = order["last_update_timestamp"] = unix_time_ms();
+
+    if (method == "private/cancel")
+        return order;
+
+    return {{"order", order}, {"trades", json::array()}};
+}
+
+json mock_deribit_server::order_book(const std::string& instrument) const {
+    json bids = json::array();
+    for (auto it = m_bids.rbegin(); it != m_bids.rend(); ++it)
+        bids.push_back({it->first, it->second});
+
+    json asks = json::array();
+    for (auto it = m_asks.begin(); it != m_asks.end(); ++it)
+        asks.push_back({it->first, it->second});
+
+    return {
+        {"instrument_name", instrument},
+        {"timestamp", unix_time_ms()},
+        {"change_id", m_change_id},
+        {"state", "open"},
+        {"best_bid_price", m_bids.rbegin()->first},
+        {"best_bid_amount", m_bids.rbegin()->second},
+        {"best_ask_price", m_asks.begin()->first},
+        {"best_ask_amount", m_asks.begin()->second},
+        {"bids", bids},
+        {"asks", asks}
+    };
+}
+
+json mock_deribit_server::instruments(const std::string& currency) const {
+    // the trading rules of the real instruments, with the fields the client reads
+    static const json all = {
+        {{"instrument_name", "BTC-PERPETUAL"}, {"base_currency", "BTC"}, {"kind", "future"},
+            {"tick_size", 0.5}, {"contract_size", 10}, {"min_trade_amount", 10}, {"is_active", true}},
+        {{"instrument_name", "ETH-PERPETUAL"}, {"base_currency", "ETH"}, {"kind", "future"},
+            {"tick_size", 0.05}, {"contract_size", 1}, {"min_trade_amount", 1}, {"is_active", true}},
+        {{"instrument_name", "BTC-27DEC24-100000-C"}, {"base_currency", "BTC"}, {"kind", "option"},
+            {"tick_size", 0.0001}, {"contract_size", 1}, {"min_trade_amount", 0.1}, {"is_active", true}}
+    };
+
+    json result = json::array();
+    for (const json& instrument : all) {
+        if (currency == "any" || instrument["base_currency"] == currency)
+            result.push_back(instrument);
+    }
+
+    return result;
+}
+
+json mock_deribit_server::subscribe(session& s, const json& params) {
+    json subscribed = json::array();
+
+    for (const json& channel : params.value("channels", json::array())) {
+        if (!channel.is_string())
+            continue;
+
+        std::string name = channel;
+        subscribed.push_back(name);
+
+        if (name.compare(0, 12, "user.orders.") == 0) {
+            s.user_orders.push_back(name);
+            continue;
+        }
+
+        // only book channels have scripted data
+        if (name.compare(0, 5, "book.") != 0)
+            continue;
+
+        book_channel book {name, channel_instrument(name)};
+        s.books.push_back(book);
+
+        // the subscription starts with a snapshot of the current book
+        send(s.hdl, book_notification(book, true, snapshot_levels(m_bids, true), snapshot_levels(m_asks, false)));
+    }
+
+    schedule_tick();
+    return subscribed;
+}
+
+json mock_deribit_server::unsubscribe(session& s, const json& params) {
+    json unsubscribed = json::array();
+
+    for (const json& channel : params.value("channels", json::array())) {
+        if (!channel.is_string())
+            continue;
+
+        std::string name = channel;
+        unsubscribed.push_back(name);
+
+        s.books.erase(std::remove_if(s.books.begin(), s.books.end(),
+            [&](const book_channel& book) { return book.channel == name; }), s.books.end());
+        s.user_orders.erase(std::remove(s.user_orders.begin(), s.user_orders.end(), name), s.user_orders.end());
+    }
+
+    return unsubscribed;
+}
+
+void mock_deribit_server::schedule_tick() {
+    if (m_ticking)
+        return;
+
+    m_ticking = true;
+    m_tick_timer->expires_after(m_options.tick_interval);
+    m_tick_timer->async_wait([this](const boost::system::error_code& ec) {
+        m_ticking = false;
+        if (!ec)
+            on_tick();
+    });
+}
+
+void mock_deribit_server::on_tick() {
+    bool subscribed = false;
+    for (auto& [hdl, s] : m_sessions)
+        subscribed |= !s->books.empty();
+
+    // stop ticking once nobody is subscribed, the next subscription restarts it
+    if (!subscribed)
+        return;
+
+    // scripted change: cycle through the top levels of both sides
+    m_change_id++;
+    std::size_t level = m_change_id % 5;
+    double amount = 1000 + 10 * ((m_change_id * 37) % 500);
+
+    auto bid = std::prev(m_bids.end(), level + 1);
+    auto ask = std::next(m_asks.begin(), level);
+    bid->second = amount;
+    ask->second = amount + 10;
+
+    json bids = json::array({{"change", bid->first, bid->second}});
+    json asks = json::array({{"change", ask->first, ask->second}});
+
+    m_ticks[m_change_id % MOCK_TICK_HISTORY] = tick_record{m_change_id, tsc_clock::now()};
+
+    for (auto& [hdl, s] : m_sessions)
+        for (const book_channel& book : s->books)
+            send(s->hdl, book_notification(book, false, bids, asks));
+
+    schedule_tick();
+}
+
+json mock_deribit_server::snapshot_levels(const std::map<double, double>& levels, bool descending) const {
+    json out = json::array();
+
+    if (descending) {
+        for (auto it = levels.rbegin(); it != levels.rend(); ++it)
+            out.push_back({"new", it->first, it->second});
+    } else {
+        for (auto it = levels.begin(); it != levels.end(); ++it)
+            out.push_back({"new", it->first, it->second});
+    }
+
+    return out;
+}
+
+json mock_deribit_server::book_notification(const book_channel& book, bool snapshot, const json& bids, const json& asks) {
+    json data = {
+        {"type", snapshot ? "snapshot" : "change"},
+        {"timestamp", unix_time_ms()},
+        {"instrument_name", book.instrument},
+        {"change_id", m_change_id},
+        {"bids", bids},
+        {"asks", asks}
+    };
+
+    if (!snapshot)
+        data["prev_change_id"] = m_change_id - 1;
+
+    return {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {{"channel", book.channel}, {"data", data}}}
+    };
+}
+
+void mock_deribit_server::notify_order(const json& order) {
+    for (auto& [hdl, s] : m_sessions) {
+        for (const std::string& channel : s->user_orders) {
+            send(s->hdl, {
+                {"jsonrpc", "2.0"},
+                {"method", "subscription"},
+                {"params", {{"channel", channel}, {"data", order}}}
+            });
+        }
+    }
+}
+
+void mock_deribit_server::reply(websocketpp::connection_hdl hdl, const json& id, json result) {
+    std::int64_t now = unix_time_ms();
+
+    send(hdl, {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"result", std::move(result)},
+        {"usIn", now * 1000},
+        {"usOut", now * 1000},
+        {"usDiff", 0},
+        {"testnet", true}
+    });
+}
+
+void mock_deribit_server::reply_error(websocketpp::connection_hdl hdl, const json& id, int code, const std::string& message) {
+    send(hdl, {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"error", {{"code", code}, {"message", message}}},
+        {"testnet", true}
+    });
+}
+
+void mock_deribit_server::send(websocketpp::connection_hdl hdl, const json& message) {
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message.dump(), websocketpp::frame::opcode::text, ec);
+
+    if (ec)
+        APP_LOG(log_flags::mock_server, "Send failed: " << ec.message());
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <websocketpp/config/asio.hpp>
+#include <websocketpp/server.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lib/latency_histogram.h>
+#include <lib/tsc_clock.h>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+#define MOCK_DEFAULT_CERTIFICATE "src/mock/mock_server.pem"
+
+constexpr std::uint16_t MOCK_DEFAULT_PORT = 9443;
+constexpr auto MOCK_DEFAULT_TICK_INTERVAL = std::chrono::microseconds(100000);
+constexpr std::size_t MOCK_BOOK_LEVELS = 10;      // per side
+constexpr std::size_t MOCK_TICK_HISTORY = 4096;   // ticks remembered for tick-to-order matching
+
+typedef websocketpp::server<websocketpp::config::asio_tls> mock_server;
+
+// Local stand-in for the Deribit JSON-RPC websocket API, used to benchmark the client offline.
+// Implements the subset of methods used by the client with canned replies (orders are acknowledged
+// as open, never filled). Subscribing to a book.{instrument}.* channel sends a snapshot followed by a
+// scripted change every tick interval, and to a user.orders.* channel the orders placed, edited or
+// cancelled from any session.
+// An order whose label is "tick-<change_id>" is matched with the tick which triggered it, and the
+// time from writing the tick to receiving the order is recorded in the "mock_tick_to_order_wire"
+// latency histogram.
+// All handlers run on the server's own io thread.
+class mock_deribit_server {
+public:
+    struct options {
+        std::uint16_t port = MOCK_DEFAULT_PORT;
+        std::string certificate = MOCK_DEFAULT_CERTIFICATE; // PEM file with the key and certificate
+        std::chrono::microseconds tick_interval = MOCK_DEFAULT_TICK_INTERVAL;
+    };
+
+    explicit mock_deribit_server(options opts);
+    ~mock_deribit_server();
+
+    // listen and serve on a background thread, returns false if the port could not be opened
+    bool start();
+    void stop();
+
+private:
+    struct book_channel {
+        std::string channel;
+        std::string instrument;
+    };
+
+    // state of one client connection
+    struct session {
+        websocketpp::connection_hdl hdl;
+        std::vector<book_channel> books;
+        std::vector<std::string> user_orders; // user.orders.* channels
+    };
+
+    typedef std::shared_ptr<session> session_ptr;
+    typedef std::shared_ptr<boost::asio::ssl::context> context_ptr;
+
+    // websocketpp handlers
+    context_ptr on_tls_init(websocketpp::connection_hdl);
+    void on_open(websocketpp::connection_hdl hdl);
+    void on_close(websocketpp::connection_hdl hdl);
+    void on_message(websocketpp::connection_hdl hdl, mock_server::message_ptr msg);
+
+    // methods
+    void handle_request(session& s, const json& id, const std::string& method, const json& params, tsc_clock::time_point recv_time);
+    json place_order(const std::string& method, const json& params);
+    json subscribe(session& s, const json& params);
+    json unsubscribe(session& s, const json& params);
+    json order_book(const std::string& instrument) const;
+    json instruments(const std::string& currency) const;
+
+    // subscription ticks, one scripted change of the book is sent to every subscribed session
+    void schedule_tick();
+    void on_tick();
+    json book_notification(const book_channel& book, bool snapshot, const json& bids, const json& asks);
+
+    // an order placed, edited or cancelled, notified on every user.orders.* subscription
+    void notify_order(const json& order);
+    json snapshot_levels(const std::map<double, double>& levels, bool descending) const;
+
+    void reply(websocketpp::connection_hdl hdl, const json& id, json result);
+    void reply_error(websocketpp::connection_hdl hdl, const json& id, int code, const std::string& message);
+    void send(websocketpp::connection_hdl hdl, const json& message);
+
+    session_ptr find_session(websocketpp::connection_hdl hdl);
+
+private:
+    options m_options;
+    mock_server m_server;
+    context_ptr m_tls_context; // built once, shared by every connection
+    std::thread m_thread;
+    bool m_running = false;
+
+    std::map<websocketpp::connection_hdl, session_ptr, std::owner_less<websocketpp::connection_hdl>> m_sessions;
+
+    // scripted book, shared by every session and instrument
+    std::map<double, double> m_bids;
+    std::map<double, double> m_asks;
+    std::int64_t m_change_id = 1000;
+    std::unique_ptr<boost::asio::steady_timer> m_tick_timer; // created once asio is initialized
+    bool m_ticking = false;
+
+    // send time of the most recent ticks, indexed by change_id % MOCK_TICK_HISTORY
+    struct tick_record {
+        std::int64_t change_id = 0;
+        tsc_clock::time_point sent;
+    };
+    std::vector<tick_record> m_ticks;
+    latency_histogram* m_tick_to_order;
+
+    std::uint64_t m_next_order_id = 1;
+};
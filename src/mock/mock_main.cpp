@@ -0,0 +1,36 @@
+#include <iostream>
+#include <string>
+
+#include <mock/mock_deribit_server.h>
+#include <lib/utilities.h>
+
+tsc_clock::time_point g_timer_start;
+
+// usage: mock_deribit [port] [tick_interval_us] [certificate]
+// serves until enter is pressed, latencies of tick-triggered orders are printed on exit
+int main(int argc, char* argv[]) {
+    tsc_clock::calibrate();
+    g_timer_start = tsc_clock::now();
+
+    mock_deribit_server::options opts;
+    if (argc > 1)
+        opts.port = static_cast<std::uint16_t>(std::stoi(argv[1]));
+    if (argc > 2)
+        opts.tick_interval = std::chrono::microseconds(std::stoll(argv[2]));
+    if (argc > 3)
+        opts.certificate = argv[3];
+
+    mock_deribit_server server {opts};
+    if (!server.start())
+        return 1;
+
+    std::cout << "Mock Deribit server on wss://localhost:" << opts.port << ", press enter to stop" << std::endl;
+
+    std::string line;
+    std::getline(std::cin, line);
+
+    server.stop();
+    latency_registry::instance().print(std::cout);
+
+    return 0;
+}
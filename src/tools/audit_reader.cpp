@@ -0,0 +1,177 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <websocket/audit_journal.h>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+constexpr auto AUDIT_FOLLOW_POLL_INTERVAL = std::chrono::milliseconds(10);
+
+// lowest segment index present for a base path (older segments may have been archived)
+static bool first_segment(const std::string& base, std::uint64_t& index) {
+    namespace fs = std::filesystem;
+
+    fs::path base_path {base};
+    fs::path directory = base_path.has_parent_path() ? base_path.parent_path() : fs::path{"."};
+    std::string prefix = base_path.filename().string() + ".";
+
+    bool found = false;
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator{directory, ec}) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0 || entry.path().extension() != ".audit")
+            continue;
+
+        char* end = nullptr;
+        std::uint64_t value = std::strtoull(name.c_str() + prefix.size(), &end, 10);
+        if (end == name.c_str() + prefix.size() || std::strcmp(end, ".audit") != 0)
+            continue;
+
+        if (!found || value < index)
+            index = value;
+        found = true;
+    }
+
+    return found;
+}
+
+// UTC time with nanoseconds, eg. 2025-01-22T10:38:38.367012345Z
+static std::string format_time(std::int64_t ns) {
+    std::time_t seconds = static_cast<std::time_t>(ns / 1000000000);
+    std::tm tm;
+    gmtime_r(&seconds, &tm);
+
+    char buf[64];
+    std::size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(buf + len, sizeof(buf) - len, ".%09lldZ", static_cast<long long>(ns % 1000000000));
+    return buf;
+}
+
+static std::string to_hex(std::string_view data) {
+    static constexpr char digits[] = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(data.size() * 2);
+    for (unsigned char c : data) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0xf];
+    }
+    return hex;
+}
+
+static void print_text(const audit_record& record) {
+    std::cout << format_time(record.wall_clock) << " #" << record.sequence << " con " << record.con_id
+        << (record.direction == message_direction::sent ? " SENT " : " RECV ")
+        << (record.frame == journal_frame::text ? std::string{record.payload} : to_hex(record.payload)) << '\n';
+}
+
+static void print_json(const audit_record& record) {
+    json line;
+    line["sequence"] = record.sequence;
+    line["time"] = format_time(record.wall_clock);
+    line["time_ns"] = record.wall_clock;
+    line["con_id"] = record.con_id;
+    line["direction"] = (record.direction == message_direction::sent) ? "sent" : "received";
+
+    // JSON payloads are embedded as objects, anything else as a string
+    if (record.frame != journal_frame::text) {
+        line["frame"] = "binary";
+        line["payload"] = to_hex(record.payload);
+    } else {
+        line["frame"] = "text";
+        json payload = json::parse(record.payload, nullptr, false);
+        line["payload"] = payload.is_discarded() ? json(std::string{record.payload}) : payload;
+    }
+
+    std::cout << line.dump() << '\n';
+}
+
+static void show_usage() {
+    std::cout << "usage: audit_reader <base_path> [--json] [--follow] [--con <id>] [--segment <index>]\n"
+        << "  Prints the records of the audit journal <base_path>.<index>.audit\n"
+        << "  --json            one JSON object per record\n"
+        << "  --follow          keep waiting for new records, like tail -f\n"
+        << "  --con <id>        only records of one connection\n"
+        << "  --segment <index> start at this segment instead of the oldest one\n";
+}
+
+// usage: audit_reader <base_path> [--json] [--follow] [--con <id>] [--segment <index>]
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        show_usage();
+        return 1;
+    }
+
+    std::string base = argv[1];
+    bool as_json = false;
+    bool follow = false;
+    bool filter_con = false;
+    std::int32_t con_id = 0;
+    bool segment_given = false;
+    std::uint64_t segment = 0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--json") {
+            as_json = true;
+        } else if (arg == "--follow") {
+            follow = true;
+        } else if (arg == "--con" && i + 1 < argc) {
+            filter_con = true;
+            con_id = std::atoi(argv[++i]);
+        } else if (arg == "--segment" && i + 1 < argc) {
+            segment_given = true;
+            segment = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            show_usage();
+            return 1;
+        }
+    }
+
+    if (!segment_given && !first_segment(base, segment)) {
+        if (!follow) {
+            std::cerr << "No audit segments found for " << base << "\n";
+            return 1;
+        }
+        segment = 0; // wait for the journal to be created
+    }
+
+    audit_journal_reader reader;
+    while (!reader.open(base, segment)) {
+        if (!follow) {
+            std::cerr << "Could not open " << audit_segment_path(base, segment) << "\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(AUDIT_FOLLOW_POLL_INTERVAL);
+    }
+
+    audit_record record;
+    while (true) {
+        while (reader.next(record)) {
+            if (filter_con && record.con_id != con_id)
+                continue;
+
+            if (as_json)
+                print_json(record);
+            else
+                print_text(record);
+        }
+
+        if (!follow)
+            break;
+
+        std::cout.flush();
+        std::this_thread::sleep_for(AUDIT_FOLLOW_POLL_INTERVAL);
+    }
+
+    return 0;
+}
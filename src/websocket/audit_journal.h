@@ -0,0 +1,408 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <lib/spin_lock.h>
+#include <lib/tsc_clock.h>
+#include <websocket/message_journal.h>
+#include <websocket/message_ring.h>
+
+// Append-only audit trail of every message sent and received, kept in memory-mapped files.
+// The journal is a series of preallocated segments named <base>.<index>.audit. A new journal never
+// overwrites existing segments, it continues from the next free index.
+// Segment layout: a 64 byte segment header, then 8 byte aligned records of a 32 byte record header
+// followed by the payload. The first field of a record (its total size) is stored last with release
+// semantics, so a reader mapping the same file sees either a complete record or a zero.
+// A segment which can not hold the next record is closed by an end of segment record.
+// Appending is a copy into the mapping under a spin lock, with no syscalls.
+
+constexpr char WS_AUDIT_MAGIC[8] = {'W', 'S', 'A', 'U', 'D', 'I', 'T', 1};
+constexpr std::size_t WS_AUDIT_SEGMENT_SIZE = 64 << 20;
+constexpr std::size_t WS_AUDIT_ALIGNMENT = 8;
+
+enum class audit_entry : std::uint8_t {
+    sent = 1,
+    received = 2,
+    segment_end = 3
+};
+
+struct audit_segment_header {
+    char magic[8];
+    std::uint64_t index;
+    std::uint64_t size;             // bytes, including this header
+    std::uint64_t first_sequence;
+    std::int64_t wall_clock_offset; // ns, add to a record timestamp for the system_clock time
+    char reserved[24];
+};
+static_assert(sizeof(audit_segment_header) == 64);
+
+struct audit_record_header {
+    std::uint32_t size;             // header, payload and padding, 0 where nothing is written yet
+    std::uint32_t length;           // payload bytes
+    std::uint8_t entry;             // audit_entry
+    std::uint8_t frame;             // journal_frame
+    std::uint16_t reserved;
+    std::int32_t con_id;
+    std::uint64_t sequence;
+    std::int64_t timestamp;         // ns, tsc_clock
+};
+static_assert(sizeof(audit_record_header) == 32);
+
+// record handed out by the reader, the payload points into the mapped segment
+struct audit_record {
+    std::uint64_t sequence = 0;
+    message_direction direction = message_direction::received;
+    journal_frame frame = journal_frame::text;
+    std::int32_t con_id = 0;
+    std::int64_t timestamp = 0;     // ns, tsc_clock
+    std::int64_t wall_clock = 0;    // ns since the system_clock epoch
+    std::string_view payload;
+};
+
+inline std::string audit_segment_path(const std::string& base, std::uint64_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu.audit", static_cast<unsigned long long>(index));
+    return base + suffix;
+}
+
+inline bool audit_segment_exists(const std::string& base, std::uint64_t index) {
+    struct stat st;
+    return ::stat(audit_segment_path(base, index).c_str(), &st) == 0;
+}
+
+// read-only or read-write mapping of a whole segment file
+class audit_mapping {
+public:
+    audit_mapping() = default;
+    ~audit_mapping() { unmap(); }
+
+    audit_mapping(const audit_mapping&) = delete;
+    audit_mapping& operator=(const audit_mapping&) = delete;
+
+    audit_mapping(audit_mapping&& other) noexcept { *this = std::move(other); }
+    audit_mapping& operator=(audit_mapping&& other) noexcept {
+        if(this != &other) {
+            unmap();
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+        }
+        return *this;
+    }
+
+    // creates and preallocates the file when size is non-zero, maps an existing file otherwise
+    bool map(const std::string& path, std::size_t size) {
+        unmap();
+
+        bool writable = size != 0;
+
+        int fd = writable ? ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644) : ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+
+        struct stat st;
+        bool sized = writable ? (::posix_fallocate(fd, 0, size) == 0) : (::fstat(fd, &st) == 0 && (size = st.st_size) > 0);
+
+        void* data = sized ? ::mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED | (writable ? MAP_POPULATE : 0), fd, 0) : MAP_FAILED;
+        ::close(fd);
+
+        if(data == MAP_FAILED)
+            return false;
+
+        m_data = static_cast<char*>(data);
+        m_size = size;
+        return true;
+    }
+
+    void unmap() {
+        if(m_data)
+            ::munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    explicit operator bool() const { return m_data != nullptr; }
+private:
+    char* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+// Writer side, shared by every connection of an endpoint. Messages are appended from the thread
+// which sends them and from the network thread which receives them.
+// The next segment is created, preallocated and mapped ahead of time by a background thread, so a
+// rotation only swaps mappings.
+class audit_journal {
+public:
+    audit_journal() = default;
+    ~audit_journal() { close(); }
+
+    audit_journal(const audit_journal&) = delete;
+    audit_journal& operator=(const audit_journal&) = delete;
+
+    bool open(const std::string& base, std::size_t segment_size = WS_AUDIT_SEGMENT_SIZE) {
+        close();
+
+        m_base = base;
+        m_segment_size = segment_size;
+        m_sequence = 0;
+
+        m_first_segment = 0;
+        while(audit_segment_exists(base, m_first_segment))
+            m_first_segment++;
+
+        m_segment = m_first_segment;
+        if(!create_segment(m_segment, m_mapping))
+            return false;
+        start_segment();
+
+        m_stop = false;
+        m_prepare_failed = false;
+        m_preparer = std::thread{&audit_journal::prepare_segments, this};
+        return true;
+    }
+
+    // ends the journal with an end of segment record, readers following it move on to the next journal
+    void close() {
+        if(m_preparer.joinable()) {
+            {
+                std::lock_guard<std::mutex> guard {m_prepare_mutex};
+                m_stop = true;
+            }
+            m_prepare_cv.notify_all();
+            m_preparer.join();
+        }
+
+        // the prepared segment was never written to
+        if(m_next) {
+            m_next.unmap();
+            ::unlink(audit_segment_path(m_base, m_segment + 1).c_str());
+        }
+
+        std::lock_guard<spin_lock> guard {m_lock};
+        if(m_mapping) {
+            write_record(sizeof(audit_record_header), audit_entry::segment_end, journal_frame::text, -1, tsc_clock::now(), nullptr, 0);
+            m_mapping.unmap();
+        }
+    }
+
+    // returns false if the journal is not open or the message is larger than a segment
+    bool append(message_direction direction, std::int32_t con_id, journal_frame frame, const char* data, std::size_t length,
+        tsc_clock::time_point timestamp = tsc_clock::now()) {
+        std::size_t size = record_size(length);
+
+        std::lock_guard<spin_lock> guard {m_lock};
+
+        if(!m_mapping || size > m_segment_size - sizeof(audit_segment_header) - sizeof(audit_record_header))
+            return false;
+
+        if(m_offset + size + sizeof(audit_record_header) > m_mapping.size() && !rotate())
+            return false;
+
+        audit_entry entry = (direction == message_direction::sent) ? audit_entry::sent : audit_entry::received;
+        write_record(size, entry, frame, con_id, timestamp, data, length);
+        return true;
+    }
+
+    bool is_open() const { return static_cast<bool>(m_mapping); }
+    const std::string& base() const { return m_base; }
+    std::uint64_t first_segment() const { return m_first_segment; } // first segment written by this journal
+    std::uint64_t records() const { return m_sequence; }
+
+    static std::size_t record_size(std::size_t length) {
+        return (sizeof(audit_record_header) + length + WS_AUDIT_ALIGNMENT - 1) & ~(WS_AUDIT_ALIGNMENT - 1);
+    }
+
+private:
+    // create, preallocate and map a segment and write its header
+    bool create_segment(std::uint64_t index, audit_mapping& mapping) const {
+        if(!mapping.map(audit_segment_path(m_base, index), m_segment_size))
+            return false;
+
+        // dirty every page up front, so that appends do not take the file system's first-write faults
+        std::memset(mapping.data(), 0, mapping.size());
+
+        auto* header = reinterpret_cast<audit_segment_header*>(mapping.data());
+        header->index = index;
+        header->size = m_segment_size;
+
+        auto wall_clock = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        header->wall_clock_offset = wall_clock.count() - tsc_clock::now().time_since_epoch().count();
+
+        // the magic marks the header as complete
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header->magic, WS_AUDIT_MAGIC, sizeof(WS_AUDIT_MAGIC));
+        return true;
+    }
+
+    void start_segment() {
+        reinterpret_cast<audit_segment_header*>(m_mapping.data())->first_sequence = m_sequence;
+        m_offset = sizeof(audit_segment_header);
+    }
+
+    // background thread, keeps the segment after the current one ready
+    void prepare_segments() {
+        std::unique_lock<std::mutex> guard {m_prepare_mutex};
+
+        while(true) {
+            m_prepare_cv.wait(guard, [this] { return m_stop || (!m_next && !m_prepare_failed); });
+            if(m_stop)
+                return;
+
+            std::uint64_t index = m_segment + 1;
+            guard.unlock();
+
+            audit_mapping mapping;
+            bool created = create_segment(index, mapping);
+
+            guard.lock();
+            if(created)
+                m_next = std::move(mapping);
+            else
+                m_prepare_failed = true;
+            m_prepare_cv.notify_all();
+        }
+    }
+
+    // close the current segment with an end record and continue in the prepared one
+    bool rotate() {
+        write_record(sizeof(audit_record_header), audit_entry::segment_end, journal_frame::text, -1, tsc_clock::now(), nullptr, 0);
+
+        std::unique_lock<std::mutex> guard {m_prepare_mutex};
+        m_prepare_cv.wait(guard, [this] { return m_next || m_prepare_failed; });
+
+        if(!m_next) {
+            m_mapping.unmap();
+            return false;
+        }
+
+        m_mapping = std::move(m_next);
+        m_segment++;
+        start_segment();
+
+        m_prepare_cv.notify_all();
+        return true;
+    }
+
+    void write_record(std::size_t size, audit_entry entry, journal_frame frame, std::int32_t con_id,
+        tsc_clock::time_point timestamp, const char* data, std::size_t length) {
+        auto* header = reinterpret_cast<audit_record_header*>(m_mapping.data() + m_offset);
+
+        header->length = static_cast<std::uint32_t>(length);
+        header->entry = static_cast<std::uint8_t>(entry);
+        header->frame = static_cast<std::uint8_t>(frame);
+        header->con_id = con_id;
+        header->sequence = (entry == audit_entry::segment_end) ? m_sequence : m_sequence++;
+        header->timestamp = timestamp.time_since_epoch().count();
+
+        if(length)
+            std::memcpy(header + 1, data, length);
+
+        // publish the record to readers of the mapping
+        __atomic_store_n(&header->size, static_cast<std::uint32_t>(size), __ATOMIC_RELEASE);
+        m_offset += size;
+    }
+
+private:
+    spin_lock m_lock;
+    std::string m_base;
+    std::size_t m_segment_size = WS_AUDIT_SEGMENT_SIZE;
+    std::uint64_t m_first_segment = 0;
+    std::uint64_t m_segment = 0;
+    std::uint64_t m_sequence = 0;
+    std::size_t m_offset = 0;
+    audit_mapping m_mapping;
+
+    // segment preparation
+    std::thread m_preparer;
+    std::mutex m_prepare_mutex;
+    std::condition_variable m_prepare_cv;
+    audit_mapping m_next;
+    bool m_prepare_failed = false;
+    bool m_stop = false;
+};
+
+// Reads the records of a journal in order, across segments. next() returns false when it reaches
+// the end of what has been written so far, it can be called again later to follow a live journal.
+class audit_journal_reader {
+public:
+    // returns false if the first segment does not exist or is not an audit segment
+    bool open(const std::string& base, std::uint64_t first_segment = 0) {
+        m_base = base;
+        m_segment = first_segment;
+        return map_segment();
+    }
+
+    bool next(audit_record& record) {
+        while(true) {
+            if(!m_mapping && !map_segment())
+                return false;
+
+            if(m_offset + sizeof(audit_record_header) > m_mapping.size())
+                return false;
+
+            auto* header = reinterpret_cast<const audit_record_header*>(m_mapping.data() + m_offset);
+            std::uint32_t size = __atomic_load_n(&header->size, __ATOMIC_ACQUIRE);
+            if(size == 0)
+                return false;
+
+            if(header->entry == static_cast<std::uint8_t>(audit_entry::segment_end)) {
+                m_mapping.unmap();
+                m_segment++;
+                continue;
+            }
+
+            record.sequence = header->sequence;
+            record.direction = (header->entry == static_cast<std::uint8_t>(audit_entry::sent)) ? message_direction::sent : message_direction::received;
+            record.frame = static_cast<journal_frame>(header->frame);
+            record.con_id = header->con_id;
+            record.timestamp = header->timestamp;
+            record.wall_clock = header->timestamp + m_wall_clock_offset;
+            record.payload = std::string_view{reinterpret_cast<const char*>(header + 1), header->length};
+
+            m_offset += size;
+            return true;
+        }
+    }
+
+    std::uint64_t segment() const { return m_segment; }
+
+private:
+    bool map_segment() {
+        if(!audit_segment_exists(m_base, m_segment) || !m_mapping.map(audit_segment_path(m_base, m_segment), 0))
+            return false;
+
+        auto* header = reinterpret_cast<const audit_segment_header*>(m_mapping.data());
+        if(m_mapping.size() < sizeof(audit_segment_header) || std::memcmp(header->magic, WS_AUDIT_MAGIC, sizeof(WS_AUDIT_MAGIC)) != 0) {
+            m_mapping.unmap();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        m_wall_clock_offset = header->wall_clock_offset;
+        m_offset = sizeof(audit_segment_header);
+        return true;
+    }
+
+private:
+    std::string m_base;
+    std::uint64_t m_segment = 0;
+    std::size_t m_offset = 0;
+    std::int64_t m_wall_clock_offset = 0;
+    audit_mapping m_mapping;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <lib/spin_lock.h>
+
+// Fixed-size table of connections indexed by id.
+// Ids are handed out densely, a connection lives in slot id % Capacity, and the id stored in the
+// connection itself acts as the slot's generation: a lookup for a stale id finds a different
+// connection in the slot and fails.
+// Lookups hand out shared ownership, so a connection replaced in its slot lives on until the last
+// caller which found it is done with it. Each slot is guarded by its own spin lock, held only to copy
+// the shared_ptr, so lookups of different connections never contend.
+// Insertion must be serialized by the caller, lookups may come from any thread.
+template<typename T, std::size_t Capacity>
+class connection_table {
+public:
+    typedef std::shared_ptr<T> ptr;
+    typedef int id_type;
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    // connection with the given id, empty if it is unknown or its slot has been reused
+    ptr find(id_type id) const {
+        if(id < 0)
+            return ptr();
+
+        ptr connection = occupant(id);
+        return (connection && connection->get_id() == id) ? connection : ptr();
+    }
+
+    // connection currently in the slot an id would use (which may be an older generation)
+    ptr occupant(id_type id) const {
+        const slot& s = m_slots[id % Capacity];
+
+        std::lock_guard<spin_lock> lock {s.lock};
+        return s.connection;
+    }
+
+    // the first id from `from` on whose slot is empty or holds a connection for which finished() is true,
+    // -1 if every slot is still in use
+    template<typename F>
+    id_type next_free(id_type from, F&& finished) const {
+        for(std::size_t i = 0; i < Capacity; i++) {
+            id_type id = from + static_cast<id_type>(i);
+            ptr connection = occupant(id);
+            if(!connection || finished(*connection))
+                return id;
+        }
+        return -1;
+    }
+
+    // the connection replaced in the slot is released once the callers which found it are done with it
+    void insert(ptr connection) {
+        slot& s = m_slots[connection->get_id() % Capacity];
+
+        ptr replaced;
+        {
+            std::lock_guard<spin_lock> lock {s.lock};
+            replaced = std::move(s.connection);
+            s.connection = std::move(connection);
+        }
+    }
+
+    template<typename F>
+    void for_each(F&& fn) const {
+        for(const slot& s : m_slots) {
+            ptr connection;
+            {
+                std::lock_guard<spin_lock> lock {s.lock};
+                connection = s.connection;
+            }
+
+            if(connection)
+                fn(*connection);
+        }
+    }
+
+private:
+    struct slot {
+        mutable spin_lock lock;
+        ptr connection;
+    };
+
+    slot m_slots[Capacity];
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <websocket/request_tracker.h>
+
+constexpr std::size_t WS_BATCH_DEFAULT_CAPACITY = 64 * 1024;
+
+// Client websocket frames (RFC 6455 5.2), masked and framed back to back in one buffer, so that a batch
+// of requests reaches the socket in a single write (see websocket_endpoint::send_batch).
+// The unmasked payloads are kept as well, for the message history and the audit journal.
+// Not thread-safe, a batch is built and sent by one thread and can be reused after clear().
+class frame_batch {
+public:
+    struct request {
+        request_id_type id;
+        std::size_t offset; // of the payload in payloads()
+        std::size_t length;
+    };
+
+    frame_batch() {
+        m_frames.reserve(WS_BATCH_DEFAULT_CAPACITY);
+        m_payloads.reserve(WS_BATCH_DEFAULT_CAPACITY);
+    }
+
+    // a text frame carrying a request, its response is matched by id
+    void append_request(request_id_type id, std::string_view payload) {
+        m_requests.push_back({id, m_payloads.size(), payload.size()});
+        m_payloads.append(payload.data(), payload.size());
+        append_frame(payload);
+    }
+
+    void clear() {
+        m_frames.clear();
+        m_payloads.clear();
+        m_requests.clear();
+    }
+
+    bool empty() const { return m_requests.empty(); }
+    std::size_t size() const { return m_requests.size(); }
+
+    // masked frames, ready to be written to the connection
+    const std::string& frames() const { return m_frames; }
+
+    const std::vector<request>& requests() const { return m_requests; }
+    std::string_view payload(const request& r) const { return std::string_view{m_payloads}.substr(r.offset, r.length); }
+
+private:
+    void append_frame(std::string_view payload) {
+        std::uint64_t length = payload.size();
+
+        m_frames.push_back(static_cast<char>(0x81)); // FIN, text
+
+        // every client frame is masked
+        if(length < 126) {
+            m_frames.push_back(static_cast<char>(0x80 | length));
+        } else if(length <= 0xffff) {
+            m_frames.push_back(static_cast<char>(0x80 | 126));
+            put_big_endian(length, 2);
+        } else {
+            m_frames.push_back(static_cast<char>(0x80 | 127));
+            put_big_endian(length, 8);
+        }
+
+        std::uint32_t key = next_mask();
+        char mask[4];
+        std::memcpy(mask, &key, sizeof(mask));
+        m_frames.append(mask, sizeof(mask));
+
+        std::size_t start = m_frames.size();
+        m_frames.append(payload.data(), payload.size());
+        apply_mask(&m_frames[start], payload.size(), mask);
+    }
+
+    void put_big_endian(std::uint64_t value, int bytes) {
+        for(int i = bytes - 1; i >= 0; i--)
+            m_frames.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    // eight bytes at a time, the mask repeats every four bytes from the start of the payload
+    static void apply_mask(char* data, std::size_t length, const char (&mask)[4]) {
+        std::uint64_t wide;
+        char pattern[8] = {mask[0], mask[1], mask[2], mask[3], mask[0], mask[1], mask[2], mask[3]};
+        std::memcpy(&wide, pattern, sizeof(wide));
+
+        std::size_t i = 0;
+        for(; i + 8 <= length; i += 8) {
+            std::uint64_t block;
+            std::memcpy(&block, data + i, sizeof(block));
+            block ^= wide;
+            std::memcpy(data + i, &block, sizeof(block));
+        }
+
+        for(; i < length; i++)
+            data[i] ^= mask[i & 3];
+    }
+
+    // masks need only be unpredictable to scripts in a browser (RFC 6455 10.3), a seeded xorshift will do
+    std::uint32_t next_mask() {
+        m_mask_state ^= m_mask_state << 13;
+        m_mask_state ^= m_mask_state >> 7;
+        m_mask_state ^= m_mask_state << 17;
+        return static_cast<std::uint32_t>(m_mask_state >> 32);
+    }
+
+    std::string m_frames;
+    std::string m_payloads;
+    std::vector<request> m_requests;
+    std::uint64_t m_mask_state = (static_cast<std::uint64_t>(std::random_device{}()) << 32) | std::random_device{}() | 1;
+};
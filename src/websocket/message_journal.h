@@ -0,0 +1,192 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <lib/tsc_clock.h>
+
+// Binary journal of received websocket frames, for replaying recorded sessions.
+// Layout: an 8 byte file header ("WSJRNL" + version), then one record per frame:
+//   int64  receive time, nanoseconds (tsc_clock)
+//   uint32 payload length
+//   uint8  frame type (1 text, 2 binary, the websocket opcode)
+//   payload bytes
+// Integers are stored in host byte order.
+
+constexpr char WS_JOURNAL_MAGIC[8] = {'W', 'S', 'J', 'R', 'N', 'L', 0, 1};
+constexpr std::size_t WS_JOURNAL_BUFFER_SIZE = 1 << 20;
+
+enum class journal_frame : std::uint8_t {
+    text = 1,
+    binary = 2
+};
+
+struct journal_record {
+    tsc_clock::time_point timestamp;
+    journal_frame frame = journal_frame::text;
+    std::string payload;
+};
+
+// Appends frames to a journal file through a large stdio buffer.
+// Not thread-safe, frames of a connection are appended from its network thread.
+class message_journal_writer {
+public:
+    message_journal_writer() = default;
+    ~message_journal_writer() { close(); }
+
+    message_journal_writer(const message_journal_writer&) = delete;
+    message_journal_writer& operator=(const message_journal_writer&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+
+        m_file = std::fopen(path.c_str(), "wb");
+        if(!m_file)
+            return false;
+
+        std::setvbuf(m_file, nullptr, _IOFBF, WS_JOURNAL_BUFFER_SIZE);
+        std::fwrite(WS_JOURNAL_MAGIC, 1, sizeof(WS_JOURNAL_MAGIC), m_file);
+        return true;
+    }
+
+    void append(tsc_clock::time_point timestamp, journal_frame frame, const char* data, std::size_t length) {
+        if(!m_file)
+            return;
+
+        std::int64_t ns = timestamp.time_since_epoch().count();
+        std::uint32_t size = static_cast<std::uint32_t>(length);
+        std::uint8_t type = static_cast<std::uint8_t>(frame);
+
+        std::fwrite(&ns, sizeof(ns), 1, m_file);
+        std::fwrite(&size, sizeof(size), 1, m_file);
+        std::fwrite(&type, sizeof(type), 1, m_file);
+        std::fwrite(data, 1, size, m_file);
+
+        m_records++;
+    }
+
+    void flush() {
+        if(m_file)
+            std::fflush(m_file);
+    }
+
+    void close() {
+        if(m_file)
+            std::fclose(m_file);
+        m_file = nullptr;
+    }
+
+    bool is_open() const { return m_file != nullptr; }
+    std::uint64_t records() const { return m_records; }
+private:
+    std::FILE* m_file = nullptr;
+    std::uint64_t m_records = 0;
+};
+
+// Reads a journal record by record, the record's payload buffer is reused.
+class message_journal_reader {
+public:
+    message_journal_reader() = default;
+    ~message_journal_reader() { close(); }
+
+    message_journal_reader(const message_journal_reader&) = delete;
+    message_journal_reader& operator=(const message_journal_reader&) = delete;
+
+    // returns false if the file can not be opened or is not a journal
+    bool open(const std::string& path) {
+        close();
+
+        m_file = std::fopen(path.c_str(), "rb");
+        if(!m_file)
+            return false;
+
+        std::setvbuf(m_file, nullptr, _IOFBF, WS_JOURNAL_BUFFER_SIZE);
+
+        char magic[sizeof(WS_JOURNAL_MAGIC)];
+        if(std::fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || std::memcmp(magic, WS_JOURNAL_MAGIC, sizeof(magic)) != 0) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // returns false at the end of the journal (a truncated last record is ignored)
+    bool next(journal_record& record) {
+        std::int64_t ns;
+        std::uint32_t size;
+        std::uint8_t type;
+
+        if(!m_file || std::fread(&ns, sizeof(ns), 1, m_file) != 1 || std::fread(&size, sizeof(size), 1, m_file) != 1
+            || std::fread(&type, sizeof(type), 1, m_file) != 1)
+            return false;
+
+        record.timestamp = tsc_clock::time_point{tsc_clock::duration{ns}};
+        record.frame = static_cast<journal_frame>(type);
+        record.payload.resize(size);
+
+        return std::fread(record.payload.data(), 1, size, m_file) == size;
+    }
+
+    void close() {
+        if(m_file)
+            std::fclose(m_file);
+        m_file = nullptr;
+    }
+private:
+    std::FILE* m_file = nullptr;
+};
+
+struct replay_stats {
+    std::uint64_t messages = 0;
+    std::uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed {0};
+
+    double messages_per_second() const {
+        return elapsed.count() ? messages * 1e9 / elapsed.count() : 0;
+    }
+};
+
+// Feeds the records of a journal to a handler.
+// speed 1 replays at the recorded pace, N at N times the recorded pace, and 0 (or less) as fast as possible.
+template<typename Handler>
+replay_stats replay_journal(message_journal_reader& reader, double speed, Handler&& handler) {
+    // waits shorter than this are spun rather than slept, to keep the pace accurate
+    static constexpr auto spin_threshold = std::chrono::microseconds(200);
+
+    replay_stats stats;
+    journal_record record;
+
+    tsc_clock::time_point start = tsc_clock::now();
+    tsc_clock::time_point first_timestamp;
+    bool first = true;
+
+    while(reader.next(record)) {
+        if(first) {
+            first_timestamp = record.timestamp;
+            first = false;
+        }
+
+        if(speed > 0) {
+            auto offset = std::chrono::duration_cast<tsc_clock::duration>((record.timestamp - first_timestamp) / speed);
+            tsc_clock::time_point target = start + offset;
+
+            for(tsc_clock::duration wait = target - tsc_clock::now(); wait > tsc_clock::duration::zero(); wait = target - tsc_clock::now()) {
+                if(wait > spin_threshold)
+                    std::this_thread::sleep_for(wait - spin_threshold);
+            }
+        }
+
+        handler(static_cast<const journal_record&>(record));
+
+        stats.messages++;
+        stats.bytes += record.payload.size();
+    }
+
+    stats.elapsed = tsc_clock::now() - start;
+    return stats;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <lib/spin_lock.h>
+#include <lib/tsc_clock.h>
+
+enum class message_direction : std::uint8_t {
+    sent,
+    received
+};
+
+// copy of a message slot handed out to readers
+struct message_record {
+    std::uint64_t sequence = 0;
+    message_direction direction = message_direction::received;
+    tsc_clock::time_point timestamp;
+    std::size_t length = 0; // original length, payload holds at most slot_size bytes
+    std::string payload;
+
+    bool truncated() const { return payload.size() < length; }
+};
+
+// Fixed-capacity message history with pre-allocated slots.
+// Writers never allocate, the oldest message is overwritten once the ring is full. Messages are
+// recorded from several threads (sent ones from the threads which send, received ones from the
+// network thread), writers are serialized by a spin lock held for the copy into the slot.
+// Each slot is guarded by a sequence counter (seqlock), readers never lock: they copy a slot out
+// and retry or skip it if a writer touched it during the copy.
+// Messages larger than the slot size are truncated, the original length is kept.
+class message_ring {
+public:
+    message_ring(std::size_t capacity, std::size_t slot_size)
+        : m_capacity{capacity}
+        , m_slot_size{slot_size}
+        , m_slots{std::make_unique<slot[]>(capacity)}
+        , m_data{std::make_unique<char[]>(capacity * slot_size)} {}
+
+    void push(message_direction direction, const char* data, std::size_t length,
+        tsc_clock::time_point timestamp = tsc_clock::now()) {
+        std::lock_guard<spin_lock> lock {m_write_lock};
+
+        std::uint64_t sequence = m_head.load(std::memory_order_relaxed);
+        slot& s = m_slots[sequence % m_capacity];
+
+        // odd sequence marks the slot as being written
+        s.seq.store(2 * sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        s.direction = direction;
+        s.timestamp = timestamp;
+        s.length = length;
+        std::memcpy(slot_data(sequence), data, std::min(length, m_slot_size));
+
+        s.seq.store(2 * sequence + 2, std::memory_order_release);
+        m_head.store(sequence + 1, std::memory_order_release); // readable once written
+    }
+
+    // returns false if the message was overwritten, or if it is being overwritten
+    bool read(std::uint64_t sequence, message_record& record) const {
+        if(sequence >= m_head.load(std::memory_order_acquire) || sequence < first_sequence())
+            return false;
+
+        const slot& s = m_slots[sequence % m_capacity];
+
+        std::uint64_t seq_before = s.seq.load(std::memory_order_acquire);
+        if(seq_before != 2 * sequence + 2)
+            return false;
+
+        record.sequence = sequence;
+        record.direction = s.direction;
+        record.timestamp = s.timestamp;
+        record.length = s.length;
+        record.payload.assign(slot_data(sequence), std::min(record.length, m_slot_size));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.seq.load(std::memory_order_relaxed) == seq_before;
+    }
+
+    // most recent completely written message
+    bool latest(message_record& record) const {
+        std::uint64_t head = m_head.load(std::memory_order_acquire);
+
+        for(std::uint64_t sequence = head; sequence > first_sequence(head); --sequence)
+            if(read(sequence - 1, record))
+                return true;
+
+        return false;
+    }
+
+    // total number of messages pushed so far
+    std::uint64_t size() const { return m_head.load(std::memory_order_acquire); }
+    // oldest sequence which has not been overwritten yet
+    std::uint64_t first_sequence() const { return first_sequence(size()); }
+
+    std::size_t capacity() const { return m_capacity; }
+    std::size_t slot_size() const { return m_slot_size; }
+private:
+    struct slot {
+        std::atomic<std::uint64_t> seq {0};
+        message_direction direction;
+        tsc_clock::time_point timestamp;
+        std::size_t length;
+    };
+
+    std::uint64_t first_sequence(std::uint64_t head) const {
+        return head > m_capacity ? head - m_capacity : 0;
+    }
+
+    char* slot_data(std::uint64_t sequence) const {
+        return m_data.get() + (sequence % m_capacity) * m_slot_size;
+    }
+
+private:
+    const std::size_t m_capacity;
+    const std::size_t m_slot_size;
+
+    std::unique_ptr<slot[]> m_slots;
+    std::unique_ptr<char[]> m_data;
+    std::atomic<std::uint64_t> m_head {0}; // next sequence to write
+    spin_lock m_write_lock;
+};
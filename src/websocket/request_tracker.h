@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <lib/utilities.h>
+#include <lib/tsc_clock.h>
+
+using request_id_type = std::uint64_t;
+
+constexpr auto WS_REQUEST_EXPIRY = std::chrono::seconds(60);     // a request unanswered for this long is failed
+constexpr auto WS_REQUEST_SWEEP_INTERVAL = std::chrono::seconds(1); // between two checks for expired requests, see websocket_endpoint
+
+// response to a request sent with a unique JSON-RPC id
+// payload is empty if the connection went away, or the request expired, before a response arrived
+struct rpc_response {
+    request_id_type id = 0;
+    std::string payload;
+    std::chrono::nanoseconds round_trip {0};
+};
+
+using rpc_future = std::future<rpc_response>;
+using rpc_callback = std::function<void(const rpc_response&)>;
+
+// Pending-request table for a single connection.
+// Requests are registered before they are sent and completed from the network thread
+// when a message carrying the same id arrives. Requests never answered are failed once they expire
+// (see expire), so that the table only holds requests still in flight.
+class request_tracker {
+public:
+    // register a request id, the callback (if any) runs on the network thread
+    rpc_future track(request_id_type id, rpc_callback callback = nullptr) {
+        pending_request request;
+        request.callback = std::move(callback);
+        request.sent_time = tsc_clock::now();
+
+        rpc_future future = request.promise.get_future();
+
+        std::lock_guard<std::mutex> lock {m_mutex};
+        m_pending[id] = std::move(request);
+
+        return future;
+    }
+
+    // drop a request which could not be sent, or whose response is no longer awaited
+    void cancel(request_id_type id) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        m_pending.erase(id);
+    }
+
+    // returns false if no request with the given id is pending
+    bool complete(request_id_type id, const std::string& payload) {
+        pending_request request;
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            auto it = m_pending.find(id);
+            if(it == m_pending.end())
+                return false;
+
+            request = std::move(it->second);
+            m_pending.erase(it);
+        }
+
+        rpc_response response;
+        response.id = id;
+        response.payload = payload;
+        response.round_trip = tsc_clock::now() - request.sent_time;
+
+        APP_LOG(log_flags::benchmark, "Round trip: request " << id << ", took "
+            << std::chrono::duration_cast<std::chrono::microseconds>(response.round_trip).count() << " us");
+
+        if(request.callback)
+            request.callback(response);
+        request.promise.set_value(std::move(response));
+
+        return true;
+    }
+
+    // complete every pending request with an empty response (eg. when the connection closes)
+    void fail_all() {
+        std::unordered_map<request_id_type, pending_request> pending;
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            pending.swap(m_pending);
+        }
+
+        fail(pending);
+    }
+
+    // complete the requests sent before `sent_before` with an empty response, returns their number
+    std::size_t expire(tsc_clock::time_point sent_before) {
+        std::unordered_map<request_id_type, pending_request> expired;
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            for(auto it = m_pending.begin(); it != m_pending.end();) {
+                if(it->second.sent_time < sent_before) {
+                    expired.insert(m_pending.extract(it++));
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        if(!expired.empty())
+            APP_LOG(log_flags::ws, "> Expired " << expired.size() << " requests without a response");
+
+        fail(expired);
+        return expired.size();
+    }
+
+    std::size_t pending_count() const {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        return m_pending.size();
+    }
+private:
+    struct pending_request {
+        std::promise<rpc_response> promise;
+        rpc_callback callback;
+        tsc_clock::time_point sent_time;
+    };
+
+    static void fail(std::unordered_map<request_id_type, pending_request>& requests) {
+        for(auto& [id, request] : requests) {
+            rpc_response response;
+            response.id = id;
+
+            if(request.callback)
+                request.callback(response);
+            request.promise.set_value(std::move(response));
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<request_id_type, pending_request> m_pending;
+};
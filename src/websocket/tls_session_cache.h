@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <openssl/ssl.h>
+
+// Client-side TLS sessions (TLS 1.2 session ids and TLS 1.3 tickets) kept per server name, so that
+// a reconnect resumes the previous session with an abbreviated handshake.
+// Sessions are stored from OpenSSL's new session callback and applied before the handshake.
+class tls_session_cache {
+public:
+    tls_session_cache() = default;
+    ~tls_session_cache() { clear(); }
+
+    tls_session_cache(const tls_session_cache&) = delete;
+    tls_session_cache& operator=(const tls_session_cache&) = delete;
+
+    // takes ownership of the session, replacing the previous one for the server
+    void store(const std::string& server, SSL_SESSION* session) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        SSL_SESSION*& entry = m_sessions[server];
+        if(entry)
+            SSL_SESSION_free(entry);
+        entry = session;
+    }
+
+    // offer the cached session for the server on a connection about to handshake
+    bool apply(SSL* ssl, const std::string& server) {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        auto it = m_sessions.find(server);
+        if(it == m_sessions.end())
+            return false;
+
+        // a session which can no longer be resumed is dropped
+        if(!SSL_SESSION_is_resumable(it->second)) {
+            SSL_SESSION_free(it->second);
+            m_sessions.erase(it);
+            return false;
+        }
+
+        return SSL_set_session(ssl, it->second) == 1;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock {m_mutex};
+
+        for(auto& entry : m_sessions)
+            SSL_SESSION_free(entry.second);
+        m_sessions.clear();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::map<std::string, SSL_SESSION*> m_sessions;
+};
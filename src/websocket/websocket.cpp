@@ -1,35 +1,100 @@
 #include <websocket/websocket.h>
 #include <lib/utilities.h>
+#include <lib/json_scanner.h>
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+// extract the id of a JSON-RPC response by scanning the top level keys
+// notifications carry a method instead of an id, scanning stops there
+static bool get_response_id(std::string_view payload, request_id_type& id) {
+    json_scanner scanner {payload};
+    std::string_view key;
+
+    if(!scanner.enter_object())
+        return false;
+
+    while(scanner.next_key(key)) {
+        if(key == "id")
+            return scanner.read_uint(id);
+        if(key == "method" || !scanner.skip_value())
+            return false;
+    }
+
+    return false;
+}
+
 /// connection_metadata
 
-connection_metadata::connection_metadata(con_id_type id, websocketpp::connection_hdl hdl, std::string uri)
+connection_metadata::connection_metadata(con_id_type id, websocketpp::connection_hdl hdl, std::string uri,
+    std::size_t history_capacity, message_listener listener, state_listener on_state)
     : m_id(id)
     , m_hdl(hdl)
-    , m_status(WS_INIT_STATUS)
     , m_uri(uri)
-    , m_server("N/A") {}
+    , m_server("N/A")
+    , m_messages(history_capacity, WS_DEFAULT_HISTORY_SLOT_SIZE)
+    , m_listener(std::move(listener))
+    , m_state_listener(std::move(on_state)) {}
+
+connection_metadata::~connection_metadata() {
+    delete m_journal.load();
+}
+
+// connect phases of an opened connection, per phase histograms
+static void record_connect_timing(const connect_timing& timing) {
+    static latency_histogram* tcp_phase = latency_registry::instance().histogram("ws_connect_dns_tcp");
+    static latency_histogram* tls_phase = latency_registry::instance().histogram("ws_connect_tls");
+    static latency_histogram* tls_resumed_phase = latency_registry::instance().histogram("ws_connect_tls_resumed");
+    static latency_histogram* upgrade_phase = latency_registry::instance().histogram("ws_connect_upgrade");
+    static latency_histogram* total = latency_registry::instance().histogram("ws_connect_total");
+
+    auto record = [](latency_histogram* histogram, tsc_clock::duration phase) {
+        if (histogram) // nullptr once the latency registry is full
+            histogram->record(phase.count());
+    };
+
+    record(tcp_phase, timing.tcp_connected - timing.start);
+    record(timing.tls_resumed ? tls_resumed_phase : tls_phase, timing.tls_done - timing.tcp_connected);
+    record(upgrade_phase, timing.open - timing.tls_done);
+    record(total, timing.open - timing.start);
+}
 
 void connection_metadata::on_open(client * c, websocketpp::connection_hdl hdl) {
-    m_status = WS_OPEN_STATUS;
+    m_connect_timing.open = tsc_clock::now();
+    m_status.store(connection_status::open, std::memory_order_release);
 
     client::connection_ptr con = c->get_con_from_hdl(hdl);
     m_server = con->get_response_header("Server");
+
+    record_connect_timing(m_connect_timing);
+
+    if (m_state_listener)
+        m_state_listener(m_id, true);
 }
 
 void connection_metadata::on_fail(client * c, websocketpp::connection_hdl hdl) {
-    m_status = WS_FAIL_STATUS;
+    m_status.store(connection_status::failed, std::memory_order_release);
 
     client::connection_ptr con = c->get_con_from_hdl(hdl);
     m_server = con->get_response_header("Server");
     m_error_reason = con->get_ec().message();
+
+    m_requests.fail_all();
+
+    if (m_state_listener)
+        m_state_listener(m_id, false);
 }
 
 void connection_metadata::on_close(client * c, websocketpp::connection_hdl hdl) {
-    m_status = WS_CLOSE_STATUS;
+    m_status.store(connection_status::closed, std::memory_order_release);
 
     client::connection_ptr con = c->get_con_from_hdl(hdl);
     std::stringstream s;
@@ -38,40 +103,107 @@ void connection_metadata::on_close(client * c, websocketpp::connection_hdl hdl)
         << websocketpp::close::status::get_string(con->get_remote_close_code()) 
         << "), close reason: " << con->get_remote_close_reason();
     m_error_reason = s.str();
+
+    m_requests.fail_all();
+
+    if (m_state_listener)
+        m_state_listener(m_id, false);
 }
 
 void connection_metadata::on_message(client * c, websocketpp::connection_hdl hdl, message_ptr msg) {
-    if (msg->get_opcode() == websocketpp::frame::opcode::text) {
-        m_messages.push_back("RECV: " + msg->get_payload());
-    } else {
-        m_messages.push_back("RECV: " + websocketpp::utility::to_hex(msg->get_payload()));
+    auto recv_time = tsc_clock::now();
+    const std::string& payload = msg->get_payload();
+    journal_frame frame = (msg->get_opcode() == websocketpp::frame::opcode::text) ? journal_frame::text : journal_frame::binary;
+
+    if (m_audit)
+        m_audit->append(message_direction::received, m_id, frame, payload.data(), payload.size(), recv_time);
+
+    if (message_journal_writer* journal = m_journal.load(std::memory_order_acquire))
+        journal->append(recv_time, frame, payload.data(), payload.size());
+
+    handle_message(frame, payload, recv_time);
+}
+
+void connection_metadata::handle_message(journal_frame frame, const std::string& payload, tsc_clock::time_point recv_time) {
+    if (frame != journal_frame::text) {
+        std::string hex = websocketpp::utility::to_hex(payload);
+        m_messages.push(message_direction::received, hex.data(), hex.size(), recv_time);
+        return;
     }
+
+    m_messages.push(message_direction::received, payload.data(), payload.size(), recv_time);
+
+    // complete the pending request this message responds to
+    request_id_type request_id;
+    if(get_response_id(payload, request_id))
+        m_requests.complete(request_id, payload);
+
+    if(m_listener)
+        m_listener(payload);
+}
+
+void connection_metadata::record_sent_message(std::string_view message) {
+    auto send_time = tsc_clock::now();
+    m_messages.push(message_direction::sent, message.data(), message.size(), send_time);
+
+    if (m_audit)
+        m_audit->append(message_direction::sent, m_id, journal_frame::text, message.data(), message.size(), send_time);
 }
 
-std::string& connection_metadata::record_sent_message(std::string message) {
-    m_messages.push_back("SENT: " + message);
-    return m_messages.back();
+rpc_future connection_metadata::track_request(request_id_type id, rpc_callback callback) {
+    return m_requests.track(id, std::move(callback));
+}
+
+void connection_metadata::print_details(std::ostream& out) const {
+    out << "> URI: " << m_uri << "\n"
+        << "> Status: " << status_name(get_status()) << "\n"
+        << "> Remote Server: " << (m_server.empty() ? "None Specified" : m_server) << "\n"
+        << "> Error/close reason: " << (m_error_reason.empty() ? "N/A" : m_error_reason) << "\n";
+
+    if (m_connect_timing.complete()) {
+        auto us = [](tsc_clock::duration d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+        const connect_timing& t = m_connect_timing;
+
+        out << "> Connect: " << us(t.open - t.start) << " us (dns+tcp " << us(t.tcp_connected - t.start)
+            << " us, tls " << us(t.tls_done - t.tcp_connected) << " us" << (t.tls_resumed ? " resumed" : "")
+            << ", upgrade " << us(t.open - t.tls_done) << " us)\n";
+    }
+}
+
+// one message of a connection's history
+static void print_message(std::ostream& out, message_direction direction, std::string_view payload) {
+    out << (direction == message_direction::sent ? "SENT: " : "RECV: "); // output message type
+
+    // disable prettifying for profiling
+    json j = json::parse(payload, nullptr, false);
+    if (!j.is_discarded())
+        out << std::setw(WS_JSON_FORMAT_WIDTH) << j << '\n';
+    else
+        out << payload << '\n';
 }
 
 std::ostream & operator<<(std::ostream & out, connection_metadata const & data) {
-    out << "> URI: " << data.m_uri << "\n"
-        << "> Status: " << data.m_status << "\n"
-        << "> Remote Server: " << (data.m_server.empty() ? "None Specified" : data.m_server) << "\n"
-        << "> Error/close reason: " << (data.m_error_reason.empty() ? "N/A" : data.m_error_reason) << "\n";
-    out << "> Messages Processed: (" << data.m_messages.size() << ") \n\n";
-
-    for (auto it = data.m_messages.begin(); it != data.m_messages.end(); ++it) {
-        out << it->substr(0, WS_MSG_TYPE_LEN); // output message type
-        auto msg = it->substr(WS_MSG_TYPE_LEN);
-        // out << msg << '\n';
-
-        // disable prettifying for profiling
-        try {
-            json j = json::parse(msg);
-            out << std::setw(WS_JSON_FORMAT_WIDTH) << j << '\n';
-        } catch(...) {
-            out << msg << '\n';
+    data.print_details(out);
+    out << "> Messages Processed: (" << data.m_messages.size() << ") \n";
+
+    // only the most recent messages are kept in the history
+    std::uint64_t first = data.m_messages.first_sequence();
+    if (first > 0)
+        out << "> Showing last " << data.m_messages.size() - first << " messages\n";
+    out << "\n";
+
+    message_record record;
+    for (std::uint64_t seq = first; seq < data.m_messages.size(); ++seq) {
+        if (!data.m_messages.read(seq, record))
+            continue; // overwritten while printing
+
+        if (record.truncated()) {
+            out << (record.direction == message_direction::sent ? "SENT: " : "RECV: ")
+                << record.payload << "... (truncated, " << record.length << " bytes)\n";
+            continue;
         }
+
+        print_message(out, record.direction, record.payload);
     }
 
     return out;
@@ -79,39 +211,167 @@ std::ostream & operator<<(std::ostream & out, connection_metadata const & data)
 
 /// websocket_endpoint
 
-websocket_endpoint::websocket_endpoint(): m_next_id(0) {
-    m_endpoint.clear_access_channels(websocketpp::log::alevel::all);
-    m_endpoint.clear_error_channels(websocketpp::log::elevel::all);
+websocket_endpoint::websocket_endpoint()
+    : websocket_endpoint(options{}) {}
+
+websocket_endpoint::websocket_endpoint(options opts)
+    : m_next_id(0)
+    , m_options(std::move(opts)) {
+    std::vector<int>& cpus = m_options.worker_cpus;
+
+    if (cpus.empty())
+        cpus.push_back(NO_CPU);
+
+    if (cpus.size() > WS_MAX_WORKERS) {
+        APP_LOG(log_flags::ws, "> Too many network threads, using " << WS_MAX_WORKERS);
+        cpus.resize(WS_MAX_WORKERS);
+    }
+
+    if (m_options.run_mode == network_run_mode::busy_poll && std::thread::hardware_concurrency() <= cpus.size())
+        APP_LOG(log_flags::ws, "> Busy polling with " << cpus.size() << " network threads on "
+            << std::thread::hardware_concurrency() << " cpus, each spinning thread needs a core of its own");
+
+    m_tls_context = make_tls_context();
 
-    m_endpoint.init_asio();
-    m_endpoint.start_perpetual(); // run in perpetual mode
+    for (std::size_t i = 0; i < cpus.size(); i++) {
+        auto w = std::make_unique<worker>();
+        w->cpu = cpus[i];
 
-    // run endpoint on seperate thread
-    m_thread = websocketpp::lib::make_shared<websocketpp::lib::thread>(&client::run, &m_endpoint);
+        w->endpoint.clear_access_channels(websocketpp::log::alevel::all);
+        w->endpoint.clear_error_channels(websocketpp::log::elevel::all);
+
+        w->endpoint.init_asio();
+        w->endpoint.start_perpetual(); // run in perpetual mode
+
+        w->sweep_timer = std::make_unique<boost::asio::steady_timer>(w->endpoint.get_io_service());
+        schedule_sweep(*w);
+
+        // use tls connection, every connection shares the endpoint's context
+        w->endpoint.set_tls_init_handler(websocketpp::lib::bind(
+            &websocket_endpoint::on_tls_init,
+            this,
+            websocketpp::lib::placeholders::_1
+        ));
+
+        // run endpoint on seperate thread
+        w->thread = websocketpp::lib::make_shared<websocketpp::lib::thread>(
+            &websocket_endpoint::run_worker, this, std::ref(*w), i);
+
+        m_workers.push_back(std::move(w));
+    }
 }
 
 websocket_endpoint::~websocket_endpoint() {
-    m_endpoint.stop_perpetual(); // stop perpetual mode
+    for (auto& w : m_workers) {
+        w->endpoint.stop_perpetual(); // stop perpetual mode
+
+        // a pending sweep would keep the io_service running, the timer is only touched on its thread
+        worker* stopping = w.get();
+        w->endpoint.get_io_service().post([stopping]() { stopping->sweep_timer->cancel(); });
+    }
     
-    for (con_list::const_iterator it = m_connection_list.begin(); it != m_connection_list.end(); ++it) {
+    m_connection_list.for_each([&](connection_metadata& metadata) {
         // Only close open connections
-        if (it->second->get_status() != WS_OPEN_STATUS)
-            continue;
+        if (metadata.get_status() != connection_status::open)
+            return;
 
-        APP_LOG(log_flags::ws, "> Closing connection " << it->second->get_id());
+        APP_LOG(log_flags::ws, "> Closing connection " << metadata.get_id());
 
         websocketpp::lib::error_code ec;
-        m_endpoint.close(it->second->get_hdl(), websocketpp::close::status::going_away, "", ec);
+        metadata.m_client->close(metadata.get_hdl(), websocketpp::close::status::going_away, "", ec);
         
         if (ec)
-            APP_LOG(log_flags::ws, "> Error closing connection " << it->second->get_id() << ": " << ec.message());
-    }
+            APP_LOG(log_flags::ws, "> Error closing connection " << metadata.get_id() << ": " << ec.message());
+    });
     
-    // wait till thread is complete
-    m_thread->join();
+    // wait till threads are complete
+    for (auto& w : m_workers)
+        w->thread->join();
+}
+
+void websocket_endpoint::run_worker(worker& w, std::size_t index) {
+    int realtime_priority = m_options.realtime_priority;
+
+    set_current_thread_name("ws-net-" + std::to_string(index));
+
+    if (w.cpu != NO_CPU && !pin_current_thread(w.cpu))
+        APP_LOG(log_flags::ws, "> Could not pin network thread " << index << " to cpu " << w.cpu);
+
+    if (realtime_priority > 0 && !set_current_thread_realtime(realtime_priority))
+        APP_LOG(log_flags::ws, "> Could not set SCHED_FIFO priority " << realtime_priority << " on network thread " << index
+            << " (needs CAP_SYS_NICE)");
+
+    if (m_options.run_mode == network_run_mode::blocking) {
+        w.endpoint.run();
+        return;
+    }
+
+    // the io_service stops by itself once perpetual mode is off and the last connection is done
+    boost::asio::io_service& io_service = w.endpoint.get_io_service();
+    std::uint64_t polls = 0, idle_polls = 0, handlers = 0;
+
+    while (!io_service.stopped()) {
+        std::size_t ran = io_service.poll();
+
+        polls++;
+        if (ran == 0)
+            idle_polls++;
+        handlers += ran;
+
+        w.polls.store(polls, std::memory_order_relaxed);
+        w.idle_polls.store(idle_polls, std::memory_order_relaxed);
+        w.handlers.store(handlers, std::memory_order_relaxed);
+    }
 }
 
-context_ptr websocket_endpoint::on_tls_init() {
+websocket_endpoint::worker_stats websocket_endpoint::get_worker_stats(std::size_t worker) const {
+    if (worker >= m_workers.size())
+        return worker_stats{};
+
+    const struct worker& w = *m_workers[worker];
+    return worker_stats{w.cpu, w.polls.load(std::memory_order_relaxed), w.idle_polls.load(std::memory_order_relaxed),
+        w.handlers.load(std::memory_order_relaxed)};
+}
+
+void websocket_endpoint::on_socket_init(connection_metadata* metadata, websocketpp::connection_hdl hdl, tls_socket& socket) {
+    // called once the TCP connection is established, before the TLS handshake
+    metadata->m_connect_timing.tcp_connected = tsc_clock::now();
+
+    int fd = socket.lowest_layer().native_handle();
+    int enabled = 1;
+
+    if (m_options.tcp_no_delay && ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled)) != 0)
+        APP_LOG(log_flags::ws, "> Could not set TCP_NODELAY: " << std::strerror(errno));
+
+    // the kernel may fall back to delayed ACKs later on, this covers the handshakes and first messages
+    if (m_options.tcp_quick_ack && ::setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &enabled, sizeof(enabled)) != 0)
+        APP_LOG(log_flags::ws, "> Could not set TCP_QUICKACK: " << std::strerror(errno));
+
+    // buffer sizes set after the connection is established no longer affect the negotiated window scale
+    if (m_options.receive_buffer > 0 && ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &m_options.receive_buffer, sizeof(m_options.receive_buffer)) != 0)
+        APP_LOG(log_flags::ws, "> Could not set SO_RCVBUF: " << std::strerror(errno));
+
+    if (m_options.send_buffer > 0 && ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &m_options.send_buffer, sizeof(m_options.send_buffer)) != 0)
+        APP_LOG(log_flags::ws, "> Could not set SO_SNDBUF: " << std::strerror(errno));
+
+    // let blocking reads and epoll spin on the device queue for this long before sleeping
+    if (m_options.busy_poll_us > 0 && ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &m_options.busy_poll_us, sizeof(m_options.busy_poll_us)) != 0)
+        APP_LOG(log_flags::ws, "> Could not set SO_BUSY_POLL: " << std::strerror(errno) << " (needs CAP_NET_ADMIN)");
+
+    // the server name (SNI) has already been set from the uri
+    SSL* ssl = socket.native_handle();
+    SSL_set_app_data(ssl, metadata);
+
+    const char* server = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (m_options.tls_session_resumption && server)
+        m_tls_sessions.apply(ssl, server);
+}
+
+context_ptr websocket_endpoint::on_tls_init(websocketpp::connection_hdl hdl) {
+    return m_tls_context;
+}
+
+context_ptr websocket_endpoint::make_tls_context() {
     context_ptr ctx = websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23);
 
     try {
@@ -123,58 +383,112 @@ context_ptr websocket_endpoint::on_tls_init() {
         APP_LOG(log_flags::ws, e.what());
     }
 
+    SSL_CTX* native = ctx->native_handle();
+    SSL_CTX_set_app_data(native, this);
+    SSL_CTX_set_info_callback(native, &websocket_endpoint::on_tls_state);
+
+    // sessions are kept by the endpoint per server name, OpenSSL's internal cache is only used by servers
+    if (m_options.tls_session_resumption) {
+        SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(native, &websocket_endpoint::on_new_tls_session);
+    }
+
     return ctx;
 }
 
-con_id_type websocket_endpoint::connect(const std::string& uri) {
-    // use tls connection
-    m_endpoint.set_tls_init_handler(websocketpp::lib::bind(&on_tls_init));
+int websocket_endpoint::on_new_tls_session(SSL* ssl, SSL_SESSION* session) {
+    auto* endpoint = static_cast<websocket_endpoint*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    const char* server = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+
+    if (!endpoint || !server)
+        return 0;
+
+    endpoint->m_tls_sessions.store(server, session);
+    return 1; // the cache owns the session
+}
+
+void websocket_endpoint::on_tls_state(const SSL* ssl, int where, int ret) {
+    if (!(where & SSL_CB_HANDSHAKE_DONE))
+        return;
 
+    auto* metadata = static_cast<connection_metadata*>(SSL_get_app_data(ssl));
+    if (!metadata || metadata->m_connect_timing.tls_done != tsc_clock::time_point{})
+        return;
+
+    metadata->m_connect_timing.tls_done = tsc_clock::now();
+    metadata->m_connect_timing.tls_resumed = SSL_session_reused(const_cast<SSL*>(ssl));
+}
+
+con_id_type websocket_endpoint::connect(const std::string& uri, message_listener listener, std::size_t worker, state_listener on_state) {
     websocketpp::lib::error_code ec;
-    con_id_type new_id = m_next_id++;
+    tsc_clock::time_point start = tsc_clock::now();
+    std::lock_guard<std::mutex> lock {m_connect_mutex};
+
+    client& endpoint = m_workers[worker % m_workers.size()]->endpoint;
+
+    // a slot is reused only once its previous connection is finished, ids whose slot is still in use
+    // (eg. a long-lived session while others reconnect) are skipped
+    con_id_type new_id = m_connection_list.next_free(m_next_id, [](const connection_metadata& previous) { return !previous.in_use(); });
+    if (new_id == WS_CON_ERR_CODE) {
+        APP_LOG(log_flags::ws, "> Too many connections, " << WS_MAX_CONNECTIONS << " are still in use");
+        return WS_CON_ERR_CODE;
+    }
 
-    client::connection_ptr con = m_endpoint.get_connection(uri, ec);
+    client::connection_ptr con = endpoint.get_connection(uri, ec);
 
     if (ec) {
         APP_LOG(log_flags::ws, "> Connect initialization error: " << ec.message());
         return WS_CON_ERR_CODE;
     }
 
-    connection_metadata::ptr metadata_ptr = websocketpp::lib::make_shared<connection_metadata>(new_id, con->get_handle(), uri);
-    m_connection_list[new_id] = metadata_ptr; // store the connection and associated metadata
+    connection_metadata::ptr metadata_ptr = websocketpp::lib::make_shared<connection_metadata>(new_id, con->get_handle(), uri,
+        m_options.history_capacity, std::move(listener), std::move(on_state));
+    metadata_ptr->m_audit = m_audit.get();
+    metadata_ptr->m_client = &endpoint;
+    metadata_ptr->m_connect_timing.start = start;
+    m_connection_list.insert(metadata_ptr); // store the connection and associated metadata
+    m_next_id = new_id + 1;
 
     // register callbacks
+    con->set_socket_init_handler(websocketpp::lib::bind(
+        &websocket_endpoint::on_socket_init,
+        this,
+        metadata_ptr.get(),
+        websocketpp::lib::placeholders::_1,
+        websocketpp::lib::placeholders::_2
+    ));
+
     con->set_open_handler(websocketpp::lib::bind(
         &connection_metadata::on_open,
         metadata_ptr,
-        &m_endpoint,
+        &endpoint,
         websocketpp::lib::placeholders::_1
     ));
 
     con->set_fail_handler(websocketpp::lib::bind(
         &connection_metadata::on_fail,
         metadata_ptr,
-        &m_endpoint,
+        &endpoint,
         websocketpp::lib::placeholders::_1
     ));
 
     con->set_close_handler(websocketpp::lib::bind(
         &connection_metadata::on_close,
         metadata_ptr,
-        &m_endpoint,
+        &endpoint,
         websocketpp::lib::placeholders::_1
     ));
 
     con->set_message_handler(websocketpp::lib::bind(
         &connection_metadata::on_message,
         metadata_ptr,
-        &m_endpoint,
+        &endpoint,
         websocketpp::lib::placeholders::_1,
         websocketpp::lib::placeholders::_2
     ));
 
     // intialize connection
-    m_endpoint.connect(con);
+    endpoint.connect(con);
 
     return new_id;
 }
@@ -182,34 +496,34 @@ con_id_type websocket_endpoint::connect(const std::string& uri) {
 void websocket_endpoint::close(con_id_type id, websocketpp::close::status::value code, std::string reason) {
     websocketpp::lib::error_code ec;
     
-    con_list::iterator metadata_it = m_connection_list.find(id);
+    connection_metadata::ptr metadata = m_connection_list.find(id);
 
-    if (metadata_it == m_connection_list.end()) {
+    if (!metadata) {
         APP_LOG(log_flags::ws, "> No connection found with id " << id);
         return;
     }
 
-    m_endpoint.close(metadata_it->second->get_hdl(), code, reason, ec);
+    metadata->m_client->close(metadata->get_hdl(), code, reason, ec);
     
     if (ec)
        APP_LOG(log_flags::ws, "> Error initiating close: " << ec.message());
 }
 
-websocket_endpoint::send_result websocket_endpoint::send(con_id_type id, std::string message) {
+websocket_endpoint::send_result websocket_endpoint::send(con_id_type id, std::string_view message) {
     websocketpp::lib::error_code ec;
 
-    // benchmark send request
-    benchmark send_benchmark {"send_request_benchmark"};
+    // benchmark send request, kept per thread so that the label is only looked up once
+    thread_local benchmark send_benchmark {"send_request_benchmark"};
     send_benchmark.start();
 
-    con_list::iterator metadata_it = m_connection_list.find(id);
-    if (metadata_it == m_connection_list.end()) {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (!metadata) {
         APP_LOG(log_flags::ws, "> No connection found with id " << id);
         return send_result{ec, "No connection found with id"};
     }
     
     // send message
-    m_endpoint.send(metadata_it->second->get_hdl(), message, websocketpp::frame::opcode::text, ec);
+    metadata->m_client->send(metadata->get_hdl(), message.data(), message.size(), websocketpp::frame::opcode::text, ec);
 
     if (ec) {
         APP_LOG(log_flags::ws, "> Error sending message: " << ec.message());
@@ -221,25 +535,223 @@ websocket_endpoint::send_result websocket_endpoint::send(con_id_type id, std::st
     // end global benchmark
     g_benchmark.end();
 
-    metadata_it->second->record_sent_message(message);
+    metadata->record_sent_message(message);
 
     return send_result{};
 }
 
-connection_metadata::ptr websocket_endpoint::get_metadata(con_id_type id) const {
-    con_list::const_iterator metadata_it = m_connection_list.find(id);
+websocket_endpoint::send_result websocket_endpoint::send_request(con_id_type id, request_id_type request_id, std::string_view message, rpc_callback callback) {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (!metadata) {
+        APP_LOG(log_flags::ws, "> No connection found with id " << id);
+        return send_result{websocketpp::lib::error_code{}, "No connection found with id"};
+    }
 
-    if (metadata_it == m_connection_list.end())
-        return connection_metadata::ptr();
-    else
-        return metadata_it->second;
+    // register the request before sending, so that a fast response is never missed
+    rpc_future response = metadata->track_request(request_id, std::move(callback));
+
+    send_result result = send(id, message);
+    if (result.ec || !result.err_message.empty()) {
+        metadata->cancel_request(request_id);
+        return result;
+    }
+
+    result.response = std::move(response);
+    return result;
+}
+
+void websocket_endpoint::cancel_request(con_id_type id, request_id_type request_id) {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (metadata)
+        metadata->cancel_request(request_id);
+}
+
+websocket_endpoint::send_result websocket_endpoint::send_batch(con_id_type id, const frame_batch& batch, std::vector<rpc_future>& responses,
+    rpc_callback callback) {
+    websocketpp::lib::error_code ec;
+
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (!metadata) {
+        APP_LOG(log_flags::ws, "> No connection found with id " << id);
+        return send_result{ec, "No connection found with id"};
+    }
+
+    client::connection_ptr con = metadata->m_client->get_con_from_hdl(metadata->get_hdl(), ec);
+    if (ec) {
+        APP_LOG(log_flags::ws, "> Error sending batch: " << ec.message());
+        return send_result{ec, ec.message()};
+    }
+
+    // register every request before sending, so that a fast response is never missed
+    std::size_t first_response = responses.size();
+    for (const frame_batch::request& request : batch.requests())
+        responses.push_back(metadata->track_request(request.id, callback));
+
+    // the frames are already masked, websocketpp queues the prepared message as it is
+    // and writes it with a single async_write
+    message_ptr msg = websocketpp::lib::make_shared<message_type>(message_type::con_msg_man_ptr(),
+        websocketpp::frame::opcode::text, batch.frames().size());
+    msg->set_header("");
+    msg->set_payload(batch.frames());
+    msg->set_prepared(true);
+
+    ec = con->send(msg);
+
+    if (ec) {
+        APP_LOG(log_flags::ws, "> Error sending batch: " << ec.message());
+        for (const frame_batch::request& request : batch.requests())
+            metadata->cancel_request(request.id);
+        responses.resize(first_response);
+        return send_result{ec, ec.message()};
+    }
+
+    g_benchmark.end();
+
+    for (const frame_batch::request& request : batch.requests())
+        metadata->record_sent_message(batch.payload(request));
+
+    return send_result{};
+}
+
+void websocket_endpoint::schedule_sweep(worker& w) {
+    w.sweep_timer->expires_after(WS_REQUEST_SWEEP_INTERVAL);
+    w.sweep_timer->async_wait([this, &w](const boost::system::error_code& ec) {
+        if (ec)
+            return; // cancelled, the endpoint is being destroyed
+
+        // requests never answered, whether or not the connection still receives messages
+        tsc_clock::time_point sent_before = tsc_clock::now() - WS_REQUEST_EXPIRY;
+        m_connection_list.for_each([&](connection_metadata& metadata) {
+            if (metadata.m_client == &w.endpoint)
+                metadata.m_requests.expire(sent_before);
+        });
+
+        schedule_sweep(w);
+    });
+}
+
+connection_metadata::ptr websocket_endpoint::get_metadata(con_id_type id) const {
+    return m_connection_list.find(id);
 }
 
-std::string* websocket_endpoint::get_latest_message(con_id_type id) {
-    con_list::const_iterator metadata_it = m_connection_list.find(id);
+bool websocket_endpoint::get_latest_message(con_id_type id, message_record& record) const {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
 
-    if (metadata_it == m_connection_list.end() || metadata_it->second->m_messages.size() == 0)
-        return nullptr;
+    if (!metadata)
+        return false;
     
-    return &(metadata_it->second->m_messages.back());
+    return metadata->m_messages.latest(record);
+}
+
+bool websocket_endpoint::open_audit_journal(const std::string& base_path, std::size_t segment_size) {
+    std::lock_guard<std::mutex> lock {m_connect_mutex};
+
+    if (m_audit) {
+        APP_LOG(log_flags::ws, "> Audit journal already open: " << m_audit->base());
+        return false;
+    }
+
+    auto journal = std::make_unique<audit_journal>();
+    if (!journal->open(base_path, segment_size)) {
+        APP_LOG(log_flags::ws, "> Could not open audit journal " << audit_segment_path(base_path, journal->first_segment()));
+        return false;
+    }
+
+    m_audit = std::move(journal);
+    return true;
+}
+
+bool websocket_endpoint::print_audit_trail(con_id_type id, std::ostream& out, std::size_t last) const {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (!metadata || !m_audit) {
+        APP_LOG(log_flags::ws, "> No audit trail for connection " << id);
+        return false;
+    }
+
+    audit_journal_reader reader;
+    if (!reader.open(m_audit->base(), m_audit->first_segment())) {
+        APP_LOG(log_flags::ws, "> Could not read audit journal " << m_audit->base());
+        return false;
+    }
+
+    // payloads are copied out, the reader unmaps a segment once it moves to the next one
+    std::deque<std::pair<message_direction, std::string>> messages;
+    std::uint64_t total = 0;
+
+    audit_record record;
+    while (reader.next(record)) {
+        if (record.con_id != id)
+            continue;
+
+        total++;
+        if (record.frame != journal_frame::text)
+            messages.emplace_back(record.direction, websocketpp::utility::to_hex(std::string{record.payload}));
+        else
+            messages.emplace_back(record.direction, std::string{record.payload});
+
+        if (messages.size() > last)
+            messages.pop_front();
+    }
+
+    metadata->print_details(out);
+    out << "> Messages Processed: (" << total << ") \n";
+    if (messages.size() < total)
+        out << "> Showing last " << messages.size() << " messages\n";
+    out << "\n";
+
+    for (const auto& [direction, payload] : messages)
+        print_message(out, direction, payload);
+
+    return true;
+}
+
+bool websocket_endpoint::start_recording(con_id_type id, const std::string& path) {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (!metadata) {
+        APP_LOG(log_flags::ws, "> No connection found with id " << id);
+        return false;
+    }
+
+    auto journal = std::make_unique<message_journal_writer>();
+    if (!journal->open(path)) {
+        APP_LOG(log_flags::ws, "> Could not open journal " << path);
+        return false;
+    }
+
+    stop_recording(id);
+    metadata->m_journal.store(journal.release(), std::memory_order_release);
+
+    APP_LOG(log_flags::ws, "> Recording connection " << id << " to " << path);
+    return true;
+}
+
+void websocket_endpoint::stop_recording(con_id_type id) {
+    connection_metadata::ptr metadata = m_connection_list.find(id);
+    if (!metadata)
+        return;
+
+    message_journal_writer* journal = metadata->m_journal.exchange(nullptr, std::memory_order_acq_rel);
+    if (!journal)
+        return;
+
+    // the network thread may be appending, the journal is closed from that thread once it is done
+    std::shared_ptr<message_journal_writer> closing {journal};
+    metadata->m_client->get_io_service().post([closing]() {
+        APP_LOG(log_flags::ws, "> Journal closed, " << closing->records() << " messages recorded");
+        closing->close();
+    });
+}
+
+replay_stats websocket_endpoint::replay(const std::string& path, double speed, message_listener listener) {
+    message_journal_reader reader;
+    if (!reader.open(path)) {
+        APP_LOG(log_flags::ws, "> Could not open journal " << path);
+        return replay_stats{};
+    }
+
+    connection_metadata replayed {WS_CON_ERR_CODE, websocketpp::connection_hdl(), "replay:" + path, m_options.history_capacity, std::move(listener)};
+
+    return replay_journal(reader, speed, [&](const journal_record& record) {
+        replayed.handle_message(record.frame, record.payload, record.timestamp);
+    });
 }
\ No newline at end of file
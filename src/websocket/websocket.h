@@ -10,15 +10,30 @@
 #include <websocketpp/common/thread.hpp>
 #include <websocketpp/common/memory.hpp>
 
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
-#include <map>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 #include <lib/benchmark.h>
-// global benchmark object
-extern benchmark g_benchmark;
+#include <lib/thread_affinity.h>
+#include <websocket/message_ring.h>
+#include <websocket/request_tracker.h>
+#include <websocket/connection_table.h>
+#include <websocket/message_journal.h>
+#include <websocket/audit_journal.h>
+#include <websocket/tls_session_cache.h>
+#include <websocket/frame_batch.h>
+
+// benchmark object of each thread: the REPL thread starts it and its own sends end it, sends from the
+// network, clock probe and supervisor threads find theirs not started
+extern thread_local benchmark g_benchmark;
 
 using con_id_type = int;
 
@@ -27,20 +42,73 @@ using con_id_type = int;
 #define WS_FAIL_STATUS "Failed"
 #define WS_CLOSE_STATUS "Closed"
 
+// set on the network thread, read from any thread
+enum class connection_status : std::uint8_t {
+    connecting,
+    open,
+    failed,
+    closed
+};
+
+inline const char* status_name(connection_status status) {
+    switch(status) {
+        case connection_status::connecting: return WS_INIT_STATUS;
+        case connection_status::open: return WS_OPEN_STATUS;
+        case connection_status::failed: return WS_FAIL_STATUS;
+        case connection_status::closed: return WS_CLOSE_STATUS;
+    }
+    return "";
+}
+
 constexpr int WS_CON_ERR_CODE = -1;
-constexpr unsigned int WS_MSG_TYPE_LEN = 6; // 'SENT: ' or 'RECV: '
 constexpr unsigned int WS_JSON_FORMAT_WIDTH = 4;
+constexpr std::size_t WS_MAX_CONNECTIONS = 16; // open at the same time, per endpoint
+constexpr std::size_t WS_MAX_WORKERS = 8;      // network threads per endpoint
+
+// message history kept per connection
+constexpr std::size_t WS_DEFAULT_HISTORY_CAPACITY = 256;  // messages
+constexpr std::size_t WS_DEFAULT_HISTORY_SLOT_SIZE = 4096; // bytes per message
+
+// how a network thread waits for socket events
+enum class network_run_mode {
+    blocking,  // io_service::run, sleeps in epoll until there is work
+    busy_poll  // io_service::poll in a spin loop, keeps a core busy to skip the wakeup latency
+};
 
 typedef websocketpp::client<websocketpp::config::asio_tls_client> client;
+typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> tls_socket;
 typedef std::shared_ptr<boost::asio::ssl::context> context_ptr;
 typedef client::message_ptr message_ptr;
+typedef websocketpp::config::asio_tls_client::message_type message_type;
+
+// called on the network thread for every text message received on a connection
+typedef std::function<void(std::string_view payload)> message_listener;
+
+// called on the network thread when a connection opens (true), or fails or closes (false)
+typedef std::function<void(con_id_type id, bool open)> state_listener;
+
+// time points of the phases of opening a connection, zero until reached
+struct connect_timing {
+    tsc_clock::time_point start;         // connect() called
+    tsc_clock::time_point tcp_connected; // name resolved and TCP connected
+    tsc_clock::time_point tls_done;      // TLS handshake completed
+    tsc_clock::time_point open;          // websocket upgrade completed
+    bool tls_resumed = false;            // the handshake resumed a cached session
+
+    bool complete() const { return open != tsc_clock::time_point{}; }
+};
 
 class connection_metadata {
 public:
     typedef websocketpp::lib::shared_ptr<connection_metadata> ptr;
 
     // constructor
-    connection_metadata(con_id_type id, websocketpp::connection_hdl hdl, std::string uri);
+    connection_metadata(con_id_type id, websocketpp::connection_hdl hdl, std::string uri,
+        std::size_t history_capacity = WS_DEFAULT_HISTORY_CAPACITY, message_listener listener = nullptr,
+        state_listener on_state = nullptr);
+
+    // destructor
+    ~connection_metadata();
 
     // callback functions
     void on_open(client * c, websocketpp::connection_hdl hdl);
@@ -48,13 +116,24 @@ public:
     void on_close(client * c, websocketpp::connection_hdl hdl);
     void on_message(client * c, websocketpp::connection_hdl hdl, message_ptr msg);
 
+    // handling of a received frame, shared by live connections and journal replay
+    void handle_message(journal_frame frame, const std::string& payload, tsc_clock::time_point recv_time);
+
     // modifiers
-    std::string& record_sent_message(std::string message);
+    void record_sent_message(std::string_view message);
+    rpc_future track_request(request_id_type id, rpc_callback callback = nullptr);
+    void cancel_request(request_id_type id) { m_requests.cancel(id); }
 
     // getters / setters
     websocketpp::connection_hdl get_hdl() const { return m_hdl; }
     con_id_type get_id() const { return m_id; }
-    std::string get_status() const { return m_status; }
+    connection_status get_status() const { return m_status.load(std::memory_order_acquire); }
+    // connecting or open
+    bool in_use() const { connection_status status = get_status(); return status == connection_status::connecting || status == connection_status::open; }
+    const connect_timing& get_connect_timing() const { return m_connect_timing; }
+
+    // uri, status, close reason and connect timings
+    void print_details(std::ostream& out) const;
 
     // operator methods
     friend std::ostream & operator<<(std::ostream & out, connection_metadata const & data);
@@ -62,11 +141,18 @@ public:
 private:
     con_id_type m_id;
     websocketpp::connection_hdl m_hdl;
-    std::string m_status;
+    std::atomic<connection_status> m_status {connection_status::connecting};
     std::string m_uri;
     std::string m_server;
     std::string m_error_reason;
-    std::vector<std::string> m_messages;
+    message_ring m_messages;
+    request_tracker m_requests;
+    message_listener m_listener;
+    state_listener m_state_listener;
+    std::atomic<message_journal_writer*> m_journal {nullptr}; // received frames are recorded while set
+    audit_journal* m_audit = nullptr; // every message sent and received, owned by the endpoint
+    client* m_client = nullptr;       // endpoint of the network thread the connection runs on
+    connect_timing m_connect_timing;  // written on the network thread until the connection is open
 };
 
 class websocket_endpoint {
@@ -74,30 +160,115 @@ public:
     struct send_result {
         websocketpp::lib::error_code ec;
         std::string err_message;
+        rpc_future response; // only valid for requests sent with send_request()
+    };
+
+    struct options {
+        std::size_t history_capacity = WS_DEFAULT_HISTORY_CAPACITY;
+        // one network thread, with its own io_service, per entry: the cpu it is pinned to or NO_CPU
+        std::vector<int> worker_cpus = {NO_CPU};
+
+        network_run_mode run_mode = network_run_mode::blocking;
+        int realtime_priority = 0; // SCHED_FIFO priority of the network threads, 0 keeps the default scheduler
+        int busy_poll_us = 0;      // SO_BUSY_POLL on every socket, 0 leaves it unset
+
+        // socket options set once the TCP connection is established
+        bool tcp_no_delay = true;  // send small frames (orders) immediately
+        bool tcp_quick_ack = true; // acknowledge immediately instead of delaying ACKs
+        int receive_buffer = 0;    // SO_RCVBUF bytes, 0 keeps the system default
+        int send_buffer = 0;       // SO_SNDBUF bytes, 0 keeps the system default
+
+        bool tls_session_resumption = true; // reconnects resume the last TLS session to the server
+    };
+
+    // counters of a busy-polling network thread
+    struct worker_stats {
+        int cpu = NO_CPU;
+        std::uint64_t polls = 0;      // spin loop iterations
+        std::uint64_t idle_polls = 0; // iterations which found no work
+        std::uint64_t handlers = 0;   // handlers run
     };
 
     // constructor
     websocket_endpoint();
+    explicit websocket_endpoint(options opts);
 
     // destructor
     ~websocket_endpoint();
 
     // modifiers
-    con_id_type connect(const std::string& uri);
+    // the connection runs on network thread worker % worker_count(), for its whole lifetime
+    con_id_type connect(const std::string& uri, message_listener listener = nullptr, std::size_t worker = 0,
+        state_listener on_state = nullptr);
     void close(con_id_type id, websocketpp::close::status::value code, std::string reason);
-    send_result send(con_id_type id, std::string message);
+    // the message is copied into the outgoing frame before returning
+    send_result send(con_id_type id, std::string_view message);
+    send_result send_request(con_id_type id, request_id_type request_id, std::string_view message, rpc_callback callback = nullptr);
+    // stop tracking a request whose response is no longer awaited (eg. after a timeout), its future is abandoned
+    void cancel_request(con_id_type id, request_id_type request_id);
+    // the requests of a batch written to the socket in one write, each response completes its own future
+    // (appended to responses, in the order of the batch), nothing is sent if the batch can not be queued
+    // the callback (if any) runs for the response of every request of the batch
+    send_result send_batch(con_id_type id, const frame_batch& batch, std::vector<rpc_future>& responses, rpc_callback callback = nullptr);
     connection_metadata::ptr get_metadata(con_id_type id) const;
 
-    std::string* get_latest_message(con_id_type id);
+    bool get_latest_message(con_id_type id, message_record& record) const;
+
+    // audit trail of the messages of every connection opened afterwards, in <base_path>.<index>.audit files
+    bool open_audit_journal(const std::string& base_path, std::size_t segment_size = WS_AUDIT_SEGMENT_SIZE);
+    bool has_audit_journal() const { return m_audit != nullptr; }
+
+    // connection details and its last messages, read back from the audit journal
+    bool print_audit_trail(con_id_type id, std::ostream& out, std::size_t last = WS_DEFAULT_HISTORY_CAPACITY) const;
+
+    // record every frame received on a connection into a journal file
+    bool start_recording(con_id_type id, const std::string& path);
+    void stop_recording(con_id_type id);
+
+    // feed a journal through the received message handling of a detached connection, on the calling thread
+    // speed: 1 recorded pace, N times the recorded pace, 0 as fast as possible
+    replay_stats replay(const std::string& path, double speed, message_listener listener);
+
+    std::size_t worker_count() const { return m_workers.size(); }
+    network_run_mode run_mode() const { return m_options.run_mode; }
+    worker_stats get_worker_stats(std::size_t worker) const;
 
     // callbacks
-    static context_ptr on_tls_init();
+    context_ptr on_tls_init(websocketpp::connection_hdl hdl);
+    void on_socket_init(connection_metadata* metadata, websocketpp::connection_hdl hdl, tls_socket& socket);
 private:
-    typedef std::map<con_id_type, connection_metadata::ptr> con_list;
+    // TLS context shared by every connection, created once
+    context_ptr make_tls_context();
+
+    // OpenSSL callbacks, the endpoint is the context's app data and the connection the SSL's
+    static int on_new_tls_session(SSL* ssl, SSL_SESSION* session);
+    static void on_tls_state(const SSL* ssl, int where, int ret);
+
+    // a websocketpp client with its own io_service, run by one network thread
+    struct worker {
+        client endpoint;
+        websocketpp::lib::shared_ptr<websocketpp::lib::thread> thread;
+        int cpu = NO_CPU;
+        std::unique_ptr<boost::asio::steady_timer> sweep_timer; // fails the expired requests of its connections
+
+        // busy_poll mode, written by the network thread only
+        std::atomic<std::uint64_t> polls {0};
+        std::atomic<std::uint64_t> idle_polls {0};
+        std::atomic<std::uint64_t> handlers {0};
+    };
+
+    void run_worker(worker& w, std::size_t index);
+    // every WS_REQUEST_SWEEP_INTERVAL, on the worker's network thread
+    void schedule_sweep(worker& w);
+
+    typedef connection_table<connection_metadata, WS_MAX_CONNECTIONS> con_list;
 
-    client m_endpoint;
-    
-    websocketpp::lib::shared_ptr<websocketpp::lib::thread> m_thread;
+    std::vector<std::unique_ptr<worker>> m_workers;
     con_list m_connection_list;
-    con_id_type m_next_id;
+    std::mutex m_connect_mutex; // serializes connect(), lookups are lock-free
+    std::atomic<con_id_type> m_next_id;
+    options m_options;
+    context_ptr m_tls_context;
+    tls_session_cache m_tls_sessions;
+    std::unique_ptr<audit_journal> m_audit;
 };
\ No newline at end of file